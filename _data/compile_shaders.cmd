@@ -7,9 +7,12 @@ set BINARIES_FOLDER="./shaders/"
 
 :: raygen shaders
 %GLSL_COMPILER% -V -S rgen %SOURCE_FOLDER%raygen.glsl -o %BINARIES_FOLDER%raygen.bin
+%GLSL_COMPILER% -V -S rgen %SOURCE_FOLDER%wf_extend.glsl -o %BINARIES_FOLDER%wf_extend.bin
+%GLSL_COMPILER% -V -S rgen %SOURCE_FOLDER%wf_connect.glsl -o %BINARIES_FOLDER%wf_connect.bin
 
 :: closest hit shaders
 %GLSL_COMPILER% -V -S rchit %SOURCE_FOLDER%r0_chit.glsl -o %BINARIES_FOLDER%r0_chit.bin
+%GLSL_COMPILER% -V -S rchit -DMATERIAL_FEATURES=0 %SOURCE_FOLDER%r0_chit.glsl -o %BINARIES_FOLDER%r0_chit_diffuse.bin
 %GLSL_COMPILER% -V -S rchit %SOURCE_FOLDER%r1_hit.glsl -o %BINARIES_FOLDER%r1_chit.bin
 
 :: any-hit shaders
@@ -18,3 +21,10 @@ set BINARIES_FOLDER="./shaders/"
 :: miss shaders
 %GLSL_COMPILER% -V -S rmiss %SOURCE_FOLDER%r0_miss.glsl -o %BINARIES_FOLDER%r0_miss.bin
 %GLSL_COMPILER% -V -S rmiss %SOURCE_FOLDER%r1_miss.glsl -o %BINARIES_FOLDER%r1_miss.bin
+
+:: wavefront compute shaders
+%GLSL_COMPILER% -V -S comp %SOURCE_FOLDER%wf_generate.glsl -o %BINARIES_FOLDER%wf_generate.bin
+%GLSL_COMPILER% -V -S comp %SOURCE_FOLDER%wf_shade.glsl -o %BINARIES_FOLDER%wf_shade.bin
+%GLSL_COMPILER% -V -S comp -DSORT_SCAN %SOURCE_FOLDER%wf_sort.glsl -o %BINARIES_FOLDER%wf_sort_scan.bin
+%GLSL_COMPILER% -V -S comp %SOURCE_FOLDER%wf_sort.glsl -o %BINARIES_FOLDER%wf_sort_scatter.bin
+%GLSL_COMPILER% -V -S comp %SOURCE_FOLDER%wf_resolve.glsl -o %BINARIES_FOLDER%wf_resolve.bin
@@ -0,0 +1,622 @@
+#include "Benchmark.h"
+#include "vkTracer.h"
+#include "Camera.h"
+#include "CpuTracer.h"
+#include "framework/StartupReport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+BenchmarkConfig::BenchmarkConfig()
+    : apertureRadius(0.0f)
+    , focusDistance(100.0f)
+    , shutterOpen(1.0f)
+    , shutterClose(1.0f)
+    , geometryBudgetMB(0)
+    , warmupFrames(60)
+    , measuredFrames(300)
+    , outputName(L"benchmark_results")
+{
+}
+
+bool BenchmarkConfig::LoadFromFile(const std::wstring& fileName, std::string& error) {
+    std::ifstream file(Platform::ToNativePath(fileName));
+    if (!file.is_open()) {
+        error = "can't open the config file";
+        return false;
+    }
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+
+        std::istringstream stream(line);
+        std::string key;
+        if (!(stream >> key)) {
+            continue;
+        }
+
+        bool valid = true;
+        if (key == "scene") {
+            std::string scene;
+            valid = !!(stream >> scene);
+            scenes.push_back(std::wstring(scene.begin(), scene.end()));
+        } else if (key == "resolution") {
+            BenchmarkResolution resolution;
+            valid = (stream >> resolution.width >> resolution.height) && resolution.width > 0 && resolution.height > 0;
+            resolutions.push_back(resolution);
+        } else if (key == "spp") {
+            uint32_t spp = 0;
+            valid = (stream >> spp) && spp > 0;
+            samplesPerPixel.push_back(spp);
+        } else if (key == "integrator") {
+            std::string integrator;
+            valid = (stream >> integrator) && (integrator == "recursive" || integrator == "wavefront");
+            integrators.push_back(integrator);
+        } else if (key == "geometry_order") {
+            std::string order;
+            valid = (stream >> order) && (order == "morton" || order == "file");
+            geometryOrders.push_back(order);
+        } else if (key == "backend") {
+            std::string backend;
+            valid = (stream >> backend) && (backend == "vulkan" || backend == "cpu");
+            backends.push_back(backend);
+        } else if (key == "threads") {
+            uint32_t threads = 0;
+            valid = (stream >> threads) && threads > 0;
+            threadCounts.push_back(threads);
+        } else if (key == "numa") {
+            std::string placement;
+            valid = (stream >> placement) && (placement == "off" || placement == "interleave" || placement == "replicate");
+            numaPlacements.push_back(placement);
+        } else if (key == "lod") {
+            std::string policy;
+            valid = (stream >> policy) && (policy == "off" || policy == "projected");
+            lodPolicies.push_back(policy);
+        } else if (key == "warmup") {
+            valid = !!(stream >> warmupFrames);
+        } else if (key == "frames") {
+            valid = (stream >> measuredFrames) && measuredFrames > 0;
+        } else if (key == "camera") {
+            vec3 position, target;
+            valid = !!(stream >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z);
+
+            Camera camera;
+            camera.LookAt(position, target);
+            cameraPath.AddKeyframe(static_cast<float>(cameraPath.GetNumKeyframes()), position, camera.GetRotation());
+        } else if (key == "camera_path") {
+            std::string path;
+            valid = !!(stream >> path);
+            if (valid && !cameraPath.LoadFromFile(Platform::GetExecutableFolder() + L"/" + std::wstring(path.begin(), path.end()))) {
+                error = "line " + std::to_string(lineNumber) + ": can't load the camera path " + path;
+                return false;
+            }
+        } else if (key == "lens") {
+            valid = (stream >> apertureRadius >> focusDistance) && apertureRadius >= 0.0f && focusDistance > 0.0f;
+        } else if (key == "shutter") {
+            valid = (stream >> shutterOpen >> shutterClose) && shutterOpen >= 0.0f && shutterOpen <= shutterClose && shutterClose <= 1.0f;
+        } else if (key == "geometry_budget") {
+            valid = !!(stream >> geometryBudgetMB);
+        } else if (key == "output") {
+            std::string output;
+            valid = !!(stream >> output);
+            outputName = std::wstring(output.begin(), output.end());
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            error = "line " + std::to_string(lineNumber) + ": can't parse \"" + line + "\"";
+            return false;
+        }
+    }
+
+    if (scenes.empty()) {
+        error = "no scene given";
+        return false;
+    }
+
+    // the interactive defaults
+    if (resolutions.empty()) {
+        resolutions.push_back({ 1280, 720 });
+    }
+    if (samplesPerPixel.empty()) {
+        samplesPerPixel.push_back(1);
+    }
+    if (integrators.empty()) {
+        integrators.push_back("recursive");
+    }
+    if (geometryOrders.empty()) {
+        geometryOrders.push_back("morton");
+    }
+    if (backends.empty()) {
+        backends.push_back("vulkan");
+    }
+    // the scaling curve, doubling up to what the machine has
+    if (threadCounts.empty()) {
+        const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(hardwareThreads);
+    }
+    if (numaPlacements.empty()) {
+        numaPlacements.push_back("off");
+    }
+    if (lodPolicies.empty()) {
+        lodPolicies.push_back("off");
+    }
+
+    return true;
+}
+
+bool BenchmarkRun::EvaluateCamera(const uint32_t measuredFrame, vec3& position, quat& rotation) const {
+    // fixed steps derived from the frame index alone, the frame rate has no say in what is traced
+    const float t = (measuredFrames > 1) ? static_cast<float>(min(measuredFrame, measuredFrames - 1)) / static_cast<float>(measuredFrames - 1) : 0.0f;
+    return cameraPath.Evaluate(t * cameraPath.GetDuration(), position, rotation);
+}
+
+BenchmarkResult::BenchmarkResult()
+    : completed(false)
+    , loadTime(0.0)
+    , asBuildTime(0.0)
+    , frameTimeAvg(0.0)
+    , frameTimeP50(0.0)
+    , frameTimeP95(0.0)
+    , frameTimeP99(0.0)
+    , gpuTraceTime(0.0)
+    , primaryMraysPerSecond(0.0)
+    , vertexMissRatio(0.0)
+    , peakMemoryBytes(0)
+    , geometryResidentBytes(0)
+    , geometryPageFaults(0)
+    , tracedTriangles(0.0)
+{
+}
+
+void BenchmarkResult::SetFrameTimes(std::vector<double> frameTimes) {
+    if (frameTimes.empty()) {
+        return;
+    }
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    auto Percentile = [&frameTimes](const double percentile) -> double {
+        const size_t index = static_cast<size_t>(percentile * (frameTimes.size() - 1) + 0.5);
+        return frameTimes[index];
+    };
+
+    frameTimeAvg = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / frameTimes.size();
+    frameTimeP50 = Percentile(0.50);
+    frameTimeP95 = Percentile(0.95);
+    frameTimeP99 = Percentile(0.99);
+}
+
+int Benchmark::Run(const std::wstring& configFileName, const bool headless) {
+    BenchmarkConfig config;
+    std::string error;
+    if (!config.LoadFromFile(configFileName, error)) {
+        std::cerr << "Benchmark config: " << error << "\n";
+        return 1;
+    }
+
+    std::vector<BenchmarkRun> runs;
+    for (const std::wstring& scene : config.scenes) {
+        for (const BenchmarkResolution& resolution : config.resolutions) {
+            for (const uint32_t spp : config.samplesPerPixel) {
+                for (const std::string& integrator : config.integrators) {
+                    for (const std::string& geometryOrder : config.geometryOrders) {
+                        for (const std::string& backend : config.backends) {
+                            BenchmarkRun run;
+                            run.scene = scene;
+                            run.resolution = resolution;
+                            run.samplesPerPixel = spp;
+                            run.integrator = integrator;
+                            run.geometryOrder = geometryOrder;
+                            run.backend = backend;
+                            run.threads = 0;
+                            run.warmupFrames = config.warmupFrames;
+                            run.measuredFrames = config.measuredFrames;
+                            run.cameraPath = config.cameraPath;
+                            run.apertureRadius = config.apertureRadius;
+                            run.focusDistance = config.focusDistance;
+                            run.shutterOpen = config.shutterOpen;
+                            run.shutterClose = config.shutterClose;
+                            run.geometryBudgetMB = (backend == "vulkan") ? config.geometryBudgetMB : 0;
+                            run.lod = "off";
+
+                            if (backend == "vulkan") {
+                                for (const std::string& lod : config.lodPolicies) {
+                                    run.lod = lod;
+                                    runs.push_back(run);
+                                }
+                            } else {
+                                for (const uint32_t threads : config.threadCounts) {
+                                    for (const std::string& numa : config.numaPlacements) {
+                                        run.threads = threads;
+                                        run.numa = numa;
+                                        runs.push_back(run);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    for (const BenchmarkRun& run : runs) {
+        std::cout << "Benchmark: " << std::string(run.scene.begin(), run.scene.end()) << " "
+                  << run.resolution.width << "x" << run.resolution.height << " " << run.samplesPerPixel << " spp "
+                  << run.integrator << " " << run.geometryOrder << " " << run.backend;
+        if (run.threads > 0) {
+            std::cout << " " << run.threads << " threads numa " << run.numa;
+        } else {
+            std::cout << " lod " << run.lod;
+        }
+        std::cout << "\n";
+
+        // a fresh application per run, nothing is shared but the on-disk caches
+        if (run.backend == "cpu") {
+            results.push_back(Benchmark::RunCpu(run));
+        } else {
+            vkTracer tracer;
+            tracer.SetBenchmarkRun(run);
+            tracer.SetHeadless(headless);
+            tracer.Run();
+            results.push_back(tracer.GetBenchmarkResult());
+        }
+
+        const BenchmarkResult& result = results.back();
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  load " << result.loadTime << " ms, AS build " << result.asBuildTime << " ms, frame avg "
+                  << result.frameTimeAvg << " ms p99 " << result.frameTimeP99 << " ms, "
+                  << result.primaryMraysPerSecond << " Mrays/s\n";
+        for (size_t node = 0; node < result.nodeFetchGBPerSecond.size(); ++node) {
+            std::cout << "  node " << node << " fetched " << result.nodeFetchGBPerSecond[node] << " GB/s\n";
+        }
+        for (size_t node = 0; node < result.nodePageCounters.size(); ++node) {
+            const NumaNodeCounters& counters = result.nodePageCounters[node];
+            std::cout << "  node " << node << " pages: numa_hit " << counters.Hits << " numa_miss " << counters.Misses
+                      << " other_node " << counters.OtherNode << "\n";
+        }
+        if (run.geometryBudgetMB > 0) {
+            std::cout << "  geometry " << static_cast<double>(result.geometryResidentBytes) / (1024.0 * 1024.0) << " of " << run.geometryBudgetMB
+                      << " MB resident at most, " << result.geometryPageFaults << " page faults\n";
+        }
+        if (run.backend == "vulkan") {
+            std::cout << "  " << result.tracedTriangles / 1e6 << " M triangles traced per frame\n";
+        }
+    }
+
+    Benchmark::PrintCpuScaling(results);
+    Benchmark::PrintLodSavings(results);
+
+    const std::wstring outputPath = Platform::GetExecutableFolder() + L"/" + config.outputName;
+
+    bool written = WriteCsv(outputPath + L".csv", results);
+    written = WriteJson(outputPath + L".json", results) && written;
+    if (!written) {
+        std::cerr << "Benchmark: failed to write the results\n";
+        return 1;
+    }
+
+    const bool allCompleted = std::all_of(results.begin(), results.end(), [](const BenchmarkResult& result) {
+        return result.completed;
+    });
+    return allCompleted ? 0 : 1;
+}
+
+uint64_t Benchmark::GetPeakMemoryUsage() {
+    return StartupReport::GetHostMemoryPeak();
+}
+
+BenchmarkResult Benchmark::RunCpu(const BenchmarkRun& run) {
+    using Clock = std::chrono::steady_clock;
+    auto MillisecondsSince = [](const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    BenchmarkResult result;
+    result.run = run;
+    result.backend = "cpu";
+
+    // with a placement the workers are pinned to the nodes, off leaves them to the scheduler
+    const NumaTopology topology = NumaTopology::Query();
+    CpuMemoryPlacement placement = CpuMemoryPlacement::Default;
+    if (run.numa == "interleave") {
+        placement = CpuMemoryPlacement::Interleave;
+    } else if (run.numa == "replicate") {
+        placement = CpuMemoryPlacement::Replicate;
+    }
+    JobSystem jobSystem(run.threads, (run.numa == "off") ? nullptr : &topology);
+
+    const Clock::time_point loadStart = Clock::now();
+    GeometryLoader loader;
+    loader.SetReorderEnabled(run.geometryOrder != "file");
+    loader.SetCacheFolder(Platform::GetExecutableFolder() + L"/_data/cache/geometries/");
+    if (!loader.LoadFromOBJ(Platform::GetExecutableFolder() + L"/_data/geometries/" + run.scene)) {
+        std::cerr << "Benchmark: can't load " << std::string(run.scene.begin(), run.scene.end()) << "\n";
+        return result;
+    }
+    result.loadTime = MillisecondsSince(loadStart);
+    result.vertexMissRatio = loader.GetVertexMissRatio();
+
+    // system wide counters, the deltas include whatever else allocated meanwhile
+    std::vector<NumaNodeCounters> countersBefore;
+    const bool hasCounters = topology.ReadCounters(countersBefore);
+
+    const Clock::time_point buildStart = Clock::now();
+    CpuTracer tracer(jobSystem, placement);
+    tracer.SetIntegrator((run.integrator == "wavefront") ? CpuIntegrator::Wavefront : CpuIntegrator::Recursive);
+    tracer.Build(loader);
+    result.asBuildTime = MillisecondsSince(buildStart);
+
+    // the view vkTracer::CreateCamera and UploadCamera set up
+    const BenchmarkResolution& resolution = run.resolution;
+    Camera camera;
+    camera.SetViewport({ 0, 0, static_cast<int>(resolution.width), static_cast<int>(resolution.height) });
+    camera.SetViewPlanes(0.01f, 5000.0f);
+    camera.SetFovY(45.0f);
+    camera.LookAt(vec3(155.15f, 297.802f, 0.0f), vec3(8.0f, 20.0f, -250.0f));
+    camera.SetLens(run.apertureRadius, run.focusDistance);
+    camera.SetShutter(run.shutterOpen, run.shutterClose);
+
+    const float fovY = Deg2Rad(45.0f);
+    CamData_s camData;
+    camData.nearFarFov = vec4(0.01f, 5000.0f, fovY, RayConePixelSpread(fovY, static_cast<float>(resolution.height)));
+    camData.lens = vec4(camera.GetApertureRadius(), camera.GetFocusDistance(), camera.GetShutterOpen(), camera.GetShutterClose());
+    camData.sampling = uvec4(run.samplesPerPixel, 0, 0, 0);
+
+    std::vector<vec3> colors;
+    std::vector<double> frameTimes;
+    for (uint32_t frame = 0; frame < run.warmupFrames + run.measuredFrames; ++frame) {
+        // warm-up frames stay on the first keyframe
+        const uint32_t measuredFrame = (frame > run.warmupFrames) ? (frame - run.warmupFrames) : 0;
+
+        vec3 position;
+        quat rotation;
+        if (run.EvaluateCamera(measuredFrame, position, rotation)) {
+            camera.SetTransform(position, rotation);
+        }
+
+        // the previous frame's view for the motion blur, none before the first one
+        camData.prevPos = (frame > 0) ? camData.pos : vec4(camera.GetPosition(), 0.0f);
+        camData.prevDir = (frame > 0) ? camData.dir : vec4(camera.GetDirection(), 0.0f);
+        camData.prevUp = (frame > 0) ? camData.up : vec4(camera.GetUp(), 0.0f);
+        camData.prevSide = (frame > 0) ? camData.side : vec4(camera.GetSide(), 0.0f);
+        camData.pos = vec4(camera.GetPosition(), 0.0f);
+        camData.dir = vec4(camera.GetDirection(), 0.0f);
+        camData.up = vec4(camera.GetUp(), 0.0f);
+        camData.side = vec4(camera.GetSide(), 0.0f);
+
+        if (frame == run.warmupFrames) {
+            tracer.ResetFetchCounters();
+        }
+
+        const Clock::time_point frameStart = Clock::now();
+        tracer.Render(camData, resolution.width, resolution.height, frame, colors);
+        if (frame >= run.warmupFrames) {
+            frameTimes.push_back(MillisecondsSince(frameStart));
+        }
+    }
+
+    result.completed = true;
+    result.run.threads = jobSystem.GetNumThreads();
+    result.SetFrameTimes(frameTimes);
+
+    const double primaryRays = static_cast<double>(resolution.width) * static_cast<double>(resolution.height) * static_cast<double>(run.samplesPerPixel);
+    if (result.frameTimeAvg > 0.0) {
+        result.primaryMraysPerSecond = primaryRays / (result.frameTimeAvg * 1000.0);
+    }
+
+    const double measuredSeconds = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / 1000.0;
+    for (const uint64_t bytes : tracer.GetFetchedBytesPerNode()) {
+        result.nodeFetchGBPerSecond.push_back((measuredSeconds > 0.0) ? static_cast<double>(bytes) / (measuredSeconds * 1e9) : 0.0);
+    }
+    std::vector<NumaNodeCounters> countersAfter;
+    if (hasCounters && topology.ReadCounters(countersAfter)) {
+        for (size_t node = 0; node < countersAfter.size(); ++node) {
+            NumaNodeCounters delta;
+            delta.Hits = countersAfter[node].Hits - countersBefore[node].Hits;
+            delta.Misses = countersAfter[node].Misses - countersBefore[node].Misses;
+            delta.OtherNode = countersAfter[node].OtherNode - countersBefore[node].OtherNode;
+            result.nodePageCounters.push_back(delta);
+        }
+    }
+    result.peakMemoryBytes = Benchmark::GetPeakMemoryUsage();
+    return result;
+}
+
+void Benchmark::PrintCpuScaling(const std::vector<BenchmarkResult>& results) {
+    auto SameCombination = [](const BenchmarkRun& a, const BenchmarkRun& b) {
+        return a.scene == b.scene && a.resolution.width == b.resolution.width && a.resolution.height == b.resolution.height &&
+               a.samplesPerPixel == b.samplesPerPixel && a.integrator == b.integrator && a.geometryOrder == b.geometryOrder && a.numa == b.numa;
+    };
+
+    bool printedHeader = false;
+    for (const BenchmarkResult& result : results) {
+        if (result.backend != "cpu" || !result.completed) {
+            continue;
+        }
+
+        const BenchmarkResult* baseline = &result;
+        for (const BenchmarkResult& other : results) {
+            if (other.backend == "cpu" && other.completed && SameCombination(other.run, result.run) && other.run.threads < baseline->run.threads) {
+                baseline = &other;
+            }
+        }
+
+        if (!printedHeader) {
+            std::cout << "CPU scaling, frame time speedup over the fewest threads:\n";
+            printedHeader = true;
+        }
+        const double speedup = (result.frameTimeAvg > 0.0) ? baseline->frameTimeAvg / result.frameTimeAvg : 0.0;
+        const double efficiency = speedup * baseline->run.threads / result.run.threads;
+        std::cout << std::fixed << std::setprecision(2) << "  " << std::string(result.run.scene.begin(), result.run.scene.end()) << " "
+                  << result.run.resolution.width << "x" << result.run.resolution.height << " " << result.run.samplesPerPixel << " spp "
+                  << result.run.integrator << " " << result.run.geometryOrder << " numa " << result.run.numa << " " << std::setw(3) << result.run.threads << " threads: "
+                  << speedup << "x, " << efficiency * 100.0 << "% efficiency\n";
+    }
+
+    // what the placement buys at the same thread count
+    printedHeader = false;
+    for (const BenchmarkResult& result : results) {
+        if (result.backend != "cpu" || !result.completed || result.run.numa == "off") {
+            continue;
+        }
+
+        BenchmarkRun unplacedRun = result.run;
+        unplacedRun.numa = "off";
+        for (const BenchmarkResult& other : results) {
+            if (other.backend != "cpu" || !other.completed || !SameCombination(other.run, unplacedRun) || other.run.threads != result.run.threads) {
+                continue;
+            }
+
+            if (!printedHeader) {
+                std::cout << "CPU NUMA placement, Mrays/s over numa off:\n";
+                printedHeader = true;
+            }
+            const double ratio = (other.primaryMraysPerSecond > 0.0) ? result.primaryMraysPerSecond / other.primaryMraysPerSecond : 0.0;
+            std::cout << std::fixed << std::setprecision(2) << "  " << std::string(result.run.scene.begin(), result.run.scene.end()) << " "
+                      << result.run.resolution.width << "x" << result.run.resolution.height << " " << result.run.samplesPerPixel << " spp "
+                      << result.run.integrator << " " << result.run.geometryOrder << " numa " << result.run.numa << " " << std::setw(3) << result.run.threads << " threads: "
+                      << result.primaryMraysPerSecond << " vs " << other.primaryMraysPerSecond << " Mrays/s, " << ratio << "x\n";
+            break;
+        }
+    }
+}
+
+void Benchmark::PrintLodSavings(const std::vector<BenchmarkResult>& results) {
+    auto SameCombination = [](const BenchmarkRun& a, const BenchmarkRun& b) {
+        return a.scene == b.scene && a.resolution.width == b.resolution.width && a.resolution.height == b.resolution.height &&
+               a.samplesPerPixel == b.samplesPerPixel && a.integrator == b.integrator && a.geometryOrder == b.geometryOrder &&
+               a.geometryBudgetMB == b.geometryBudgetMB;
+    };
+
+    bool printedHeader = false;
+    for (const BenchmarkResult& result : results) {
+        if (result.backend != "vulkan" || !result.completed || result.run.lod == "off") {
+            continue;
+        }
+
+        for (const BenchmarkResult& other : results) {
+            if (other.backend != "vulkan" || !other.completed || other.run.lod != "off" || !SameCombination(other.run, result.run)) {
+                continue;
+            }
+
+            if (!printedHeader) {
+                std::cout << "Levels of detail, traced triangles and Mrays/s over lod off:\n";
+                printedHeader = true;
+            }
+            const double triangles = (other.tracedTriangles > 0.0) ? result.tracedTriangles / other.tracedTriangles : 0.0;
+            const double speedup = (other.primaryMraysPerSecond > 0.0) ? result.primaryMraysPerSecond / other.primaryMraysPerSecond : 0.0;
+            std::cout << std::fixed << std::setprecision(2) << "  " << std::string(result.run.scene.begin(), result.run.scene.end()) << " "
+                      << result.run.resolution.width << "x" << result.run.resolution.height << " " << result.run.samplesPerPixel << " spp "
+                      << result.run.integrator << " " << result.run.geometryOrder << " lod " << result.run.lod << ": "
+                      << result.tracedTriangles / 1e6 << " vs " << other.tracedTriangles / 1e6 << " M triangles (" << triangles << "x), "
+                      << result.primaryMraysPerSecond << " vs " << other.primaryMraysPerSecond << " Mrays/s, " << speedup << "x\n";
+            break;
+        }
+    }
+}
+
+bool Benchmark::WriteCsv(const std::wstring& fileName, const std::vector<BenchmarkResult>& results) {
+    std::ofstream file(Platform::ToNativePath(fileName), std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << "scene,backend,threads,numa,integrator,geometry_order,width,height,spp,warmup_frames,measured_frames,completed,load_ms,as_build_ms,"
+            "frame_avg_ms,frame_p50_ms,frame_p95_ms,frame_p99_ms,gpu_trace_ms,primary_mrays_per_s,vertex_miss_ratio,peak_memory_mb,"
+            "geometry_budget_mb,geometry_resident_mb,geometry_page_faults,lod,traced_triangles\n";
+
+    file << std::fixed << std::setprecision(3);
+    for (const BenchmarkResult& result : results) {
+        const BenchmarkRun& run = result.run;
+        file << std::string(run.scene.begin(), run.scene.end()) << ',' << result.backend << ',' << run.threads << ',' << run.numa << ',' << run.integrator << ',' << run.geometryOrder << ','
+             << run.resolution.width << ',' << run.resolution.height << ',' << run.samplesPerPixel << ','
+             << run.warmupFrames << ',' << run.measuredFrames << ',' << (result.completed ? 1 : 0) << ','
+             << result.loadTime << ',' << result.asBuildTime << ','
+             << result.frameTimeAvg << ',' << result.frameTimeP50 << ',' << result.frameTimeP95 << ',' << result.frameTimeP99 << ','
+             << result.gpuTraceTime << ',' << result.primaryMraysPerSecond << ',' << result.vertexMissRatio << ','
+             << static_cast<double>(result.peakMemoryBytes) / (1024.0 * 1024.0) << ','
+             << run.geometryBudgetMB << ',' << static_cast<double>(result.geometryResidentBytes) / (1024.0 * 1024.0) << ','
+             << result.geometryPageFaults << ',' << run.lod << ',' << result.tracedTriangles << '\n';
+    }
+
+    file.close();
+    return !file.fail();
+}
+
+bool Benchmark::WriteJson(const std::wstring& fileName, const std::vector<BenchmarkResult>& results) {
+    std::ofstream file(Platform::ToNativePath(fileName), std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    auto WriteString = [&file](const std::string& value) {
+        file << '"';
+        for (const char c : value) {
+            if (c == '"' || c == '\\') {
+                file << '\\';
+            }
+            file << c;
+        }
+        file << '"';
+    };
+
+    file << std::fixed << std::setprecision(3) << "{\"runs\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult& result = results[i];
+        const BenchmarkRun& run = result.run;
+
+        file << (i ? ",\n" : "\n") << "{\"scene\":";
+        WriteString(std::string(run.scene.begin(), run.scene.end()));
+        file << ",\"backend\":";
+        WriteString(result.backend);
+        file << ",\"threads\":" << run.threads << ",\"numa\":";
+        WriteString(run.numa);
+        file << ",\"integrator\":";
+        WriteString(run.integrator);
+        file << ",\"geometry_order\":";
+        WriteString(run.geometryOrder);
+        file << ",\"width\":" << run.resolution.width << ",\"height\":" << run.resolution.height
+             << ",\"spp\":" << run.samplesPerPixel << ",\"warmup_frames\":" << run.warmupFrames
+             << ",\"measured_frames\":" << run.measuredFrames << ",\"completed\":" << (result.completed ? "true" : "false")
+             << ",\"load_ms\":" << result.loadTime << ",\"as_build_ms\":" << result.asBuildTime
+             << ",\"frame_ms\":{\"avg\":" << result.frameTimeAvg << ",\"p50\":" << result.frameTimeP50
+             << ",\"p95\":" << result.frameTimeP95 << ",\"p99\":" << result.frameTimeP99 << "}"
+             << ",\"gpu_trace_ms\":" << result.gpuTraceTime << ",\"primary_mrays_per_s\":" << result.primaryMraysPerSecond
+             << ",\"vertex_miss_ratio\":" << result.vertexMissRatio
+             << ",\"peak_memory_bytes\":" << result.peakMemoryBytes
+             << ",\"geometry_budget_mb\":" << run.geometryBudgetMB << ",\"geometry_resident_bytes\":" << result.geometryResidentBytes
+             << ",\"geometry_page_faults\":" << result.geometryPageFaults << ",\"lod\":";
+        WriteString(run.lod);
+        file << ",\"traced_triangles\":" << result.tracedTriangles << ",\"node_fetch_gb_per_s\":[";
+        for (size_t node = 0; node < result.nodeFetchGBPerSecond.size(); ++node) {
+            file << (node ? "," : "") << result.nodeFetchGBPerSecond[node];
+        }
+        file << "],\"node_pages\":[";
+        for (size_t node = 0; node < result.nodePageCounters.size(); ++node) {
+            const NumaNodeCounters& counters = result.nodePageCounters[node];
+            file << (node ? "," : "") << "{\"numa_hit\":" << counters.Hits << ",\"numa_miss\":" << counters.Misses
+                 << ",\"other_node\":" << counters.OtherNode << "}";
+        }
+        file << "]}";
+    }
+    file << "\n]}\n";
+
+    file.close();
+    return !file.fail();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CameraPath.h"
+#include "framework/Numa.h"
+
+struct BenchmarkResolution {
+    uint32_t    width;
+    uint32_t    height;
+};
+
+// Parsed from a plain text file, one setting per line, '#' starts a comment:
+//   scene OrganodronCity/Organodron_City.obj   (relative to the geometry folder, repeatable)
+//   resolution 1920 1080                       (repeatable)
+//   spp 1                                      (repeatable)
+//   integrator recursive                       (recursive or wavefront, repeatable)
+//   geometry_order morton                      (morton or file, repeatable)
+//   backend vulkan                             (vulkan or cpu, repeatable)
+//   threads 8                                  (cpu worker threads, repeatable; 1, 2, 4 ... up to every hardware thread by default)
+//   numa replicate                             (off, interleave or replicate, cpu scene data placement, repeatable; off by default)
+//   warmup 60
+//   frames 300
+//   camera 155.15 297.8 0.0  8.0 20.0 -250.0   (position, target; repeatable, one second apart)
+//   camera_path camera_path.campath            (recorded with R, next to the executable; replaces camera)
+//   lens 2.0 300.0                             (aperture radius, focus distance; pinhole by default)
+//   shutter 0.5 1.0                            (open, close; 0 is the previous frame's view, 1 1 by default)
+//   geometry_budget 1024                       (MB, vulkan backend pages the scene in within it; 0, all of it resident, by default)
+//   lod projected                              (off or projected, vulkan level of detail policy, repeatable; off by default)
+//   output benchmark_results                   (.csv and .json are appended)
+// Every scene x resolution x spp x integrator x geometry order x backend combination is one run,
+// the vulkan backend once per level of detail policy, the cpu backend once per thread count and
+// NUMA placement.
+// Any placement but off also pins the cpu workers to the NUMA nodes.
+// The camera path is played back over the measured frames in equal steps, so every run of the
+// same config traces the same views.
+struct BenchmarkConfig {
+    BenchmarkConfig();
+
+    bool LoadFromFile(const std::wstring& fileName, std::string& error);
+
+    std::vector<std::wstring>           scenes;
+    std::vector<BenchmarkResolution>    resolutions;
+    std::vector<uint32_t>               samplesPerPixel;
+    std::vector<std::string>            integrators;
+    std::vector<std::string>            geometryOrders;
+    std::vector<std::string>            backends;
+    std::vector<uint32_t>               threadCounts;
+    std::vector<std::string>            numaPlacements;
+    std::vector<std::string>            lodPolicies;
+    CameraPath                          cameraPath;
+    float                               apertureRadius;
+    float                               focusDistance;
+    float                               shutterOpen;
+    float                               shutterClose;
+    uint32_t                            geometryBudgetMB;
+    uint32_t                            warmupFrames;
+    uint32_t                            measuredFrames;
+    std::wstring                        outputName;
+};
+
+struct BenchmarkRun {
+    std::wstring                        scene;
+    BenchmarkResolution                 resolution;
+    uint32_t                            samplesPerPixel;
+    std::string                         integrator;
+    std::string                         geometryOrder;
+    std::string                         backend;
+    // cpu backend only, 0 and empty for the vulkan one
+    uint32_t                            threads;
+    std::string                         numa;
+    uint32_t                            warmupFrames;
+    uint32_t                            measuredFrames;
+    CameraPath                          cameraPath;
+    float                               apertureRadius;
+    float                               focusDistance;
+    float                               shutterOpen;
+    float                               shutterClose;
+    // vulkan backend only, see vkTracer::SetGeometryBudget and SetLodPolicy; off for the cpu one
+    uint32_t                            geometryBudgetMB;
+    std::string                         lod;
+
+    // measured frame N of M sits at N / (M - 1) of the path, an empty path keeps the default camera
+    bool EvaluateCamera(const uint32_t measuredFrame, vec3& position, quat& rotation) const;
+};
+
+// times are in milliseconds
+struct BenchmarkResult {
+    BenchmarkResult();
+
+    // average and percentiles over every measured frame
+    void SetFrameTimes(std::vector<double> frameTimes);
+
+    BenchmarkRun    run;
+    std::string     backend;
+    bool            completed;
+    double          loadTime;
+    double          asBuildTime;
+    double          frameTimeAvg;
+    double          frameTimeP50;
+    double          frameTimeP95;
+    double          frameTimeP99;
+    double          gpuTraceTime;
+    double          primaryMraysPerSecond;
+    // see GeometryLoader::GetVertexMissRatio
+    double          vertexMissRatio;
+    // process peak working set, runs share the process so it never goes down between them
+    uint64_t        peakMemoryBytes;
+    // cpu backend, GB/s of BVH and triangle data the workers of each NUMA node traversed over
+    // the measured frames, see CpuTracer::GetFetchedBytesPerNode
+    std::vector<double> nodeFetchGBPerSecond;
+    // cpu backend, the kernel's page allocation counters of each NUMA node over the scene build
+    // and all frames, empty when the system doesn't count them; misses and other_node are the
+    // pages that didn't end up next to the thread that wanted them
+    std::vector<NumaNodeCounters> nodePageCounters;
+    // paged vulkan runs, the most geometry and acceleration structure bytes resident at once, the
+    // pools counted whole as they are allocated up front, and
+    // the pages loaded over the whole run, see GeometryPager
+    uint64_t        geometryResidentBytes;
+    uint64_t        geometryPageFaults;
+    // vulkan runs, the triangles in the top level structure averaged over the measured frames,
+    // a mesh blending two levels of detail counts each by the share of samples that see it
+    double          tracedTriangles;
+};
+
+class Benchmark {
+public:
+    // Runs every combination of the config, writes the report next to the executable
+    // and returns the process exit code. Headless runs need no display, see Platform.
+    static int Run(const std::wstring& configFileName, const bool headless);
+
+    static uint64_t GetPeakMemoryUsage();
+
+private:
+    // the whole run on CpuTracer, no window and no device
+    static BenchmarkResult RunCpu(const BenchmarkRun& run);
+    // frame time speedup of every cpu run over the one with the fewest threads of the same combination,
+    // and the Mrays/s of every placed run against the unplaced one with as many threads
+    static void PrintCpuScaling(const std::vector<BenchmarkResult>& results);
+    // traced triangles and Mrays/s of every vulkan run with levels of detail against the one without
+    static void PrintLodSavings(const std::vector<BenchmarkResult>& results);
+    static bool WriteCsv(const std::wstring& fileName, const std::vector<BenchmarkResult>& results);
+    static bool WriteJson(const std::wstring& fileName, const std::vector<BenchmarkResult>& results);
+};
@@ -7,9 +7,14 @@ Camera::Camera(Camera::Type type)
     , mFovY(65.0f)
     , mNearZ(1.0f)
     , mFarZ(10000.0f)
+    , mApertureRadius(0.0f)
+    , mFocusDistance(100.0f)
+    , mShutterOpen(1.0f)
+    , mShutterClose(1.0f)
     , mPosition(0.0f, 0.0f, 0.0f)
     , mDirection(0.0f, 0.0f, 1.0f)
 {
+    this->MakeTransform();
 }
 
 Camera::~Camera() {
@@ -36,6 +41,16 @@ void Camera::SetPosition(const vec3& pos) {
     this->MakeTransform();
 }
 
+void Camera::SetLens(const float apertureRadius, const float focusDistance) {
+    mApertureRadius = apertureRadius;
+    mFocusDistance = focusDistance;
+}
+
+void Camera::SetShutter(const float open, const float close) {
+    mShutterOpen = open;
+    mShutterClose = close;
+}
+
 void Camera::LookAt(const vec3& pos, const vec3& target) {
     mPosition = pos;
     mDirection = normalize(target - pos);
@@ -43,6 +58,13 @@ void Camera::LookAt(const vec3& pos, const vec3& target) {
     this->MakeTransform();
 }
 
+void Camera::SetTransform(const vec3& pos, const quat& rotation) {
+    mPosition = pos;
+    mDirection = normalize(QRotate(rotation, vec3(0.0f, 0.0f, -1.0f)));
+
+    this->MakeTransform();
+}
+
 void Camera::Move(const float side, const float direction) {
     vec3 cameraSide = normalize(cross(mDirection, gCameraUp));
 
@@ -64,6 +86,26 @@ void Camera::Rotate(const float angleX, const float angleY) {
     this->MakeTransform();
 }
 
+float Camera::GetFovY() const {
+    return mFovY;
+}
+
+float Camera::GetApertureRadius() const {
+    return mApertureRadius;
+}
+
+float Camera::GetFocusDistance() const {
+    return mFocusDistance;
+}
+
+float Camera::GetShutterOpen() const {
+    return mShutterOpen;
+}
+
+float Camera::GetShutterClose() const {
+    return mShutterClose;
+}
+
 const mat4& Camera::GetProjection() const {
     return mProjection;
 }
@@ -80,6 +122,10 @@ const vec3& Camera::GetDirection() const {
     return mDirection;
 }
 
+const quat& Camera::GetRotation() const {
+    return mRotation;
+}
+
 const vec3 Camera::GetUp() const {
     return vec3(mTransform[0][1], mTransform[1][1], mTransform[2][1]);
 }
@@ -104,4 +150,5 @@ void Camera::MakeProjection() {
 
 void Camera::MakeTransform() {
     mTransform = MatLookAt(mPosition, mPosition + mDirection, vec3(0.0f, 1.0f, 0.0f));
+    mRotation = QLookAt(mDirection, gCameraUp);
 }
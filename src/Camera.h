@@ -16,16 +16,31 @@ public:
     void        SetFovY(const float fovy);
     void        SetViewPlanes(const float nearZ, const float farZ);
     void        SetPosition(const vec3& pos);
+    // thin lens, a zero aperture radius is the pinhole
+    void        SetLens(const float apertureRadius, const float focusDistance);
+    // part of the way from the previous view to this one the shutter is open for, 1 to 1 freezes the motion
+    void        SetShutter(const float open, const float close);
 
     void        LookAt(const vec3& pos, const vec3& target);
+    // rotation as GetRotation returns it, the camera has no roll so only the direction is kept
+    void        SetTransform(const vec3& pos, const quat& rotation);
     void        Move(const float side, const float direction);
     void        Rotate(const float angleX, const float angleY);
 
+    // in degrees like SetFovY
+    float       GetFovY() const;
     const mat4& GetProjection() const;
     const mat4& GetTransform() const;
 
     const vec3& GetPosition() const;
     const vec3& GetDirection() const;
+    // turns -Z into the view direction
+    const quat& GetRotation() const;
+
+    float       GetApertureRadius() const;
+    float       GetFocusDistance() const;
+    float       GetShutterOpen() const;
+    float       GetShutterClose() const;
     const vec3  GetUp() const;
     const vec3  GetSide() const;
 
@@ -39,6 +54,10 @@ private:
     float   mFovY;
     float   mNearZ;
     float   mFarZ;
+    float   mApertureRadius;
+    float   mFocusDistance;
+    float   mShutterOpen;
+    float   mShutterClose;
     vec3    mPosition;
     vec3    mDirection;
     quat    mRotation;
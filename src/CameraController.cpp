@@ -0,0 +1,44 @@
+#include "CameraController.h"
+
+CameraController::CameraController()
+    : mMoveSpeed(35.0f)
+    , mAccelMult(10.0f)
+    , mRotateSpeed(5.0f)
+{
+}
+
+CameraController::~CameraController() {
+}
+
+bool CameraController::Update(const InputState& input, const float dt, Camera& camera) const {
+    bool changed = false;
+
+    if (input.IsButtonDown(MouseButton::Left) && (input.CursorDeltaX || input.CursorDeltaY)) {
+        const vec2 delta = vec2(static_cast<float>(-input.CursorDeltaX), static_cast<float>(-input.CursorDeltaY)) * mRotateSpeed * dt;
+        camera.Rotate(delta.x, delta.y);
+        changed = true;
+    }
+
+    vec2 moveDelta(0.0f, 0.0f);
+    if (input.IsKeyDown(InputKey::W)) {
+        moveDelta.y += 1.0f;
+    }
+    if (input.IsKeyDown(InputKey::S)) {
+        moveDelta.y -= 1.0f;
+    }
+    if (input.IsKeyDown(InputKey::A)) {
+        moveDelta.x -= 1.0f;
+    }
+    if (input.IsKeyDown(InputKey::D)) {
+        moveDelta.x += 1.0f;
+    }
+
+    // opposite keys cancel out, and a frame with dt 0 doesn't move either
+    moveDelta *= mMoveSpeed * dt * (input.IsKeyDown(InputKey::Shift) ? mAccelMult : 1.0f);
+    if (moveDelta.x != 0.0f || moveDelta.y != 0.0f) {
+        camera.Move(moveDelta.x, moveDelta.y);
+        changed = true;
+    }
+
+    return changed;
+}
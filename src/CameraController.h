@@ -0,0 +1,20 @@
+#pragma once
+#include "framework/Platform.h"
+#include "Camera.h"
+
+// Fly camera driven by the input snapshot: WASD moves, Shift speeds it up, dragging with the
+// left button looks around. Update only touches the camera when the input asks for it and says
+// so, everything that depends on the view (uploads, accumulation) can skip the static frames.
+class CameraController {
+public:
+    CameraController();
+    ~CameraController();
+
+    // true when the camera moved or turned
+    bool    Update(const InputState& input, const float dt, Camera& camera) const;
+
+private:
+    float   mMoveSpeed;
+    float   mAccelMult;
+    float   mRotateSpeed;
+};
@@ -0,0 +1,119 @@
+#include "CameraPath.h"
+#include "framework/Platform.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static const char       sCameraPathMagic[4] = { 'V', 'K', 'C', 'P' };
+static const uint32_t   sCameraPathVersion = 1;
+
+CameraPath::CameraPath() {
+}
+
+CameraPath::~CameraPath() {
+}
+
+void CameraPath::Clear() {
+    mKeyframes.clear();
+}
+
+bool CameraPath::IsEmpty() const {
+    return mKeyframes.empty();
+}
+
+size_t CameraPath::GetNumKeyframes() const {
+    return mKeyframes.size();
+}
+
+float CameraPath::GetDuration() const {
+    return mKeyframes.empty() ? 0.0f : mKeyframes.back().time;
+}
+
+void CameraPath::AddKeyframe(const float time, const vec3& position, const quat& rotation) {
+    CameraPathKeyframe keyframe;
+    keyframe.time = mKeyframes.empty() ? time : std::max(time, mKeyframes.back().time);
+    keyframe.position = position;
+    keyframe.rotation = rotation;
+    mKeyframes.push_back(keyframe);
+}
+
+bool CameraPath::Evaluate(const float time, vec3& position, quat& rotation) const {
+    if (mKeyframes.empty()) {
+        return false;
+    }
+
+    // first keyframe that comes after time
+    auto next = std::upper_bound(mKeyframes.begin(), mKeyframes.end(), time, [](const float t, const CameraPathKeyframe& keyframe) {
+        return t < keyframe.time;
+    });
+
+    if (next == mKeyframes.begin() || next == mKeyframes.end()) {
+        const CameraPathKeyframe& end = (next == mKeyframes.begin()) ? mKeyframes.front() : mKeyframes.back();
+        position = end.position;
+        rotation = end.rotation;
+        return true;
+    }
+
+    const CameraPathKeyframe& first = *(next - 1);
+    const CameraPathKeyframe& second = *next;
+    const float blend = (time - first.time) / (second.time - first.time);
+
+    position = lerp(first.position, second.position, blend);
+    rotation = QSlerp(first.rotation, second.rotation, blend);
+    return true;
+}
+
+bool CameraPath::SaveToFile(const std::wstring& fileName) const {
+    std::ofstream file(Platform::ToNativePath(fileName), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const uint32_t numKeyframes = static_cast<uint32_t>(mKeyframes.size());
+    file.write(sCameraPathMagic, sizeof(sCameraPathMagic));
+    file.write(reinterpret_cast<const char*>(&sCameraPathVersion), sizeof(sCameraPathVersion));
+    file.write(reinterpret_cast<const char*>(&numKeyframes), sizeof(numKeyframes));
+
+    for (const CameraPathKeyframe& keyframe : mKeyframes) {
+        const float values[8] = {
+            keyframe.time,
+            keyframe.position.x, keyframe.position.y, keyframe.position.z,
+            keyframe.rotation.x, keyframe.rotation.y, keyframe.rotation.z, keyframe.rotation.w
+        };
+        file.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+
+    file.close();
+    return !file.fail();
+}
+
+bool CameraPath::LoadFromFile(const std::wstring& fileName) {
+    std::ifstream file(Platform::ToNativePath(fileName), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0, numKeyframes = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&numKeyframes), sizeof(numKeyframes));
+    if (!file || memcmp(magic, sCameraPathMagic, sizeof(magic)) != 0 || version != sCameraPathVersion) {
+        return false;
+    }
+
+    std::vector<CameraPathKeyframe> keyframes(numKeyframes);
+    for (CameraPathKeyframe& keyframe : keyframes) {
+        float values[8];
+        if (!file.read(reinterpret_cast<char*>(values), sizeof(values))) {
+            return false;
+        }
+        keyframe.time = values[0];
+        keyframe.position = vec3(values[1], values[2], values[3]);
+        keyframe.rotation = normalize(quat(values[7], values[4], values[5], values[6]));
+    }
+
+    mKeyframes.swap(keyframes);
+    return true;
+}
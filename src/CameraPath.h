@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "mymath.h"
+
+struct CameraPathKeyframe {
+    float   time;       // seconds since the start of the path
+    vec3    position;
+    quat    rotation;   // as Camera::GetRotation returns it
+};
+
+// Camera poses over time, recorded from the interactive camera or built from the benchmark
+// keyframes. Playback is driven by a time the caller steps, never by the wall clock, so two runs
+// that step it the same way trace exactly the same views.
+class CameraPath {
+public:
+    CameraPath();
+    ~CameraPath();
+
+    void    Clear();
+    bool    IsEmpty() const;
+    size_t  GetNumKeyframes() const;
+    // time of the last keyframe
+    float   GetDuration() const;
+
+    // times must not go backwards
+    void    AddKeyframe(const float time, const vec3& position, const quat& rotation);
+    // position is linear and rotation slerped between the keyframes around time, clamped to the ends
+    bool    Evaluate(const float time, vec3& position, quat& rotation) const;
+
+    // "VKCP", version and keyframe count as uint32, then per keyframe 8 floats:
+    // time, position xyz, rotation xyzw
+    bool    SaveToFile(const std::wstring& fileName) const;
+    bool    LoadFromFile(const std::wstring& fileName);
+
+private:
+    std::vector<CameraPathKeyframe> mKeyframes;
+};
@@ -0,0 +1,877 @@
+#include "CpuTracer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <functional>
+#include <numeric>
+
+static const uint32_t sTileSize = 16;
+static const uint32_t sBVHNumBins = 12;
+static const uint32_t sBVHMaxLeafSize = 4;
+// leaves this big are still worth it when no split is cheaper
+static const uint32_t sBVHMaxSAHLeafSize = 16;
+// smaller subtrees are built on the thread that got there, a job costs more than it saves
+static const uint32_t sBVHParallelThreshold = 4096;
+// deeper nodes are leaves whatever their size, so the traversal stack holding a far child per level can't overflow
+static const uint32_t sBVHMaxDepth = 64;
+static const uint32_t sBVHStackSize = sBVHMaxDepth;
+// rays the wavefront integrator traces together, the lanes of the widest vector registers around
+static const uint32_t sPacketSize = 8;
+// the arrays of a placed copy start on their own cache lines
+static const size_t sPlacedAlignment = 64;
+// what r0_miss.glsl returns with the IBL off
+static const vec3 sSkyColor(0.6f, 0.7f, 0.8f);
+
+// the lanes past count are empty rays that miss everything
+struct CpuTracer::RayPacket {
+    float       originX[sPacketSize];
+    float       originY[sPacketSize];
+    float       originZ[sPacketSize];
+    float       directionX[sPacketSize];
+    float       directionY[sPacketSize];
+    float       directionZ[sPacketSize];
+    float       invDirectionX[sPacketSize];
+    float       invDirectionY[sPacketSize];
+    float       invDirectionZ[sPacketSize];
+    float       tmin[sPacketSize];
+    float       tfar[sPacketSize];      // tmax, then the closest hit so far
+    uint32_t    count;
+};
+
+// cell d of a Hilbert curve filling an n x n grid, n a power of two
+static void HilbertToXY(const uint32_t n, uint32_t d, uint32_t& x, uint32_t& y) {
+    x = 0;
+    y = 0;
+    for (uint32_t s = 1; s < n; s <<= 1) {
+        const uint32_t rx = 1u & (d >> 1);
+        const uint32_t ry = 1u & (d ^ rx);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+        x += s * rx;
+        y += s * ry;
+        d >>= 2;
+    }
+}
+
+// half the surface area, only ever compared
+static float HalfArea(const vec3& boundsMin, const vec3& boundsMax) {
+    const vec3 e = boundsMax - boundsMin;
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+CpuTracer::CpuTracer(JobSystem& jobSystem, const CpuMemoryPlacement placement)
+    : mJobSystem(jobSystem)
+    , mPlacement(placement)
+    , mIntegrator(CpuIntegrator::Recursive)
+    , mNumNodes(0)
+{
+    mFetchCounters.resize(mJobSystem.GetNumThreads());
+    mWavefrontQueues.resize(mJobSystem.GetNumThreads());
+    this->ResetFetchCounters();
+    // an empty scene until Build
+    this->PlaceSceneData();
+}
+CpuTracer::~CpuTracer() {
+}
+
+void CpuTracer::Build(GeometryLoader& loader) {
+    mPositions.clear();
+    mNormals.clear();
+    mFaces.clear();
+    mFaceMatIDs.clear();
+    mMaterials.assign(loader.GetMaterials(), loader.GetMaterials() + loader.GetNumMaterials());
+
+    // one flat scene, the meshes are not instanced
+    for (size_t i = 0; i < loader.GetNumMeshes(); ++i) {
+        const uint32_t vertexOffset = static_cast<uint32_t>(mPositions.size());
+        const size_t numVertices = loader.GetNumVertices(i);
+        mPositions.insert(mPositions.end(), loader.GetPositions(i), loader.GetPositions(i) + numVertices);
+        mNormals.insert(mNormals.end(), loader.GetNormals(i), loader.GetNormals(i) + numVertices);
+
+        const Face* faces = loader.GetFaces(i);
+        for (size_t j = 0; j < loader.GetNumFaces(i); ++j) {
+            mFaces.push_back({ faces[j].a + vertexOffset, faces[j].b + vertexOffset, faces[j].c + vertexOffset });
+        }
+        mFaceMatIDs.insert(mFaceMatIDs.end(), loader.GetFaceMaterialIDs(i), loader.GetFaceMaterialIDs(i) + loader.GetNumFaces(i));
+    }
+
+    const uint32_t numFaces = static_cast<uint32_t>(mFaces.size());
+    std::vector<vec3> centroids(numFaces), boundsMins(numFaces), boundsMaxs(numFaces);
+    mJobSystem.ParallelFor(numFaces, sBVHParallelThreshold, [this, &centroids, &boundsMins, &boundsMaxs](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            const vec3& a = mPositions[mFaces[i].a];
+            const vec3& b = mPositions[mFaces[i].b];
+            const vec3& c = mPositions[mFaces[i].c];
+            boundsMins[i] = glm::min(glm::min(a, b), c);
+            boundsMaxs[i] = glm::max(glm::max(a, b), c);
+            centroids[i] = (a + b + c) * (1.0f / 3.0f);
+        }
+    });
+
+    std::vector<uint32_t> order(numFaces);
+    std::iota(order.begin(), order.end(), 0u);
+
+    // a binary tree over N leaves of at least one triangle has at most 2N - 1 nodes
+    mNodes.resize(std::max(numFaces * 2, 2u) - 1);
+    mNumNodes = 1;
+    if (numFaces > 0) {
+        this->BuildNode(0, 0, 0, numFaces, order, centroids, boundsMins, boundsMaxs);
+    } else {
+        mNodes[0] = { vec3(FLT_MAX), 0, vec3(-FLT_MAX), 0 };
+    }
+    mNodes.resize(mNumNodes);
+
+    // the leaves index the triangles in the order they were left in
+    mTriangles.resize(numFaces);
+    mJobSystem.ParallelFor(numFaces, sBVHParallelThreshold, [this, &order](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            const Face& face = mFaces[order[i]];
+            Triangle& triangle = mTriangles[i];
+            triangle.v0 = mPositions[face.a];
+            triangle.e1 = mPositions[face.b] - triangle.v0;
+            triangle.e2 = mPositions[face.c] - triangle.v0;
+            triangle.face = order[i];
+        }
+    });
+
+    this->PlaceSceneData();
+}
+
+void CpuTracer::PlaceSceneData() {
+    const NumaTopology& topology = mJobSystem.GetTopology();
+    const uint32_t numNumaNodes = std::max(topology.GetNumNodes(), 1u);
+
+    SceneData source;
+    source.nodes = mNodes.data();
+    source.triangles = mTriangles.data();
+    source.numTriangles = static_cast<uint32_t>(mTriangles.size());
+    source.normals = mNormals.data();
+    source.faces = mFaces.data();
+    source.faceMatIDs = mFaceMatIDs.data();
+    source.materials = mMaterials.data();
+
+    mPlacedData.clear();
+    mScenes.assign(numNumaNodes, source);
+    if (mPlacement == CpuMemoryPlacement::Default) {
+        return;
+    }
+
+    // one block holding every array, laid out once and filled per copy
+    const size_t sizes[] = {
+        mNodes.size() * sizeof(BVHNode),
+        mTriangles.size() * sizeof(Triangle),
+        mNormals.size() * sizeof(vec3),
+        mFaces.size() * sizeof(Face),
+        mFaceMatIDs.size() * sizeof(uint32_t),
+        mMaterials.size() * sizeof(Material_s),
+    };
+    const void* sources[] = { source.nodes, source.triangles, source.normals, source.faces, source.faceMatIDs, source.materials };
+    const size_t numArrays = sizeof(sizes) / sizeof(sizes[0]);
+
+    size_t offsets[numArrays];
+    size_t totalSize = 0;
+    for (size_t i = 0; i < numArrays; ++i) {
+        offsets[i] = totalSize;
+        totalSize += (sizes[i] + sPlacedAlignment - 1) / sPlacedAlignment * sPlacedAlignment;
+    }
+
+    const uint32_t numCopies = (mPlacement == CpuMemoryPlacement::Replicate) ? numNumaNodes : 1;
+    for (uint32_t copy = 0; copy < numCopies; ++copy) {
+        NumaBuffer buffer;
+        const bool allocated = (mPlacement == CpuMemoryPlacement::Replicate) ? buffer.Allocate(totalSize, topology, copy) : buffer.AllocateInterleaved(totalSize, topology);
+        if (!allocated) {
+            // the vectors stay in use, placed or not the results are the same
+            mPlacedData.clear();
+            mScenes.assign(numNumaNodes, source);
+            return;
+        }
+
+        uint8_t* data = buffer.GetData();
+        for (size_t i = 0; i < numArrays; ++i) {
+            if (sizes[i] > 0) {
+                std::memcpy(data + offsets[i], sources[i], sizes[i]);
+            }
+        }
+        mPlacedData.push_back(std::move(buffer));
+    }
+
+    for (uint32_t node = 0; node < numNumaNodes; ++node) {
+        const uint8_t* data = mPlacedData[(numCopies > 1) ? node : 0].GetData();
+        SceneData& scene = mScenes[node];
+        scene.nodes = reinterpret_cast<const BVHNode*>(data + offsets[0]);
+        scene.triangles = reinterpret_cast<const Triangle*>(data + offsets[1]);
+        scene.normals = reinterpret_cast<const vec3*>(data + offsets[2]);
+        scene.faces = reinterpret_cast<const Face*>(data + offsets[3]);
+        scene.faceMatIDs = reinterpret_cast<const uint32_t*>(data + offsets[4]);
+        scene.materials = reinterpret_cast<const Material_s*>(data + offsets[5]);
+    }
+}
+
+void CpuTracer::BuildNode(const uint32_t nodeIdx, const uint32_t depth, const uint32_t first, const uint32_t count, std::vector<uint32_t>& order,
+                          const std::vector<vec3>& centroids, const std::vector<vec3>& boundsMins, const std::vector<vec3>& boundsMaxs) {
+    vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+    for (uint32_t i = first; i < first + count; ++i) {
+        const uint32_t face = order[i];
+        boundsMin = glm::min(boundsMin, boundsMins[face]);
+        boundsMax = glm::max(boundsMax, boundsMaxs[face]);
+        centroidMin = glm::min(centroidMin, centroids[face]);
+        centroidMax = glm::max(centroidMax, centroids[face]);
+    }
+
+    BVHNode& node = mNodes[nodeIdx];
+    node.boundsMin = boundsMin;
+    node.boundsMax = boundsMax;
+    node.first = first;
+    node.count = count;
+    if (count <= sBVHMaxLeafSize || depth == sBVHMaxDepth) {
+        return;
+    }
+
+    // binned SAH along the longest axis of the centroids
+    const vec3 centroidExtent = centroidMax - centroidMin;
+    int axis = 0;
+    if (centroidExtent.y > centroidExtent[axis]) {
+        axis = 1;
+    }
+    if (centroidExtent.z > centroidExtent[axis]) {
+        axis = 2;
+    }
+
+    uint32_t mid = first + count / 2;
+    if (centroidExtent[axis] > 0.0f) {
+        const float binScale = static_cast<float>(sBVHNumBins) / centroidExtent[axis];
+        auto BinOf = [&](const uint32_t face) {
+            return std::min(static_cast<uint32_t>((centroids[face][axis] - centroidMin[axis]) * binScale), sBVHNumBins - 1);
+        };
+
+        uint32_t binCounts[sBVHNumBins] = { };
+        vec3 binMins[sBVHNumBins], binMaxs[sBVHNumBins];
+        std::fill(binMins, binMins + sBVHNumBins, vec3(FLT_MAX));
+        std::fill(binMaxs, binMaxs + sBVHNumBins, vec3(-FLT_MAX));
+        for (uint32_t i = first; i < first + count; ++i) {
+            const uint32_t face = order[i];
+            const uint32_t bin = BinOf(face);
+            ++binCounts[bin];
+            binMins[bin] = glm::min(binMins[bin], boundsMins[face]);
+            binMaxs[bin] = glm::max(binMaxs[bin], boundsMaxs[face]);
+        }
+
+        // the right side swept from the end, the left one from the start
+        float rightCosts[sBVHNumBins];
+        vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+        uint32_t sweepCount = 0;
+        for (uint32_t bin = sBVHNumBins - 1; bin > 0; --bin) {
+            sweepMin = glm::min(sweepMin, binMins[bin]);
+            sweepMax = glm::max(sweepMax, binMaxs[bin]);
+            sweepCount += binCounts[bin];
+            rightCosts[bin] = sweepCount ? sweepCount * HalfArea(sweepMin, sweepMax) : 0.0f;
+        }
+
+        float bestCost = FLT_MAX;
+        uint32_t bestSplit = 0;
+        sweepMin = vec3(FLT_MAX);
+        sweepMax = vec3(-FLT_MAX);
+        sweepCount = 0;
+        for (uint32_t bin = 0; bin + 1 < sBVHNumBins; ++bin) {
+            sweepMin = glm::min(sweepMin, binMins[bin]);
+            sweepMax = glm::max(sweepMax, binMaxs[bin]);
+            sweepCount += binCounts[bin];
+            const float cost = (sweepCount ? sweepCount * HalfArea(sweepMin, sweepMax) : 0.0f) + rightCosts[bin + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = bin + 1;
+            }
+        }
+
+        if (count <= sBVHMaxSAHLeafSize && bestCost >= count * HalfArea(boundsMin, boundsMax)) {
+            return;
+        }
+
+        mid = static_cast<uint32_t>(std::partition(order.begin() + first, order.begin() + first + count, [&](const uint32_t face) {
+            return BinOf(face) < bestSplit;
+        }) - order.begin());
+        if (mid == first || mid == first + count) {
+            mid = first + count / 2;
+        }
+    }
+
+    const uint32_t leftIdx = mNumNodes.fetch_add(2);
+    node.first = leftIdx;
+    node.count = 0;
+
+    const uint32_t leftCount = mid - first;
+    const uint32_t rightCount = count - leftCount;
+    if (count < sBVHParallelThreshold) {
+        this->BuildNode(leftIdx, depth + 1, first, leftCount, order, centroids, boundsMins, boundsMaxs);
+        this->BuildNode(leftIdx + 1, depth + 1, mid, rightCount, order, centroids, boundsMins, boundsMaxs);
+        return;
+    }
+
+    // the halves touch disjoint parts of order and of the nodes
+    JobSystem::Counter counter;
+    mJobSystem.Run(counter, [&, leftIdx, depth, first, leftCount]() {
+        this->BuildNode(leftIdx, depth + 1, first, leftCount, order, centroids, boundsMins, boundsMaxs);
+    });
+    this->BuildNode(leftIdx + 1, depth + 1, mid, rightCount, order, centroids, boundsMins, boundsMaxs);
+    mJobSystem.Wait(counter);
+}
+
+bool CpuTracer::Intersect(const SceneData& scene, const vec3& origin, const vec3& direction, const float tmin, const float tmax, const bool anyHit,
+                          Hit& hit, FetchCounters& counters) const {
+    const vec3 invDirection = 1.0f / direction;
+
+    // distance to the box or FLT_MAX when it's missed or further than the closest hit so far
+    auto EnterNode = [&](const BVHNode& node, const float tfar) {
+        const vec3 t0 = (node.boundsMin - origin) * invDirection;
+        const vec3 t1 = (node.boundsMax - origin) * invDirection;
+        const vec3 tnear = glm::min(t0, t1);
+        const vec3 tfarAxes = glm::max(t0, t1);
+        const float enter = std::max(std::max(tnear.x, tnear.y), std::max(tnear.z, tmin));
+        const float exit = std::min(std::min(tfarAxes.x, tfarAxes.y), std::min(tfarAxes.z, tfar));
+        return (enter <= exit) ? enter : FLT_MAX;
+    };
+
+    hit.t = tmax;
+    bool found = false;
+
+    ++counters.nodes;
+    if (scene.numTriangles == 0 || EnterNode(scene.nodes[0], hit.t) == FLT_MAX) {
+        return false;
+    }
+
+    std::pair<uint32_t, float> stack[sBVHStackSize];
+    uint32_t stackSize = 0;
+    uint32_t nodeIdx = 0;
+
+    for (;;) {
+        const BVHNode& node = scene.nodes[nodeIdx];
+        if (node.count > 0) {
+            // Moller-Trumbore
+            counters.triangles += node.count;
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                const Triangle& triangle = scene.triangles[i];
+                const vec3 p = cross(direction, triangle.e2);
+                const float det = dot(triangle.e1, p);
+                if (abs(det) < 1e-12f) {
+                    continue;
+                }
+                const float invDet = 1.0f / det;
+                const vec3 s = origin - triangle.v0;
+                const float u = dot(s, p) * invDet;
+                if (u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+                const vec3 q = cross(s, triangle.e1);
+                const float v = dot(direction, q) * invDet;
+                if (v < 0.0f || u + v > 1.0f) {
+                    continue;
+                }
+                const float t = dot(triangle.e2, q) * invDet;
+                if (t > tmin && t < hit.t) {
+                    hit.t = t;
+                    hit.u = u;
+                    hit.v = v;
+                    hit.triangle = i;
+                    found = true;
+                    if (anyHit) {
+                        return true;
+                    }
+                }
+            }
+        } else {
+            // the nearer child first, the other one waits on the stack
+            uint32_t nearIdx = node.first;
+            uint32_t farIdx = node.first + 1;
+            float nearT = EnterNode(scene.nodes[nearIdx], hit.t);
+            float farT = EnterNode(scene.nodes[farIdx], hit.t);
+            counters.nodes += 2;
+            if (farT < nearT) {
+                std::swap(nearIdx, farIdx);
+                std::swap(nearT, farT);
+            }
+            if (nearT != FLT_MAX) {
+                if (farT != FLT_MAX) {
+                    assert(stackSize < sBVHStackSize);
+                    stack[stackSize++] = std::make_pair(farIdx, farT);
+                }
+                nodeIdx = nearIdx;
+                continue;
+            }
+        }
+
+        // nodes behind a closer hit found meanwhile are skipped
+        do {
+            if (stackSize == 0) {
+                return found;
+            }
+            --stackSize;
+        } while (stack[stackSize].second > hit.t);
+        nodeIdx = stack[stackSize].first;
+    }
+}
+
+void CpuTracer::RayStream::Resize(const size_t count) {
+    originX.resize(count);
+    originY.resize(count);
+    originZ.resize(count);
+    directionX.resize(count);
+    directionY.resize(count);
+    directionZ.resize(count);
+    tmin.resize(count);
+    tmax.resize(count);
+}
+
+void CpuTracer::RayStream::Set(const size_t i, const vec3& origin, const vec3& direction, const float rayTmin, const float rayTmax) {
+    originX[i] = origin.x;
+    originY[i] = origin.y;
+    originZ[i] = origin.z;
+    directionX[i] = direction.x;
+    directionY[i] = direction.y;
+    directionZ[i] = direction.z;
+    tmin[i] = rayTmin;
+    tmax[i] = rayTmax;
+}
+
+void CpuTracer::LoadPacket(const RayStream& rays, const uint32_t* indices, const uint32_t first, const uint32_t count, RayPacket& packet) const {
+    packet.count = count;
+    for (uint32_t lane = 0; lane < sPacketSize; ++lane) {
+        if (lane >= count) {
+            // an empty interval, no box or triangle test passes
+            packet.originX[lane] = packet.originY[lane] = packet.originZ[lane] = 0.0f;
+            packet.directionX[lane] = packet.directionY[lane] = packet.directionZ[lane] = 1.0f;
+            packet.invDirectionX[lane] = packet.invDirectionY[lane] = packet.invDirectionZ[lane] = 1.0f;
+            packet.tmin[lane] = 1.0f;
+            packet.tfar[lane] = 0.0f;
+            continue;
+        }
+
+        const uint32_t ray = indices ? indices[first + lane] : first + lane;
+        packet.originX[lane] = rays.originX[ray];
+        packet.originY[lane] = rays.originY[ray];
+        packet.originZ[lane] = rays.originZ[ray];
+        packet.directionX[lane] = rays.directionX[ray];
+        packet.directionY[lane] = rays.directionY[ray];
+        packet.directionZ[lane] = rays.directionZ[ray];
+        packet.invDirectionX[lane] = 1.0f / rays.directionX[ray];
+        packet.invDirectionY[lane] = 1.0f / rays.directionY[ray];
+        packet.invDirectionZ[lane] = 1.0f / rays.directionZ[ray];
+        packet.tmin[lane] = rays.tmin[ray];
+        packet.tfar[lane] = rays.tmax[ray];
+    }
+}
+
+void CpuTracer::IntersectPacket(const SceneData& scene, RayPacket& packet, const bool anyHit, Hit* hits, FetchCounters& counters) const {
+    float hitU[sPacketSize], hitV[sPacketSize];
+    uint32_t hitTriangles[sPacketSize];
+    std::fill(hitTriangles, hitTriangles + sPacketSize, ~0u);
+
+    // the nearest distance to the box over the lanes, FLT_MAX when every lane misses it
+    auto EnterNode = [&packet](const BVHNode& node) {
+        float nearest = FLT_MAX;
+        for (uint32_t lane = 0; lane < sPacketSize; ++lane) {
+            const float tx0 = (node.boundsMin.x - packet.originX[lane]) * packet.invDirectionX[lane];
+            const float tx1 = (node.boundsMax.x - packet.originX[lane]) * packet.invDirectionX[lane];
+            const float ty0 = (node.boundsMin.y - packet.originY[lane]) * packet.invDirectionY[lane];
+            const float ty1 = (node.boundsMax.y - packet.originY[lane]) * packet.invDirectionY[lane];
+            const float tz0 = (node.boundsMin.z - packet.originZ[lane]) * packet.invDirectionZ[lane];
+            const float tz1 = (node.boundsMax.z - packet.originZ[lane]) * packet.invDirectionZ[lane];
+            const float enter = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), packet.tmin[lane]));
+            const float exit = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), packet.tfar[lane]));
+            nearest = std::min(nearest, (enter <= exit) ? enter : FLT_MAX);
+        }
+        return nearest;
+    };
+
+    // Moller-Trumbore for every lane, any hit lanes are done with their first one and get an
+    // empty interval; true once every ray of an any hit packet has been stopped
+    auto IntersectLeaf = [&](const BVHNode& node) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            const Triangle& triangle = scene.triangles[i];
+            for (uint32_t lane = 0; lane < sPacketSize; ++lane) {
+                const float px = packet.directionY[lane] * triangle.e2.z - packet.directionZ[lane] * triangle.e2.y;
+                const float py = packet.directionZ[lane] * triangle.e2.x - packet.directionX[lane] * triangle.e2.z;
+                const float pz = packet.directionX[lane] * triangle.e2.y - packet.directionY[lane] * triangle.e2.x;
+                const float det = triangle.e1.x * px + triangle.e1.y * py + triangle.e1.z * pz;
+                const float invDet = 1.0f / det;
+                const float sx = packet.originX[lane] - triangle.v0.x;
+                const float sy = packet.originY[lane] - triangle.v0.y;
+                const float sz = packet.originZ[lane] - triangle.v0.z;
+                const float u = (sx * px + sy * py + sz * pz) * invDet;
+                const float qx = sy * triangle.e1.z - sz * triangle.e1.y;
+                const float qy = sz * triangle.e1.x - sx * triangle.e1.z;
+                const float qz = sx * triangle.e1.y - sy * triangle.e1.x;
+                const float v = (packet.directionX[lane] * qx + packet.directionY[lane] * qy + packet.directionZ[lane] * qz) * invDet;
+                const float t = (triangle.e2.x * qx + triangle.e2.y * qy + triangle.e2.z * qz) * invDet;
+                const bool hit = std::abs(det) >= 1e-12f && u >= 0.0f && u <= 1.0f && v >= 0.0f && u + v <= 1.0f &&
+                                 t > packet.tmin[lane] && t < packet.tfar[lane];
+                hitU[lane] = hit ? u : hitU[lane];
+                hitV[lane] = hit ? v : hitV[lane];
+                hitTriangles[lane] = hit ? i : hitTriangles[lane];
+                packet.tfar[lane] = hit ? (anyHit ? -FLT_MAX : t) : packet.tfar[lane];
+            }
+        }
+
+        if (!anyHit) {
+            return false;
+        }
+        uint32_t stopped = 0;
+        for (uint32_t lane = 0; lane < packet.count; ++lane) {
+            stopped += (hitTriangles[lane] != ~0u) ? 1 : 0;
+        }
+        return stopped == packet.count;
+    };
+
+    ++counters.nodes;
+    if (scene.numTriangles > 0 && EnterNode(scene.nodes[0]) != FLT_MAX) {
+        std::pair<uint32_t, float> stack[sBVHStackSize];
+        uint32_t stackSize = 0;
+        uint32_t nodeIdx = 0;
+
+        for (;;) {
+            const BVHNode& node = scene.nodes[nodeIdx];
+            if (node.count > 0) {
+                counters.triangles += node.count;
+                if (IntersectLeaf(node)) {
+                    break;
+                }
+            } else {
+                // the child nearest to any of the lanes first
+                uint32_t nearIdx = node.first;
+                uint32_t farIdx = node.first + 1;
+                float nearT = EnterNode(scene.nodes[nearIdx]);
+                float farT = EnterNode(scene.nodes[farIdx]);
+                counters.nodes += 2;
+                if (farT < nearT) {
+                    std::swap(nearIdx, farIdx);
+                    std::swap(nearT, farT);
+                }
+                if (nearT != FLT_MAX) {
+                    if (farT != FLT_MAX) {
+                        assert(stackSize < sBVHStackSize);
+                        stack[stackSize++] = std::make_pair(farIdx, farT);
+                    }
+                    nodeIdx = nearIdx;
+                    continue;
+                }
+            }
+
+            // nodes behind the closest hit of every lane are skipped
+            float farthest = -FLT_MAX;
+            for (uint32_t lane = 0; lane < sPacketSize; ++lane) {
+                farthest = std::max(farthest, packet.tfar[lane]);
+            }
+            while (stackSize > 0 && stack[stackSize - 1].second > farthest) {
+                --stackSize;
+            }
+            if (stackSize == 0) {
+                break;
+            }
+            nodeIdx = stack[--stackSize].first;
+        }
+    }
+
+    for (uint32_t lane = 0; lane < packet.count; ++lane) {
+        hits[lane].t = packet.tfar[lane];
+        hits[lane].u = hitU[lane];
+        hits[lane].v = hitV[lane];
+        hits[lane].triangle = hitTriangles[lane];
+    }
+}
+
+vec3 CpuTracer::TraceSample(const SceneData& scene, const vec3& origin, const vec3& direction, const float tmin, const float tmax, FetchCounters& counters) const {
+    Hit hit;
+    if (!this->Intersect(scene, origin, direction, tmin, tmax, false, hit, counters)) {
+        return sSkyColor;
+    }
+
+    const uint32_t faceIdx = scene.triangles[hit.triangle].face;
+    const Face& face = scene.faces[faceIdx];
+    const vec3 normal = normalize(scene.normals[face.a] * (1.0f - hit.u - hit.v) + scene.normals[face.b] * hit.u + scene.normals[face.c] * hit.v);
+    const vec3 albedo = vec3(scene.materials[scene.faceMatIDs[faceIdx]].diffuse);
+
+    // the same direct light as raygen.glsl
+    const vec3 hitPos = origin + direction * hit.t;
+    vec3 toLight = SWS_SUN_POS - hitPos;
+    const float toLightDist = length(toLight);
+    toLight /= toLightDist;
+
+    Hit shadowHit;
+    const bool inShadow = this->Intersect(scene, hitPos + normal * SWS_SHADOW_RAY_OFFSET, toLight, SWS_EPSILON, toLightDist, true, shadowHit, counters);
+    const float lambert = inShadow ? SWS_AMBIENT : max(SWS_AMBIENT, dot(normal, toLight));
+
+    return albedo * lambert;
+}
+
+void CpuTracer::RenderTile(const CamData_s& camera, const uint32_t tileX, const uint32_t tileY, const uint32_t width, const uint32_t height,
+                           const uint32_t frameIndex, vec3* output, const uint32_t outputStride) {
+    if (mIntegrator == CpuIntegrator::Wavefront) {
+        this->RenderTileWavefront(camera, tileX, tileY, width, height, frameIndex, output, outputStride);
+        return;
+    }
+
+    const uint32_t workerIndex = mJobSystem.GetWorkerIndex();
+    const SceneData& scene = mScenes[mJobSystem.GetWorkerNode(workerIndex)];
+    // counted on the stack, the shared line is written once per tile
+    FetchCounters counters = { };
+
+    const uint32_t samplesPerPixel = std::max(camera.sampling.x, 1u);
+    const vec2 bottomRight(static_cast<float>(width - 1), static_cast<float>(height - 1));
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+
+    const uint32_t startX = tileX * sTileSize;
+    const uint32_t startY = tileY * sTileSize;
+    const uint32_t endX = std::min((tileX + 1) * sTileSize, width);
+    const uint32_t endY = std::min((tileY + 1) * sTileSize, height);
+    for (uint32_t y = tileY * sTileSize; y < endY; ++y) {
+        for (uint32_t x = tileX * sTileSize; x < endX; ++x) {
+            const uvec2 pixel(x, y);
+            vec3 color(0.0f);
+            for (uint32_t i = 0; i < samplesPerPixel; ++i) {
+                const uint32_t n = frameIndex * samplesPerPixel + i;
+                const vec2 jitter = SamplerGet2D(pixel, n, SWS_SAMPLE_DIM_PIXEL) - 0.5f;
+                const vec2 uv = ((vec2(static_cast<float>(x), static_cast<float>(y)) + jitter) / bottomRight) * 2.0f - 1.0f;
+
+                vec3 origin, direction;
+                CameraRay(camera, uv, aspect, SamplerGet2D(pixel, n, SWS_SAMPLE_DIM_LENS), SamplerGet1D(pixel, n, SWS_SAMPLE_DIM_TIME), origin, direction);
+                color += this->TraceSample(scene, origin, direction, camera.nearFarFov.x, camera.nearFarFov.y, counters);
+            }
+            output[(y - startY) * outputStride + (x - startX)] = color / static_cast<float>(samplesPerPixel);
+        }
+    }
+
+    mFetchCounters[workerIndex].nodes += counters.nodes;
+    mFetchCounters[workerIndex].triangles += counters.triangles;
+}
+
+void CpuTracer::RenderTileWavefront(const CamData_s& camera, const uint32_t tileX, const uint32_t tileY, const uint32_t width, const uint32_t height,
+                                    const uint32_t frameIndex, vec3* output, const uint32_t outputStride) {
+    const uint32_t workerIndex = mJobSystem.GetWorkerIndex();
+    const SceneData& scene = mScenes[mJobSystem.GetWorkerNode(workerIndex)];
+    WavefrontQueues& queues = mWavefrontQueues[workerIndex];
+    FetchCounters counters = { };
+
+    const uint32_t samplesPerPixel = std::max(camera.sampling.x, 1u);
+    const vec2 bottomRight(static_cast<float>(width - 1), static_cast<float>(height - 1));
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+
+    const uint32_t startX = tileX * sTileSize;
+    const uint32_t startY = tileY * sTileSize;
+    const uint32_t endX = std::min((tileX + 1) * sTileSize, width);
+    const uint32_t endY = std::min((tileY + 1) * sTileSize, height);
+    const uint32_t tileWidth = endX - startX;
+    const uint32_t numSamples = tileWidth * (endY - startY) * samplesPerPixel;
+
+    // generate, the samples of a pixel next to each other
+    queues.rays.Resize(numSamples);
+    for (uint32_t y = startY; y < endY; ++y) {
+        for (uint32_t x = startX; x < endX; ++x) {
+            const uvec2 pixel(x, y);
+            for (uint32_t i = 0; i < samplesPerPixel; ++i) {
+                const uint32_t n = frameIndex * samplesPerPixel + i;
+                const vec2 jitter = SamplerGet2D(pixel, n, SWS_SAMPLE_DIM_PIXEL) - 0.5f;
+                const vec2 uv = ((vec2(static_cast<float>(x), static_cast<float>(y)) + jitter) / bottomRight) * 2.0f - 1.0f;
+
+                vec3 origin, direction;
+                CameraRay(camera, uv, aspect, SamplerGet2D(pixel, n, SWS_SAMPLE_DIM_LENS), SamplerGet1D(pixel, n, SWS_SAMPLE_DIM_TIME), origin, direction);
+                queues.rays.Set(((y - startY) * tileWidth + (x - startX)) * samplesPerPixel + i, origin, direction, camera.nearFarFov.x, camera.nearFarFov.y);
+            }
+        }
+    }
+
+    // extend
+    RayPacket packet;
+    queues.hits.resize(numSamples);
+    for (uint32_t first = 0; first < numSamples; first += sPacketSize) {
+        this->LoadPacket(queues.rays, nullptr, first, std::min(sPacketSize, numSamples - first), packet);
+        this->IntersectPacket(scene, packet, false, &queues.hits[first], counters);
+    }
+
+    // shade, the ambient term is all a shadow ray could take away so only brighter hits queue one
+    const vec3 sceneMin = (scene.numTriangles > 0) ? scene.nodes[0].boundsMin : vec3(0.0f);
+    const vec3 sceneMax = (scene.numTriangles > 0) ? scene.nodes[0].boundsMax : vec3(1.0f);
+    const vec3 sceneInvExtent = 1.0f / glm::max(sceneMax - sceneMin, vec3(SWS_EPSILON));
+    queues.radiance.resize(numSamples);
+    queues.shadowRays.Resize(numSamples);
+    queues.shadowRadiance.resize(numSamples);
+    queues.shadowSamples.resize(numSamples);
+    queues.shadowKeys.resize(numSamples);
+    uint32_t numShadowRays = 0;
+    for (uint32_t sample = 0; sample < numSamples; ++sample) {
+        const Hit& hit = queues.hits[sample];
+        if (hit.triangle == ~0u) {
+            queues.radiance[sample] = sSkyColor;
+            continue;
+        }
+
+        const uint32_t faceIdx = scene.triangles[hit.triangle].face;
+        const Face& face = scene.faces[faceIdx];
+        const vec3 normal = normalize(scene.normals[face.a] * (1.0f - hit.u - hit.v) + scene.normals[face.b] * hit.u + scene.normals[face.c] * hit.v);
+        const vec3 albedo = vec3(scene.materials[scene.faceMatIDs[faceIdx]].diffuse);
+
+        const vec3 origin(queues.rays.originX[sample], queues.rays.originY[sample], queues.rays.originZ[sample]);
+        const vec3 direction(queues.rays.directionX[sample], queues.rays.directionY[sample], queues.rays.directionZ[sample]);
+        const vec3 hitPos = origin + direction * hit.t;
+        vec3 toLight = SWS_SUN_POS - hitPos;
+        const float toLightDist = length(toLight);
+        toLight /= toLightDist;
+
+        const float lambert = max(SWS_AMBIENT, dot(normal, toLight));
+        queues.radiance[sample] = albedo * SWS_AMBIENT;
+        if (lambert > SWS_AMBIENT) {
+            const vec3 shadowOrigin = hitPos + normal * SWS_SHADOW_RAY_OFFSET;
+            queues.shadowRays.Set(numShadowRays, shadowOrigin, toLight, SWS_EPSILON, toLightDist);
+            queues.shadowRadiance[numShadowRays] = albedo * lambert;
+            queues.shadowSamples[numShadowRays] = sample;
+            queues.shadowKeys[numShadowRays] = WavefrontSortKey(shadowOrigin, toLight, sceneMin, sceneInvExtent);
+            ++numShadowRays;
+        }
+    }
+
+    // sort, counting by WavefrontSortKey like wf_sort.glsl
+    uint32_t bucketOffsets[SWS_WF_SORT_BUCKETS] = { };
+    for (uint32_t i = 0; i < numShadowRays; ++i) {
+        ++bucketOffsets[queues.shadowKeys[i]];
+    }
+    uint32_t offset = 0;
+    for (uint32_t bucket = 0; bucket < SWS_WF_SORT_BUCKETS; ++bucket) {
+        const uint32_t count = bucketOffsets[bucket];
+        bucketOffsets[bucket] = offset;
+        offset += count;
+    }
+    queues.shadowOrder.resize(numShadowRays);
+    for (uint32_t i = 0; i < numShadowRays; ++i) {
+        queues.shadowOrder[bucketOffsets[queues.shadowKeys[i]]++] = i;
+    }
+
+    // connect
+    Hit shadowHits[sPacketSize];
+    for (uint32_t first = 0; first < numShadowRays; first += sPacketSize) {
+        const uint32_t count = std::min(sPacketSize, numShadowRays - first);
+        this->LoadPacket(queues.shadowRays, queues.shadowOrder.data(), first, count, packet);
+        this->IntersectPacket(scene, packet, true, shadowHits, counters);
+        for (uint32_t lane = 0; lane < count; ++lane) {
+            if (shadowHits[lane].triangle == ~0u) {
+                const uint32_t shadowRay = queues.shadowOrder[first + lane];
+                queues.radiance[queues.shadowSamples[shadowRay]] = queues.shadowRadiance[shadowRay];
+            }
+        }
+    }
+
+    // resolve
+    for (uint32_t y = startY; y < endY; ++y) {
+        for (uint32_t x = startX; x < endX; ++x) {
+            const uint32_t firstSample = ((y - startY) * tileWidth + (x - startX)) * samplesPerPixel;
+            vec3 color(0.0f);
+            for (uint32_t i = 0; i < samplesPerPixel; ++i) {
+                color += queues.radiance[firstSample + i];
+            }
+            output[(y - startY) * outputStride + (x - startX)] = color / static_cast<float>(samplesPerPixel);
+        }
+    }
+
+    mFetchCounters[workerIndex].nodes += counters.nodes;
+    mFetchCounters[workerIndex].triangles += counters.triangles;
+}
+
+void CpuTracer::Render(const CamData_s& camera, const uint32_t width, const uint32_t height, const uint32_t frameIndex, std::vector<vec3>& colors) {
+    Sampler::Init();
+    colors.resize(static_cast<size_t>(width) * height);
+
+    const uint32_t numTilesX = (width + sTileSize - 1) / sTileSize;
+    const uint32_t numTilesY = (height + sTileSize - 1) / sTileSize;
+    uint32_t gridSize = 1;
+    while (gridSize < std::max(numTilesX, numTilesY)) {
+        gridSize <<= 1;
+    }
+
+    // Every job halves its part of the curve and hands the back half out until one cell is left,
+    // so the biggest pieces are at the top of the deques where the thieves take from. The cells
+    // outside the image cost nothing.
+    std::function<void(uint32_t, uint32_t)> RenderCells = [&](uint32_t begin, uint32_t end) {
+        JobSystem::Counter counter;
+        while (end - begin > 1) {
+            const uint32_t mid = begin + (end - begin) / 2;
+            mJobSystem.Run(counter, [&RenderCells, mid, end]() {
+                RenderCells(mid, end);
+            });
+            end = mid;
+        }
+
+        uint32_t tileX, tileY;
+        HilbertToXY(gridSize, begin, tileX, tileY);
+        if (tileX < numTilesX && tileY < numTilesY) {
+            this->RenderTile(camera, tileX, tileY, width, height, frameIndex, &colors[(tileY * sTileSize) * width + tileX * sTileSize], width);
+        }
+        mJobSystem.Wait(counter);
+    };
+    RenderCells(0, gridSize * gridSize);
+}
+
+void CpuTracer::RenderTiles(const CamData_s& camera, const uint32_t width, const uint32_t height, const uint32_t frameIndex,
+                            const std::vector<uint32_t>& tiles, std::vector<vec3>& colors) {
+    Sampler::Init();
+    colors.assign(tiles.size() * sTileSize * sTileSize, vec3(0.0f));
+
+    // the tiles are usually a piece of Render's Hilbert order already, neighbours stay together
+    const uint32_t numTilesX = (width + sTileSize - 1) / sTileSize;
+    mJobSystem.ParallelFor(static_cast<uint32_t>(tiles.size()), 1, [&](const uint32_t begin, const uint32_t end) {
+        for (uint32_t i = begin; i < end; ++i) {
+            this->RenderTile(camera, tiles[i] % numTilesX, tiles[i] / numTilesX, width, height, frameIndex, &colors[i * sTileSize * sTileSize], sTileSize);
+        }
+    });
+}
+
+void CpuTracer::SetIntegrator(const CpuIntegrator integrator) {
+    mIntegrator = integrator;
+}
+
+uint32_t CpuTracer::GetTileSize() {
+    return sTileSize;
+}
+
+void CpuTracer::GetTileOrder(const uint32_t width, const uint32_t height, std::vector<uint32_t>& tiles) {
+    const uint32_t numTilesX = (width + sTileSize - 1) / sTileSize;
+    const uint32_t numTilesY = (height + sTileSize - 1) / sTileSize;
+    uint32_t gridSize = 1;
+    while (gridSize < std::max(numTilesX, numTilesY)) {
+        gridSize <<= 1;
+    }
+
+    tiles.clear();
+    for (uint32_t d = 0; d < gridSize * gridSize; ++d) {
+        uint32_t tileX, tileY;
+        HilbertToXY(gridSize, d, tileX, tileY);
+        if (tileX < numTilesX && tileY < numTilesY) {
+            tiles.push_back(tileY * numTilesX + tileX);
+        }
+    }
+}
+
+size_t CpuTracer::GetNumTriangles() const {
+    return mTriangles.size();
+}
+
+size_t CpuTracer::GetNumNodes() const {
+    return mNodes.size();
+}
+
+void CpuTracer::ResetFetchCounters() {
+    std::fill(mFetchCounters.begin(), mFetchCounters.end(), FetchCounters { });
+}
+
+std::vector<uint64_t> CpuTracer::GetFetchedBytesPerNode() const {
+    std::vector<uint64_t> bytes(std::max(mJobSystem.GetTopology().GetNumNodes(), 1u), 0);
+    for (uint32_t worker = 0; worker < static_cast<uint32_t>(mFetchCounters.size()); ++worker) {
+        const FetchCounters& counters = mFetchCounters[worker];
+        bytes[mJobSystem.GetWorkerNode(worker)] += counters.nodes * sizeof(BVHNode) + counters.triangles * sizeof(Triangle);
+    }
+    return bytes;
+}
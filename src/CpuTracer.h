@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+#include "framework/JobSystem.h"
+#include "framework/Numa.h"
+#include "GeometryLoader.h"
+#include "Sampler.h"
+
+// Traces GeometryLoader scenes on the CPU, for comparing against the Vulkan backend and for
+// machines without ray tracing hardware. Shades like the GPU integrators with shadows on,
+// without textures and with the plain sky color in place of the IBL.
+//
+// The BVH build and the frame are both split into jobs. A frame is cut into tiles visited along
+// a Hilbert curve: neighbouring tiles see neighbouring geometry, and the tiles of a slow region
+// end up spread over the queues of several workers instead of one.
+//
+// On a machine with several NUMA nodes what the traversal reads - nodes, triangles, normals,
+// faces and materials - can be spread over the nodes page by page or copied onto every node,
+// each worker then reading the copy of the node it was pinned to, see JobSystem.
+enum class CpuMemoryPlacement {
+    Default,        // wherever the allocator put it, usually the node of the thread that built it
+    Interleave,
+    Replicate,
+};
+
+// Recursive traces the samples of a tile one after the other. Wavefront runs the stages of the
+// GPU wavefront integrator over the queues of a tile - generate, extend, shade, sort and connect -
+// and the extend and connect stages trace packets of rays through the BVH together, each box and
+// triangle test done for every ray of the packet in one loop the compiler vectorizes.
+enum class CpuIntegrator {
+    Recursive,
+    Wavefront,
+};
+
+class CpuTracer {
+public:
+    explicit CpuTracer(JobSystem& jobSystem, const CpuMemoryPlacement placement = CpuMemoryPlacement::Default);
+    ~CpuTracer();
+
+    // copies the triangles out of the loader, the loader can go away afterwards
+    void        Build(GeometryLoader& loader);
+
+    // one frame into colors, width * height linear RGB values, row by row; samples per pixel and
+    // the sampler offset come from camera.sampling.x and frameIndex like on the GPU
+    void        Render(const CamData_s& camera, const uint32_t width, const uint32_t height, const uint32_t frameIndex, std::vector<vec3>& colors);
+    // Only the listed tiles of the frame, tile ty * tiles per row + tx covers the pixels from
+    // (tx, ty) * GetTileSize(). Tile i goes to colors[i * GetTileSize()^2 ...] row by row, the
+    // pixels outside the image are left black.
+    void        RenderTiles(const CamData_s& camera, const uint32_t width, const uint32_t height, const uint32_t frameIndex,
+                            const std::vector<uint32_t>& tiles, std::vector<vec3>& colors);
+
+    // the same image either way, see CpuIntegrator
+    void        SetIntegrator(const CpuIntegrator integrator);
+
+    static uint32_t GetTileSize();
+    // every tile of a width x height frame in the Hilbert order Render visits them
+    static void     GetTileOrder(const uint32_t width, const uint32_t height, std::vector<uint32_t>& tiles);
+
+    size_t      GetNumTriangles() const;
+    size_t      GetNumNodes() const;
+
+    // Bytes of scene data the workers of each NUMA node have read since the last reset. Counted
+    // in software per node and triangle fetched by the traversal, not by the memory controller,
+    // so cache hits are in there too and nothing tells which node served them; where the pages
+    // really went is in the kernel's counters, see NumaTopology::ReadCounters.
+    void        ResetFetchCounters();
+    std::vector<uint64_t> GetFetchedBytesPerNode() const;
+
+private:
+    struct BVHNode {
+        vec3        boundsMin;
+        uint32_t    first;      // first triangle of a leaf, left child of an inner node
+        vec3        boundsMax;
+        uint32_t    count;      // 0 for inner nodes, their right child follows the left one
+    };
+
+    // vertex 0 and the two edges leaving it, what the intersection test wants
+    struct Triangle {
+        vec3        v0;
+        vec3        e1;
+        vec3        e2;
+        uint32_t    face;       // into mFaces
+    };
+
+    struct Hit {
+        float       t;
+        float       u;
+        float       v;
+        uint32_t    triangle;
+    };
+
+    // where the traversal reads from, the vectors below or one of the placed copies
+    struct SceneData {
+        const BVHNode*      nodes;
+        const Triangle*     triangles;
+        uint32_t            numTriangles;
+        const vec3*         normals;
+        const Face*         faces;
+        const uint32_t*     faceMatIDs;
+        const Material_s*   materials;
+    };
+
+    // rays as a structure of arrays, what the packets are loaded from
+    struct RayStream {
+        std::vector<float>  originX, originY, originZ;
+        std::vector<float>  directionX, directionY, directionZ;
+        std::vector<float>  tmin, tmax;
+
+        void    Resize(const size_t count);
+        void    Set(const size_t i, const vec3& origin, const vec3& direction, const float rayTmin, const float rayTmax);
+    };
+
+    // up to a packet size of rays traversed together, see the .cpp
+    struct RayPacket;
+
+    // the wavefront queues of a worker, one entry per sample of the tile, reused from tile to tile
+    struct WavefrontQueues {
+        RayStream               rays;
+        std::vector<Hit>        hits;
+        std::vector<vec3>       radiance;
+        RayStream               shadowRays;
+        std::vector<vec3>       shadowRadiance;     // what the sample gets if the light is visible
+        std::vector<uint32_t>   shadowSamples;
+        std::vector<uint32_t>   shadowKeys;
+        std::vector<uint32_t>   shadowOrder;        // the shadow rays by key
+    };
+
+    // one cache line per worker, so the counting doesn't bounce lines between them
+    struct FetchCounters {
+        uint64_t    nodes;
+        uint64_t    triangles;
+        uint64_t    padding[6];
+    };
+
+    void        BuildNode(const uint32_t nodeIdx, const uint32_t depth, const uint32_t first, const uint32_t count, std::vector<uint32_t>& order,
+                          const std::vector<vec3>& centroids, const std::vector<vec3>& boundsMins, const std::vector<vec3>& boundsMaxs);
+    // copies the scene data into mPlacedData as asked by mPlacement and points mScenes at the copies
+    void        PlaceSceneData();
+    // closest hit in (tmin, tmax), any hit is enough for shadows
+    bool        Intersect(const SceneData& scene, const vec3& origin, const vec3& direction, const float tmin, const float tmax, const bool anyHit,
+                          Hit& hit, FetchCounters& counters) const;
+    // the first count rays of the packet from the stream, indices null for the rays from first on
+    void        LoadPacket(const RayStream& rays, const uint32_t* indices, const uint32_t first, const uint32_t count, RayPacket& packet) const;
+    // Intersect for every ray of the packet at once, hits[lane] for the lanes of the packet; a lane
+    // without a hit gets triangle ~0u, with anyHit the first hit found
+    void        IntersectPacket(const SceneData& scene, RayPacket& packet, const bool anyHit, Hit* hits, FetchCounters& counters) const;
+    vec3        TraceSample(const SceneData& scene, const vec3& origin, const vec3& direction, const float tmin, const float tmax, FetchCounters& counters) const;
+    // the pixel (tileX, tileY) * tile size goes to output[0], rows are outputStride apart
+    void        RenderTile(const CamData_s& camera, const uint32_t tileX, const uint32_t tileY, const uint32_t width, const uint32_t height,
+                           const uint32_t frameIndex, vec3* output, const uint32_t outputStride);
+    // RenderTile with the wavefront integrator
+    void        RenderTileWavefront(const CamData_s& camera, const uint32_t tileX, const uint32_t tileY, const uint32_t width, const uint32_t height,
+                                    const uint32_t frameIndex, vec3* output, const uint32_t outputStride);
+
+private:
+    JobSystem&                  mJobSystem;
+    CpuMemoryPlacement          mPlacement;
+    CpuIntegrator               mIntegrator;
+
+    std::vector<vec3>           mPositions;
+    std::vector<vec3>           mNormals;
+    std::vector<Face>           mFaces;         // vertex indices into the whole scene
+    std::vector<uint32_t>       mFaceMatIDs;
+    std::vector<Material_s>     mMaterials;
+
+    std::vector<Triangle>       mTriangles;     // in leaf order
+    std::vector<BVHNode>        mNodes;
+    std::atomic<uint32_t>       mNumNodes;
+
+    std::vector<NumaBuffer>     mPlacedData;    // one interleaved buffer or one per NUMA node
+    std::vector<SceneData>      mScenes;        // per NUMA node, all the same unless replicated
+    std::vector<FetchCounters>  mFetchCounters; // per worker
+    std::vector<WavefrontQueues> mWavefrontQueues; // per worker
+};
@@ -0,0 +1,621 @@
+#include "DistributedRender.h"
+#include "Camera.h"
+#include "CpuTracer.h"
+#include "GeometryLoader.h"
+#include "framework/JobSystem.h"
+#include "framework/Platform.h"
+#include "framework/Socket.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// a remote worker may be started before its coordinator
+static const uint32_t sConnectAttempts = 100;
+static const uint32_t sConnectRetryMs = 100;
+// anything bigger is a corrupt stream rather than a job
+static const uint32_t sMaxMessageSize = 1u << 30;
+// how often the coordinator looks for workers it started that died, while waiting for them
+static const uint32_t sProcessPollMs = 100;
+
+enum class RenderMessage : uint32_t {
+    Hello = 1,      // worker -> coordinator, RenderHello
+    Scene,          // coordinator -> worker, RenderScene and the scene path in UTF-8
+    Ready,          // worker -> coordinator, RenderReady
+    Job,            // coordinator -> worker, RenderJob and the tile indices
+    JobResult,      // worker -> coordinator, RenderJobResult and the summed tile colors
+    Quit,           // coordinator -> worker, nothing
+};
+
+struct RenderMessageHeader {
+    uint32_t    type;
+    uint32_t    size;
+};
+
+struct RenderHello {
+    uint32_t    numThreads;
+};
+
+struct RenderScene {
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    reorderGeometry;
+    uint32_t    pathLength;
+    CamData_s   camera;
+};
+
+struct RenderReady {
+    uint32_t    loaded;
+    uint32_t    loadedFromCache;
+    double      loadTime;
+    double      buildTime;
+};
+
+struct RenderJob {
+    uint32_t    firstPass;
+    uint32_t    numPasses;
+    uint32_t    numTiles;
+};
+
+struct RenderJobResult {
+    uint32_t    numTiles;
+    uint32_t    numPasses;
+    double      renderTime;
+};
+
+// a piece of the coordinator's queue, the tiles are a run of the Hilbert order
+struct RenderJobItem {
+    uint32_t    firstTile;
+    uint32_t    numTiles;
+    uint32_t    firstPass;
+    uint32_t    numPasses;
+};
+
+struct RenderWorkerStats {
+    uint32_t    numThreads;
+    bool        loadedFromCache;
+    bool        failed;
+    uint32_t    jobs;
+    uint32_t    tiles;
+    uint64_t    primaryRays;
+    double      loadTime;
+    double      busyTime;       // what the worker reported tracing
+    double      finishTime;     // since the coordinator started handing out jobs
+};
+
+static bool SendRenderMessage(Socket& socket, const RenderMessage type, const void* body, const size_t bodySize, const void* payload = nullptr, const size_t payloadSize = 0) {
+    const RenderMessageHeader header = { static_cast<uint32_t>(type), static_cast<uint32_t>(bodySize + payloadSize) };
+    return socket.Send(&header, sizeof(header)) && (bodySize == 0 || socket.Send(body, bodySize)) && (payloadSize == 0 || socket.Send(payload, payloadSize));
+}
+
+// the message of the expected type into body and what follows it into payload, the whole message within the timeout
+static bool ReceiveRenderMessage(Socket& socket, const RenderMessage type, void* body, const size_t bodySize, std::vector<uint8_t>* payload = nullptr,
+                                 const uint32_t timeoutMs = Socket::NoTimeout) {
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    auto RemainingMs = [&]() {
+        if (timeoutMs == Socket::NoTimeout) {
+            return Socket::NoTimeout;
+        }
+        const int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        return static_cast<uint32_t>(std::max<int64_t>(remaining, 0));
+    };
+
+    RenderMessageHeader header;
+    if (!socket.Receive(&header, sizeof(header), timeoutMs) || header.type != static_cast<uint32_t>(type) ||
+        header.size < bodySize || header.size > sMaxMessageSize || (payload == nullptr && header.size != bodySize)) {
+        return false;
+    }
+    if (bodySize > 0 && !socket.Receive(body, bodySize, RemainingMs())) {
+        return false;
+    }
+    if (payload != nullptr) {
+        payload->resize(header.size - bodySize);
+        return payload->empty() || socket.Receive(payload->data(), payload->size(), RemainingMs());
+    }
+    return true;
+}
+
+static std::wstring GetGeometryFolder() {
+    return Platform::GetExecutableFolder() + L"/_data/geometries/";
+}
+
+static std::wstring GetGeometryCacheFolder() {
+    return Platform::GetExecutableFolder() + L"/_data/cache/geometries/";
+}
+
+// the view Benchmark::RunCpu sets up, standing still
+static CamData_s MakeCamera(const DistributedRenderConfig& config) {
+    Camera camera;
+    camera.SetViewport({ 0, 0, static_cast<int>(config.width), static_cast<int>(config.height) });
+    camera.SetViewPlanes(0.01f, 5000.0f);
+    camera.SetFovY(45.0f);
+    camera.LookAt(config.cameraPosition, config.cameraTarget);
+    camera.SetLens(config.apertureRadius, config.focusDistance);
+
+    const float fovY = Deg2Rad(45.0f);
+    CamData_s camData;
+    camData.pos = camData.prevPos = vec4(camera.GetPosition(), 0.0f);
+    camData.dir = camData.prevDir = vec4(camera.GetDirection(), 0.0f);
+    camData.up = camData.prevUp = vec4(camera.GetUp(), 0.0f);
+    camData.side = camData.prevSide = vec4(camera.GetSide(), 0.0f);
+    camData.nearFarFov = vec4(0.01f, 5000.0f, fovY, RayConePixelSpread(fovY, static_cast<float>(config.height)));
+    camData.lens = vec4(camera.GetApertureRadius(), camera.GetFocusDistance(), camera.GetShutterOpen(), camera.GetShutterClose());
+    camData.sampling = uvec4(config.samplesPerPixel, 0, 0, 0);
+    return camData;
+}
+
+// portable float map, linear RGB with the bottom row first
+static bool WritePFM(const std::wstring& fileName, const uint32_t width, const uint32_t height, const std::vector<vec3>& colors) {
+    FILE* file = Platform::OpenFile(fileName, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bool written = fprintf(file, "PF\n%u %u\n-1.0\n", width, height) > 0;
+    for (uint32_t y = height; y > 0 && written; --y) {
+        written = fwrite(&colors[static_cast<size_t>(y - 1) * width], sizeof(vec3), width, file) == width;
+    }
+    return (fclose(file) == 0) && written;
+}
+
+DistributedRenderConfig::DistributedRenderConfig()
+    : width(1920)
+    , height(1080)
+    , samplesPerPixel(1)
+    , passes(16)
+    , reorderGeometry(true)
+    , cameraPosition(155.15f, 297.802f, 0.0f)
+    , cameraTarget(8.0f, 20.0f, -250.0f)
+    , apertureRadius(0.0f)
+    , focusDistance(100.0f)
+    , localWorkers(std::max(std::thread::hardware_concurrency(), 1u))
+    , remoteWorkers(0)
+    , threadsPerWorker(1)
+    , listenAddress("127.0.0.1")
+    , listenPort(0)
+    , workerTimeout(300)
+    , tilesPerJob(64)
+    , passesPerJob(0)
+    , outputName(L"distributed_render")
+{
+}
+
+bool DistributedRenderConfig::LoadFromFile(const std::wstring& fileName, std::string& error) {
+    std::ifstream file(Platform::ToNativePath(fileName));
+    if (!file.is_open()) {
+        error = "can't open the config file";
+        return false;
+    }
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+
+        std::istringstream stream(line);
+        std::string key;
+        if (!(stream >> key)) {
+            continue;
+        }
+
+        bool valid = true;
+        if (key == "scene") {
+            std::string path;
+            valid = !!(stream >> path);
+            scene = std::wstring(path.begin(), path.end());
+        } else if (key == "resolution") {
+            valid = (stream >> width >> height) && width > 0 && height > 0;
+        } else if (key == "spp") {
+            valid = (stream >> samplesPerPixel) && samplesPerPixel > 0;
+        } else if (key == "passes") {
+            valid = (stream >> passes) && passes > 0;
+        } else if (key == "geometry_order") {
+            std::string order;
+            valid = (stream >> order) && (order == "morton" || order == "file");
+            reorderGeometry = (order != "file");
+        } else if (key == "camera") {
+            valid = !!(stream >> cameraPosition.x >> cameraPosition.y >> cameraPosition.z >> cameraTarget.x >> cameraTarget.y >> cameraTarget.z);
+        } else if (key == "lens") {
+            valid = (stream >> apertureRadius >> focusDistance) && apertureRadius >= 0.0f && focusDistance > 0.0f;
+        } else if (key == "workers") {
+            valid = !!(stream >> localWorkers);
+        } else if (key == "remote_workers") {
+            valid = !!(stream >> remoteWorkers);
+        } else if (key == "threads") {
+            valid = !!(stream >> threadsPerWorker);
+        } else if (key == "listen") {
+            valid = !!(stream >> listenAddress >> listenPort);
+        } else if (key == "worker_timeout") {
+            valid = (stream >> workerTimeout) && workerTimeout > 0;
+        } else if (key == "tiles_per_job") {
+            valid = (stream >> tilesPerJob) && tilesPerJob > 0;
+        } else if (key == "passes_per_job") {
+            valid = (stream >> passesPerJob) && passesPerJob > 0;
+        } else if (key == "output") {
+            std::string output;
+            valid = !!(stream >> output);
+            outputName = std::wstring(output.begin(), output.end());
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            error = "line " + std::to_string(lineNumber) + ": can't parse \"" + line + "\"";
+            return false;
+        }
+    }
+
+    if (scene.empty()) {
+        error = "no scene given";
+        return false;
+    }
+    if (localWorkers + remoteWorkers == 0) {
+        error = "no workers";
+        return false;
+    }
+    if (passesPerJob == 0 || passesPerJob > passes) {
+        passesPerJob = passes;
+    }
+    return true;
+}
+
+int DistributedRender::RunCoordinator(const std::wstring& configFileName) {
+    using Clock = std::chrono::steady_clock;
+    auto MillisecondsSince = [](const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    DistributedRenderConfig config;
+    std::string error;
+    if (!config.LoadFromFile(configFileName, error)) {
+        std::cerr << "Distributed render config: " << error << "\n";
+        return 1;
+    }
+
+    // parsed once here, the workers all find it in the cache then instead of parsing it at once
+    const std::wstring scenePath = GetGeometryFolder() + config.scene;
+    {
+        const Clock::time_point loadStart = Clock::now();
+        GeometryLoader loader;
+        loader.SetReorderEnabled(config.reorderGeometry);
+        loader.SetCacheFolder(GetGeometryCacheFolder());
+        if (!loader.LoadFromOBJ(scenePath)) {
+            std::cerr << "Distributed render: can't load " << std::string(config.scene.begin(), config.scene.end()) << "\n";
+            return 1;
+        }
+        std::cout << std::fixed << std::setprecision(3) << "Distributed render: scene " << (loader.WasLoadedFromCache() ? "cached" : "parsed and cached")
+                  << " in " << MillisecondsSince(loadStart) << " ms\n";
+    }
+
+    Socket listener;
+    if (!listener.Listen(config.listenAddress, config.listenPort)) {
+        std::cerr << "Distributed render: can't listen on " << config.listenAddress << ":" << config.listenPort << "\n";
+        return 1;
+    }
+    const uint16_t port = listener.GetLocalPort();
+    std::cout << "Distributed render: listening on " << config.listenAddress << ":" << port << "\n";
+
+    std::vector<uint64_t> processes;
+    const std::string workerAddress = (config.listenAddress.empty() || config.listenAddress == "0.0.0.0") ? "127.0.0.1" : config.listenAddress;
+    for (uint32_t i = 0; i < config.localWorkers; ++i) {
+        const uint64_t process = Platform::StartProcess(Platform::GetExecutablePath(),
+            { "--render-worker", workerAddress, std::to_string(port), std::to_string(config.threadsPerWorker) });
+        if (process == 0) {
+            std::cerr << "Distributed render: can't start worker " << i << "\n";
+            continue;
+        }
+        processes.push_back(process);
+    }
+
+    // a worker started here that exits first will never connect, a remote one gets the whole timeout
+    const uint32_t timeoutMs = config.workerTimeout * 1000;
+    const Clock::time_point connectDeadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    size_t numExpected = processes.size() + config.remoteWorkers;
+    std::vector<Socket> connections;
+    while (connections.size() < numExpected && Clock::now() < connectDeadline) {
+        Socket connection;
+        if (listener.Accept(connection, sProcessPollMs)) {
+            connections.push_back(std::move(connection));
+            continue;
+        }
+
+        for (auto process = processes.begin(); process != processes.end(); ) {
+            int exitCode = 0;
+            if (Platform::HasProcessEnded(*process, exitCode)) {
+                std::cerr << "Distributed render: a worker exited with " << exitCode << " before it connected\n";
+                process = processes.erase(process);
+                --numExpected;
+            } else {
+                ++process;
+            }
+        }
+    }
+    listener.Close();
+
+    if (connections.empty()) {
+        std::cerr << "Distributed render: no worker connected\n";
+        return 1;
+    }
+    if (connections.size() < numExpected) {
+        std::cerr << "Distributed render: " << connections.size() << " of " << numExpected << " workers connected in time, going on without the others\n";
+    }
+    const size_t numWorkers = connections.size();
+
+    // the whole frame's tiles in Hilbert order, cut into runs times pass ranges
+    std::vector<uint32_t> tileOrder;
+    CpuTracer::GetTileOrder(config.width, config.height, tileOrder);
+    std::deque<RenderJobItem> queue;
+    for (uint32_t firstTile = 0; firstTile < tileOrder.size(); firstTile += config.tilesPerJob) {
+        for (uint32_t firstPass = 0; firstPass < config.passes; firstPass += config.passesPerJob) {
+            queue.push_back({ firstTile, std::min(config.tilesPerJob, static_cast<uint32_t>(tileOrder.size()) - firstTile),
+                              firstPass, std::min(config.passesPerJob, config.passes - firstPass) });
+        }
+    }
+
+    const uint32_t tileSize = CpuTracer::GetTileSize();
+    const uint32_t numTilesX = (config.width + tileSize - 1) / tileSize;
+    std::vector<vec3> accumulation(static_cast<size_t>(config.width) * config.height, vec3(0.0f));
+    std::vector<float> weights(accumulation.size(), 0.0f);
+    // jobs handed out and not returned yet, one of them may still come back to the queue
+    uint32_t numInProgress = 0;
+    std::mutex mutex;
+    std::condition_variable jobsChanged;
+
+    const CamData_s camera = MakeCamera(config);
+    const std::string scenePathUtf8(config.scene.begin(), config.scene.end());
+    std::vector<RenderWorkerStats> stats(numWorkers, RenderWorkerStats { });
+
+    const Clock::time_point renderStart = Clock::now();
+    auto ServeWorker = [&](const size_t workerIdx) {
+        Socket& connection = connections[workerIdx];
+        RenderWorkerStats& workerStats = stats[workerIdx];
+        workerStats.failed = true;
+
+        RenderHello hello;
+        RenderScene scene = { config.width, config.height, config.reorderGeometry ? 1u : 0u, static_cast<uint32_t>(scenePathUtf8.size()), camera };
+        RenderReady ready;
+        if (!ReceiveRenderMessage(connection, RenderMessage::Hello, &hello, sizeof(hello), nullptr, timeoutMs) ||
+            !SendRenderMessage(connection, RenderMessage::Scene, &scene, sizeof(scene), scenePathUtf8.data(), scenePathUtf8.size()) ||
+            !ReceiveRenderMessage(connection, RenderMessage::Ready, &ready, sizeof(ready), nullptr, timeoutMs) || !ready.loaded) {
+            connection.Close();
+            return;
+        }
+        workerStats.numThreads = hello.numThreads;
+        workerStats.loadedFromCache = ready.loadedFromCache != 0;
+        workerStats.loadTime = ready.loadTime + ready.buildTime;
+
+        std::vector<uint32_t> tiles;
+        std::vector<uint8_t> payload;
+        for (;;) {
+            RenderJobItem item;
+            {
+                // an empty queue is only the end once no other worker can fail and hand its job back
+                std::unique_lock<std::mutex> lock(mutex);
+                jobsChanged.wait(lock, [&]() { return !queue.empty() || numInProgress == 0; });
+                if (queue.empty()) {
+                    break;
+                }
+                item = queue.front();
+                queue.pop_front();
+                ++numInProgress;
+            }
+
+            tiles.assign(tileOrder.begin() + item.firstTile, tileOrder.begin() + item.firstTile + item.numTiles);
+            const RenderJob job = { item.firstPass, item.numPasses, item.numTiles };
+            RenderJobResult result;
+            const size_t expectedSize = static_cast<size_t>(item.numTiles) * tileSize * tileSize * sizeof(vec3);
+            if (!SendRenderMessage(connection, RenderMessage::Job, &job, sizeof(job), tiles.data(), tiles.size() * sizeof(uint32_t)) ||
+                !ReceiveRenderMessage(connection, RenderMessage::JobResult, &result, sizeof(result), &payload, timeoutMs) ||
+                result.numTiles != item.numTiles || payload.size() != expectedSize) {
+                // someone else gets the job, this worker is done; a late one finds the connection closed
+                connection.Close();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    queue.push_back(item);
+                    --numInProgress;
+                }
+                jobsChanged.notify_all();
+                return;
+            }
+
+            // the worker sent the sums over its passes, the weights keep track of how many were added
+            const vec3* colors = reinterpret_cast<const vec3*>(payload.data());
+            uint64_t primaryRays = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (uint32_t i = 0; i < item.numTiles; ++i) {
+                    const uint32_t startX = (tiles[i] % numTilesX) * tileSize;
+                    const uint32_t startY = (tiles[i] / numTilesX) * tileSize;
+                    const uint32_t endX = std::min(startX + tileSize, config.width);
+                    const uint32_t endY = std::min(startY + tileSize, config.height);
+                    for (uint32_t y = startY; y < endY; ++y) {
+                        for (uint32_t x = startX; x < endX; ++x) {
+                            const size_t pixel = static_cast<size_t>(y) * config.width + x;
+                            accumulation[pixel] += colors[(i * tileSize + (y - startY)) * tileSize + (x - startX)];
+                            weights[pixel] += static_cast<float>(item.numPasses);
+                        }
+                    }
+                    primaryRays += static_cast<uint64_t>(endX - startX) * (endY - startY) * config.samplesPerPixel * item.numPasses;
+                }
+                --numInProgress;
+            }
+            jobsChanged.notify_all();
+
+            ++workerStats.jobs;
+            workerStats.tiles += item.numTiles;
+            workerStats.primaryRays += primaryRays;
+            workerStats.busyTime += result.renderTime;
+            workerStats.finishTime = MillisecondsSince(renderStart);
+        }
+
+        SendRenderMessage(connection, RenderMessage::Quit, nullptr, 0);
+        workerStats.failed = false;
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numWorkers; ++i) {
+        threads.push_back(std::thread(ServeWorker, i));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const double renderTime = MillisecondsSince(renderStart);
+
+    // closed, a worker still tracing a job it timed out on fails to send it and exits
+    connections.clear();
+    const Clock::time_point exitDeadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!processes.empty()) {
+        int exitCode = 0;
+        if (Platform::HasProcessEnded(processes.back(), exitCode)) {
+            processes.pop_back();
+        } else if (Clock::now() < exitDeadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(sProcessPollMs));
+        } else {
+            std::cerr << "Distributed render: " << processes.size() << " workers still running, left behind\n";
+            break;
+        }
+    }
+
+    if (!queue.empty()) {
+        std::cerr << "Distributed render: " << queue.size() << " jobs left over, the workers that could have taken them failed\n";
+        return 1;
+    }
+
+    // load imbalance: how long the busiest worker traced against the average, and how long the
+    // first one to run dry waited for the last
+    double maxBusy = 0.0, sumBusy = 0.0, firstFinish = renderTime, lastFinish = 0.0;
+    uint64_t totalRays = 0;
+    uint32_t numServing = 0;
+    std::cout << std::fixed << std::setprecision(3) << "Distributed render: " << config.width << "x" << config.height << ", "
+              << config.samplesPerPixel << " spp x " << config.passes << " passes, " << numWorkers << " workers, " << renderTime << " ms\n";
+    for (size_t i = 0; i < numWorkers; ++i) {
+        const RenderWorkerStats& workerStats = stats[i];
+        std::cout << "  worker " << i << ": ";
+        if (workerStats.failed) {
+            std::cout << "failed after " << workerStats.jobs << " jobs\n";
+        } else {
+            std::cout << workerStats.numThreads << " threads, scene " << (workerStats.loadedFromCache ? "from the cache" : "parsed") << " and built in "
+                      << workerStats.loadTime << " ms, " << workerStats.jobs << " jobs, " << workerStats.tiles << " tiles, busy "
+                      << workerStats.busyTime << " ms, " << ((workerStats.busyTime > 0.0) ? workerStats.primaryRays / (workerStats.busyTime * 1000.0) : 0.0)
+                      << " Mrays/s, done at " << workerStats.finishTime << " ms\n";
+        }
+        if (!workerStats.failed && workerStats.jobs > 0) {
+            maxBusy = std::max(maxBusy, workerStats.busyTime);
+            sumBusy += workerStats.busyTime;
+            firstFinish = std::min(firstFinish, workerStats.finishTime);
+            lastFinish = std::max(lastFinish, workerStats.finishTime);
+            ++numServing;
+        }
+        totalRays += workerStats.primaryRays;
+    }
+    const double meanBusy = numServing ? sumBusy / numServing : 0.0;
+    std::cout << "  total " << ((renderTime > 0.0) ? totalRays / (renderTime * 1000.0) : 0.0) << " Mrays/s, load imbalance "
+              << ((meanBusy > 0.0) ? maxBusy / meanBusy : 0.0) << " (busiest / mean busy), " << (lastFinish - firstFinish) << " ms between the first and last worker running dry\n";
+
+    for (size_t i = 0; i < accumulation.size(); ++i) {
+        accumulation[i] = (weights[i] > 0.0f) ? accumulation[i] / weights[i] : vec3(0.0f);
+    }
+    const std::wstring outputPath = Platform::GetExecutableFolder() + L"/" + config.outputName + L".pfm";
+    if (!WritePFM(outputPath, config.width, config.height, accumulation)) {
+        std::cerr << "Distributed render: failed to write the image\n";
+        return 1;
+    }
+    return 0;
+}
+
+int DistributedRender::RunWorker(const std::string& address, const uint16_t port, const uint32_t numThreads) {
+    using Clock = std::chrono::steady_clock;
+    auto MillisecondsSince = [](const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    Socket connection;
+    for (uint32_t attempt = 0; attempt < sConnectAttempts && !connection.Connect(address, port); ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(sConnectRetryMs));
+    }
+    if (!connection.IsOpen()) {
+        std::cerr << "Render worker: can't connect to " << address << ":" << port << "\n";
+        return 1;
+    }
+
+    JobSystem jobSystem(numThreads);
+    const RenderHello hello = { jobSystem.GetNumThreads() };
+    RenderScene scene;
+    std::vector<uint8_t> scenePath;
+    if (!SendRenderMessage(connection, RenderMessage::Hello, &hello, sizeof(hello)) ||
+        !ReceiveRenderMessage(connection, RenderMessage::Scene, &scene, sizeof(scene), &scenePath) || scenePath.size() != scene.pathLength) {
+        std::cerr << "Render worker: the coordinator sent no scene\n";
+        return 1;
+    }
+
+    RenderReady ready = { };
+    const Clock::time_point loadStart = Clock::now();
+    GeometryLoader loader;
+    loader.SetReorderEnabled(scene.reorderGeometry != 0);
+    loader.SetCacheFolder(GetGeometryCacheFolder());
+    ready.loaded = loader.LoadFromOBJ(GetGeometryFolder() + std::wstring(scenePath.begin(), scenePath.end())) ? 1 : 0;
+    ready.loadedFromCache = loader.WasLoadedFromCache() ? 1 : 0;
+    ready.loadTime = MillisecondsSince(loadStart);
+
+    const Clock::time_point buildStart = Clock::now();
+    CpuTracer tracer(jobSystem);
+    if (ready.loaded) {
+        tracer.Build(loader);
+    }
+    ready.buildTime = MillisecondsSince(buildStart);
+    if (!SendRenderMessage(connection, RenderMessage::Ready, &ready, sizeof(ready)) || !ready.loaded) {
+        return 1;
+    }
+
+    std::vector<uint8_t> payload;
+    std::vector<uint32_t> tiles;
+    std::vector<vec3> colors, sums;
+    for (;;) {
+        RenderMessageHeader header;
+        if (!connection.Receive(&header, sizeof(header))) {
+            return 1;
+        }
+        if (header.type == static_cast<uint32_t>(RenderMessage::Quit)) {
+            return 0;
+        }
+
+        RenderJob job;
+        if (header.type != static_cast<uint32_t>(RenderMessage::Job) || header.size < sizeof(job) || header.size > sMaxMessageSize ||
+            !connection.Receive(&job, sizeof(job)) || header.size - sizeof(job) != job.numTiles * sizeof(uint32_t)) {
+            std::cerr << "Render worker: unexpected message\n";
+            return 1;
+        }
+        tiles.resize(job.numTiles);
+        if (!tiles.empty() && !connection.Receive(tiles.data(), tiles.size() * sizeof(uint32_t))) {
+            return 1;
+        }
+
+        // passes are averages of their frame, the coordinator divides the sum by the pass count
+        const Clock::time_point renderStart = Clock::now();
+        sums.assign(tiles.size() * CpuTracer::GetTileSize() * CpuTracer::GetTileSize(), vec3(0.0f));
+        for (uint32_t pass = job.firstPass; pass < job.firstPass + job.numPasses; ++pass) {
+            tracer.RenderTiles(scene.camera, scene.width, scene.height, pass, tiles, colors);
+            for (size_t i = 0; i < sums.size(); ++i) {
+                sums[i] += colors[i];
+            }
+        }
+
+        const RenderJobResult result = { job.numTiles, job.numPasses, MillisecondsSince(renderStart) };
+        if (!SendRenderMessage(connection, RenderMessage::JobResult, &result, sizeof(result), sums.data(), sums.size() * sizeof(vec3))) {
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "shared_with_shaders.h"
+
+// Parsed from a plain text file like the benchmark config, one setting per line, '#' starts a comment:
+//   scene OrganodronCity/Organodron_City.obj   (relative to the geometry folder)
+//   resolution 7680 4320
+//   spp 4                                      (samples per pixel and pass)
+//   passes 16                                  (accumulated, each with the sampler offset of its frame index)
+//   geometry_order morton                      (morton or file)
+//   camera 155.15 297.8 0.0  8.0 20.0 -250.0   (position, target)
+//   lens 2.0 300.0                             (aperture radius, focus distance; pinhole by default)
+//   workers 4                                  (worker processes started on this machine, one per hardware thread by default)
+//   remote_workers 0                           (more to wait for, started by hand with --render-worker)
+//   threads 1                                  (per worker, 0 is every hardware thread; 1 by default)
+//   listen 127.0.0.1 0                         (address and port for the workers, 0 picks a free port)
+//   worker_timeout 300                         (seconds a worker has to connect, load the scene or return a job
+//                                               before it counts as failed and its job goes to another one)
+//   tiles_per_job 64
+//   passes_per_job 4                           (fewer than passes splits a tile's passes over several jobs; all by default)
+//   output still                               (.pfm is appended)
+struct DistributedRenderConfig {
+    DistributedRenderConfig();
+
+    bool LoadFromFile(const std::wstring& fileName, std::string& error);
+
+    std::wstring    scene;
+    uint32_t        width;
+    uint32_t        height;
+    uint32_t        samplesPerPixel;
+    uint32_t        passes;
+    bool            reorderGeometry;
+    vec3            cameraPosition;
+    vec3            cameraTarget;
+    float           apertureRadius;
+    float           focusDistance;
+    uint32_t        localWorkers;
+    uint32_t        remoteWorkers;
+    uint32_t        threadsPerWorker;
+    std::string     listenAddress;
+    uint16_t        listenPort;
+    uint32_t        workerTimeout;
+    uint32_t        tilesPerJob;
+    uint32_t        passesPerJob;
+    std::wstring    outputName;
+};
+
+// One still rendered by several processes. The coordinator cuts the frame into jobs - a run of
+// CpuTracer tiles along the Hilbert curve times a range of passes - and hands them out over TCP
+// to whichever worker asks next. Every worker loads the scene through the GeometryLoader cache,
+// which the coordinator fills before starting them, and traces its jobs with CpuTracer on all of
+// its threads. The returned tiles are added into the coordinator's accumulation buffer, weighted
+// by their pass count, so tiles split over several workers merge like passes of one.
+//
+// Only the CPU backend takes part, vkTracer traces whole frames and has no way to trace a tile list.
+class DistributedRender {
+public:
+    // Renders the config's still, writes it next to the executable, prints the per worker
+    // throughput and the load imbalance and returns the process exit code
+    static int RunCoordinator(const std::wstring& configFileName);
+    // Serves one coordinator until it says quit or goes away, returns the process exit code
+    static int RunWorker(const std::string& address, const uint16_t port, const uint32_t numThreads);
+};
@@ -1,17 +1,105 @@
 #include "GeometryLoader.h"
+#include "MeshSimplifier.h"
+#include "framework/Hash.h"
+#include "framework/JobSystem.h"
+#include "framework/MappedFile.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
 #include <locale>
 #include <codecvt>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+
+// .vkgeo layout: header, a size entry per mesh, the page table, the level of detail table (per
+// mesh a count and a size entry per level), then every mesh's positions, normals, uvs, faces and
+// material IDs, the levels of detail laid out the same way, the materials, and the texture paths
+// as a length and UTF-8 bytes each. The tables come first so a paged load never touches the mesh
+// data.
+static const uint32_t sGeometryCacheMagic = 0x4F474B56; // "VKGO"
+static const uint32_t sGeometryCacheVersion = 4;
+// small enough that a page's BLAS builds within a frame, big enough to keep the TLAS short
+static const uint32_t sGeometryPageMaxFaces = 64 * 1024;
+// below this a level of detail saves less than its instance costs
+static const size_t sLodMinFaces = 64;
+// more than this many levels per mesh in a cache file means it's broken
+static const uint32_t sLodMaxLevels = 32;
+
+struct GeometryCacheHeader {
+    uint32_t    magic;
+    uint32_t    version;
+    uint64_t    key;
+    uint32_t    numMeshes;
+    uint32_t    numMaterials;
+    uint32_t    numTextures;
+    uint32_t    numPages;
+    double      fileOrderVertexMissRatio;
+    double      vertexMissRatio;
+};
+
+struct GeometryCacheMeshEntry {
+    uint32_t    numVertices;
+    uint32_t    numFaces;
+};
+
+struct ObjCornerHash {
+    size_t operator()(const tinyobj::index_t& i) const {
+        return static_cast<size_t>(HashValue(i));
+    }
+};
+
+struct ObjCornerEqual {
+    bool operator()(const tinyobj::index_t& a, const tinyobj::index_t& b) const {
+        return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+    }
+};
 
 inline std::string UnicodeToUtf8(const std::wstring & _unicode) {
     std::wstring_convert<std::codecvt_utf8<std::wstring::value_type>, std::wstring::value_type> convert;
     return std::move(convert.to_bytes(_unicode));
 }
 
-GeometryLoader::GeometryLoader() {
+inline std::wstring Utf8ToUnicode(const std::string & _utf8) {
+    std::wstring_convert<std::codecvt_utf8<std::wstring::value_type>, std::wstring::value_type> convert;
+    return std::move(convert.from_bytes(_utf8));
+}
+
+// 10 bits per axis of a point normalized to the bounds
+static uint32_t MortonCode(const vec3& p, const vec3& boundsMin, const vec3& boundsInvExtent) {
+    auto ExpandBits = [](const float v) -> uint32_t {
+        uint32_t x = static_cast<uint32_t>(clamp(v * 1024.0f, 0.0f, 1023.0f));
+        x = (x * 0x00010001u) & 0xFF0000FFu;
+        x = (x * 0x00000101u) & 0x0F00F00Fu;
+        x = (x * 0x00000011u) & 0xC30C30C3u;
+        x = (x * 0x00000005u) & 0x49249249u;
+        return x;
+    };
+
+    const vec3 n = (p - boundsMin) * boundsInvExtent;
+    return (ExpandBits(n.x) << 2) | (ExpandBits(n.y) << 1) | ExpandBits(n.z);
+}
+
+static vec3 FaceCentroid(const Mesh& mesh, const Face& face) {
+    return (mesh.positions[face.a] + mesh.positions[face.b] + mesh.positions[face.c]) * (1.0f / 3.0f);
+}
+
+static vec3 InvExtent(const vec3& boundsMin, const vec3& boundsMax) {
+    const vec3 extent = boundsMax - boundsMin;
+    return vec3(1.0f / max(extent.x, SWS_EPSILON), 1.0f / max(extent.y, SWS_EPSILON), 1.0f / max(extent.z, SWS_EPSILON));
+}
+
+GeometryLoader::GeometryLoader()
+    : mReorderEnabled(true)
+    , mLodLevels(0)
+    , mJobSystem(nullptr)
+    , mLoadedFromCache(false)
+    , mPagingEnabled(false)
+    , mFileOrderVertexMissRatio(0.0)
+    , mVertexMissRatio(0.0)
+{
 
 }
 GeometryLoader::~GeometryLoader() {
@@ -19,6 +107,20 @@ GeometryLoader::~GeometryLoader() {
 }
 
 bool GeometryLoader::LoadFromOBJ(const std::wstring& fileName) {
+    mLoadedFromCache = false;
+    mPagedFile.reset();
+    mPagedMeshes.clear();
+    std::wstring cacheFilePath;
+    uint64_t cacheKey = 0;
+    if (!mCacheFolder.empty()) {
+        cacheKey = this->ComputeCacheKey(fileName);
+        cacheFilePath = this->GetCacheFilePath(cacheKey);
+        if (this->ReadCacheFile(cacheFilePath, cacheKey)) {
+            mLoadedFromCache = true;
+            return true;
+        }
+    }
+
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -42,34 +144,48 @@ bool GeometryLoader::LoadFromOBJ(const std::wstring& fileName) {
             const size_t numFaces = shape.mesh.num_face_vertices.size();
             mesh.faces.resize(numFaces);
             mesh.materialIDs.resize(numFaces);
-            mesh.positions.resize(numFaces * 3);
-            mesh.normals.resize(numFaces * 3);
-            mesh.uvs.resize(numFaces * 3);
+            mesh.positions.reserve(numFaces * 3);
+            mesh.normals.reserve(numFaces * 3);
+            mesh.uvs.reserve(numFaces * 3);
+
+            // corners with the same position, normal and uv indices are one vertex, numbered in first use order
+            std::unordered_map<tinyobj::index_t, uint32_t, ObjCornerHash, ObjCornerEqual> vertexMap;
+            vertexMap.reserve(numFaces * 3);
 
             size_t vIdx = 0;
             for (size_t f = 0; f < numFaces; ++f) {
                 assert(shape.mesh.num_face_vertices[f] == 3);
+                uint32_t corners[3];
                 for (size_t j = 0; j < 3; ++j, ++vIdx) {
                     const tinyobj::index_t& i = shape.mesh.indices[vIdx];
+                    const auto inserted = vertexMap.insert(std::make_pair(i, static_cast<uint32_t>(mesh.positions.size())));
+                    corners[j] = inserted.first->second;
+                    if (!inserted.second) {
+                        continue;
+                    }
 
-                    vec3& pos = mesh.positions[vIdx];
-                    vec3& normal = mesh.normals[vIdx];
-                    vec2& uv = mesh.uvs[vIdx];
-
+                    vec3 pos, normal;
+                    vec2 uv(0.0f);
                     pos.x = attrib.vertices[3 * i.vertex_index + 0];
                     pos.y = attrib.vertices[3 * i.vertex_index + 1];
                     pos.z = attrib.vertices[3 * i.vertex_index + 2];
                     normal.x = attrib.normals[3 * i.normal_index + 0];
                     normal.y = attrib.normals[3 * i.normal_index + 1];
                     normal.z = attrib.normals[3 * i.normal_index + 2];
-                    uv.x = attrib.texcoords[2 * i.texcoord_index + 0];
-                    uv.y = attrib.texcoords[2 * i.texcoord_index + 1];
+                    if (i.texcoord_index >= 0) {
+                        // OBJ has v pointing up, images are stored top row first
+                        uv.x = attrib.texcoords[2 * i.texcoord_index + 0];
+                        uv.y = 1.0f - attrib.texcoords[2 * i.texcoord_index + 1];
+                    }
+                    mesh.positions.push_back(pos);
+                    mesh.normals.push_back(normal);
+                    mesh.uvs.push_back(uv);
                 }
 
                 Face& face = mesh.faces[f];
-                face.a = static_cast<uint32_t>(3 * f + 0);
-                face.b = static_cast<uint32_t>(3 * f + 1);
-                face.c = static_cast<uint32_t>(3 * f + 2);
+                face.a = corners[0];
+                face.b = corners[1];
+                face.c = corners[2];
 
                 mesh.materialIDs[f] = static_cast<uint32_t>(shape.mesh.material_ids[f]);
             }
@@ -90,12 +206,536 @@ bool GeometryLoader::LoadFromOBJ(const std::wstring& fileName) {
             dstMat.emission.y = srcMat.emission[1];
             dstMat.emission.z = srcMat.emission[2];
             dstMat.emission.w = 1.0f;
+
+            dstMat.textures = uvec4(SWS_INVALID_TEXTURE);
+            if (!srcMat.diffuse_texname.empty()) {
+                dstMat.textures.x = this->RegisterTexture(baseDir, srcMat.diffuse_texname);
+            }
+        }
+
+        mFileOrderVertexMissRatio = this->EstimateVertexMissRatio();
+        if (mReorderEnabled) {
+            this->ReorderMeshes();
+        }
+        mVertexMissRatio = mReorderEnabled ? this->EstimateVertexMissRatio() : mFileOrderVertexMissRatio;
+        this->BuildPages();
+        this->BuildLods();
+
+        if (!cacheFilePath.empty() && !this->WriteCacheFile(cacheFilePath, cacheKey)) {
+            std::cerr << "GeometryLoader: can't write " << std::string(cacheFilePath.begin(), cacheFilePath.end()) << "\n";
+        } else if (mPagingEnabled && !cacheFilePath.empty()) {
+            // swaps the parsed meshes for the file just written
+            this->ReadCacheFile(cacheFilePath, cacheKey);
         }
     }
 
     return result;
 }
 
+void GeometryLoader::SetReorderEnabled(const bool enabled) {
+    mReorderEnabled = enabled;
+}
+
+void GeometryLoader::SetLodLevels(const uint32_t levels) {
+    mLodLevels = levels;
+}
+
+void GeometryLoader::SetJobSystem(JobSystem* jobSystem) {
+    mJobSystem = jobSystem;
+}
+
+size_t GeometryLoader::GetNumLods(const size_t meshIdx) const {
+    return 1 + (meshIdx < mLodChains.size() ? mLodChains[meshIdx].size() : 0);
+}
+
+const Mesh& GeometryLoader::GetLod(const size_t meshIdx, const size_t lod) const {
+    return lod ? mLodChains[meshIdx][lod - 1] : mMeshes[meshIdx];
+}
+
+void GeometryLoader::SetCacheFolder(const std::wstring& folderPath) {
+    mCacheFolder = folderPath;
+    if (!mCacheFolder.empty()) {
+        Platform::CreateDirectories(mCacheFolder);
+    }
+}
+
+bool GeometryLoader::WasLoadedFromCache() const {
+    return mLoadedFromCache;
+}
+
+void GeometryLoader::SetPagingEnabled(const bool enabled) {
+    mPagingEnabled = enabled;
+}
+
+bool GeometryLoader::IsPaged() const {
+    return mPagedFile != nullptr;
+}
+
+uint64_t GeometryLoader::ComputeCacheKey(const std::wstring& fileName) const {
+    const uint64_t writeTime = Platform::GetFileWriteTime(fileName);
+    const uint32_t reorder = mReorderEnabled ? 1 : 0;
+
+    uint64_t hash = HashValue(sGeometryCacheVersion);
+    hash = HashValue(reorder, hash);
+    hash = HashValue(mLodLevels, hash);
+    hash = HashValue(writeTime, hash);
+    return HashFNV1a64(fileName.data(), fileName.size() * sizeof(wchar_t), hash);
+}
+
+std::wstring GeometryLoader::GetCacheFilePath(const uint64_t key) const {
+    wchar_t fileName[32];
+    swprintf(fileName, 32, L"%016llx.vkgeo", static_cast<unsigned long long>(key));
+    return mCacheFolder + fileName;
+}
+
+bool GeometryLoader::ReadCacheFile(const std::wstring& cacheFilePath, const uint64_t key) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->Open(cacheFilePath)) {
+        return false;
+    }
+
+    // anything that doesn't validate is treated as a miss and overwritten
+    const uint8_t* bytes = file->GetData();
+    const size_t size = file->GetSize();
+    size_t offset = 0;
+    auto Read = [&](void* dst, const size_t numBytes) -> bool {
+        if (numBytes > size - offset) {
+            return false;
+        }
+        if (numBytes > 0) {
+            memcpy(dst, bytes + offset, numBytes);
+        }
+        offset += numBytes;
+        return true;
+    };
+
+    GeometryCacheHeader header;
+    if (size < sizeof(header) || !Read(&header, sizeof(header)) ||
+        header.magic != sGeometryCacheMagic || header.version != sGeometryCacheVersion || header.key != key) {
+        return false;
+    }
+
+    std::vector<GeometryCacheMeshEntry> entries(header.numMeshes);
+    if (header.numMeshes > size / sizeof(GeometryCacheMeshEntry) || !Read(entries.data(), entries.size() * sizeof(GeometryCacheMeshEntry))) {
+        return false;
+    }
+
+    PagesArray pages(header.numPages);
+    if (header.numPages > size / sizeof(GeometryPage) || !Read(pages.data(), pages.size() * sizeof(GeometryPage))) {
+        return false;
+    }
+    for (const GeometryPage& page : pages) {
+        if (page.meshIdx >= header.numMeshes || page.firstFace + static_cast<uint64_t>(page.numFaces) > entries[page.meshIdx].numFaces ||
+            page.firstVertex + static_cast<uint64_t>(page.numVertices) > entries[page.meshIdx].numVertices) {
+            return false;
+        }
+    }
+
+    std::vector<std::vector<GeometryCacheMeshEntry>> lodEntries(header.numMeshes);
+    for (auto& meshLodEntries : lodEntries) {
+        uint32_t numLods = 0;
+        if (!Read(&numLods, sizeof(numLods)) || numLods > sLodMaxLevels) {
+            return false;
+        }
+        meshLodEntries.resize(numLods);
+        if (!Read(meshLodEntries.data(), meshLodEntries.size() * sizeof(GeometryCacheMeshEntry))) {
+            return false;
+        }
+    }
+
+    // paged, the mesh data is only walked over and stays in the mapping
+    const size_t bytesPerVertex = 2 * sizeof(vec3) + sizeof(vec2);
+    const size_t bytesPerFace = sizeof(Face) + sizeof(uint32_t);
+    auto SkipMesh = [&](const GeometryCacheMeshEntry& entry) -> bool {
+        const size_t meshBytes = entry.numVertices * bytesPerVertex + entry.numFaces * bytesPerFace;
+        if (entry.numVertices * bytesPerVertex > size - offset || meshBytes > size - offset) {
+            return false;
+        }
+        offset += meshBytes;
+        return true;
+    };
+    auto ReadMesh = [&](const GeometryCacheMeshEntry& entry, Mesh& mesh) -> bool {
+        const size_t numVertices = entry.numVertices;
+        const size_t numFaces = entry.numFaces;
+        if (numVertices * sizeof(vec3) > size - offset || numFaces * sizeof(Face) > size - offset) {
+            return false;
+        }
+
+        mesh.positions.resize(numVertices);
+        mesh.normals.resize(numVertices);
+        mesh.uvs.resize(numVertices);
+        mesh.faces.resize(numFaces);
+        mesh.materialIDs.resize(numFaces);
+        return Read(mesh.positions.data(), numVertices * sizeof(vec3)) && Read(mesh.normals.data(), numVertices * sizeof(vec3)) &&
+               Read(mesh.uvs.data(), numVertices * sizeof(vec2)) && Read(mesh.faces.data(), numFaces * sizeof(Face)) &&
+               Read(mesh.materialIDs.data(), numFaces * sizeof(uint32_t));
+    };
+
+    MeshesArray meshes(mPagingEnabled ? 0 : header.numMeshes);
+    PagedMeshesArray pagedMeshes(mPagingEnabled ? header.numMeshes : 0);
+    for (size_t i = 0; i < header.numMeshes; ++i) {
+        if (mPagingEnabled) {
+            pagedMeshes[i] = { offset, entries[i].numVertices, entries[i].numFaces };
+            if (!SkipMesh(entries[i])) {
+                return false;
+            }
+        } else if (!ReadMesh(entries[i], meshes[i])) {
+            return false;
+        }
+    }
+
+    std::vector<MeshesArray> lodChains(mPagingEnabled ? 0 : header.numMeshes);
+    for (size_t i = 0; i < header.numMeshes; ++i) {
+        for (size_t lod = 0; lod < lodEntries[i].size(); ++lod) {
+            if (mPagingEnabled) {
+                if (!SkipMesh(lodEntries[i][lod])) {
+                    return false;
+                }
+                continue;
+            }
+
+            lodChains[i].emplace_back();
+            if (!ReadMesh(lodEntries[i][lod], lodChains[i].back())) {
+                return false;
+            }
+        }
+    }
+
+    MaterialsArray materials(header.numMaterials);
+    if (header.numMaterials > size / sizeof(Material_s) || !Read(materials.data(), materials.size() * sizeof(Material_s))) {
+        return false;
+    }
+
+    TexturesArray textures;
+    for (uint32_t i = 0; i < header.numTextures; ++i) {
+        uint32_t length = 0;
+        if (!Read(&length, sizeof(length)) || length > size - offset) {
+            return false;
+        }
+        std::string path(length, '\0');
+        Read(&path[0], length);
+        textures.push_back(Utf8ToUnicode(path));
+    }
+
+    mMeshes = std::move(meshes);
+    mPages = std::move(pages);
+    mLodChains = std::move(lodChains);
+    mPagedMeshes = std::move(pagedMeshes);
+    mPagedFile = mPagingEnabled ? std::move(file) : nullptr;
+    mMaterials = std::move(materials);
+    mTextures = std::move(textures);
+    mTexturesMap.clear();
+    for (size_t i = 0; i < mTextures.size(); ++i) {
+        mTexturesMap[mTextures[i]] = static_cast<uint32_t>(i);
+    }
+    mFileOrderVertexMissRatio = header.fileOrderVertexMissRatio;
+    mVertexMissRatio = header.vertexMissRatio;
+    return true;
+}
+
+bool GeometryLoader::WriteCacheFile(const std::wstring& cacheFilePath, const uint64_t key) const {
+    GeometryCacheHeader header = { };
+    header.magic = sGeometryCacheMagic;
+    header.version = sGeometryCacheVersion;
+    header.key = key;
+    header.numMeshes = static_cast<uint32_t>(mMeshes.size());
+    header.numMaterials = static_cast<uint32_t>(mMaterials.size());
+    header.numTextures = static_cast<uint32_t>(mTextures.size());
+    header.numPages = static_cast<uint32_t>(mPages.size());
+    header.fileOrderVertexMissRatio = mFileOrderVertexMissRatio;
+    header.vertexMissRatio = mVertexMissRatio;
+
+    return Platform::WriteFileAtomically(cacheFilePath, [&](FILE* file) {
+        auto Write = [file](const void* src, const size_t numBytes) -> bool {
+            return numBytes == 0 || fwrite(src, 1, numBytes, file) == numBytes;
+        };
+
+        bool written = Write(&header, sizeof(header));
+        for (const Mesh& mesh : mMeshes) {
+            const GeometryCacheMeshEntry entry = { static_cast<uint32_t>(mesh.positions.size()), static_cast<uint32_t>(mesh.faces.size()) };
+            written = written && Write(&entry, sizeof(entry));
+        }
+        written = written && Write(mPages.data(), mPages.size() * sizeof(GeometryPage));
+        for (size_t i = 0; i < mMeshes.size(); ++i) {
+            const uint32_t numLods = static_cast<uint32_t>(this->GetNumLods(i) - 1);
+            written = written && Write(&numLods, sizeof(numLods));
+            for (uint32_t lod = 1; lod <= numLods; ++lod) {
+                const Mesh& mesh = this->GetLod(i, lod);
+                const GeometryCacheMeshEntry entry = { static_cast<uint32_t>(mesh.positions.size()), static_cast<uint32_t>(mesh.faces.size()) };
+                written = written && Write(&entry, sizeof(entry));
+            }
+        }
+
+        auto WriteMesh = [&Write](const Mesh& mesh) -> bool {
+            return Write(mesh.positions.data(), mesh.positions.size() * sizeof(vec3)) && Write(mesh.normals.data(), mesh.normals.size() * sizeof(vec3)) &&
+                   Write(mesh.uvs.data(), mesh.uvs.size() * sizeof(vec2)) && Write(mesh.faces.data(), mesh.faces.size() * sizeof(Face)) &&
+                   Write(mesh.materialIDs.data(), mesh.materialIDs.size() * sizeof(uint32_t));
+        };
+        for (const Mesh& mesh : mMeshes) {
+            written = written && WriteMesh(mesh);
+        }
+        for (size_t i = 0; i < mMeshes.size(); ++i) {
+            for (size_t lod = 1; lod < this->GetNumLods(i); ++lod) {
+                written = written && WriteMesh(this->GetLod(i, lod));
+            }
+        }
+        written = written && Write(mMaterials.data(), mMaterials.size() * sizeof(Material_s));
+        for (const std::wstring& texture : mTextures) {
+            const std::string path = UnicodeToUtf8(texture);
+            const uint32_t length = static_cast<uint32_t>(path.size());
+            written = written && Write(&length, sizeof(length)) && Write(path.data(), path.size());
+        }
+        return written;
+    });
+}
+
+double GeometryLoader::GetFileOrderVertexMissRatio() const {
+    return mFileOrderVertexMissRatio;
+}
+
+double GeometryLoader::GetVertexMissRatio() const {
+    return mVertexMissRatio;
+}
+
+void GeometryLoader::ReorderMeshes() {
+    std::vector<vec3> meshCenters(mMeshes.size());
+    vec3 sceneMin(std::numeric_limits<float>::max());
+    vec3 sceneMax(-std::numeric_limits<float>::max());
+
+    for (size_t meshIdx = 0; meshIdx < mMeshes.size(); ++meshIdx) {
+        Mesh& mesh = mMeshes[meshIdx];
+        const size_t numFaces = mesh.faces.size();
+        if (!numFaces) {
+            continue;
+        }
+
+        std::vector<vec3> centroids(numFaces);
+        vec3 boundsMin(std::numeric_limits<float>::max());
+        vec3 boundsMax(-std::numeric_limits<float>::max());
+        for (size_t f = 0; f < numFaces; ++f) {
+            centroids[f] = FaceCentroid(mesh, mesh.faces[f]);
+            boundsMin = glm::min(boundsMin, centroids[f]);
+            boundsMax = glm::max(boundsMax, centroids[f]);
+        }
+
+        meshCenters[meshIdx] = (boundsMin + boundsMax) * 0.5f;
+        sceneMin = glm::min(sceneMin, boundsMin);
+        sceneMax = glm::max(sceneMax, boundsMax);
+
+        // faces close in space end up close in memory, stable so coplanar runs keep their order
+        const vec3 boundsInvExtent = InvExtent(boundsMin, boundsMax);
+        std::vector<std::pair<uint32_t, uint32_t>> keys(numFaces);
+        for (size_t f = 0; f < numFaces; ++f) {
+            keys[f] = std::make_pair(MortonCode(centroids[f], boundsMin, boundsInvExtent), static_cast<uint32_t>(f));
+        }
+        std::stable_sort(keys.begin(), keys.end(), [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+            return a.first < b.first;
+        });
+
+        // vertices follow the faces in the order they are first used, unused ones are dropped
+        Mesh sorted;
+        sorted.faces.resize(numFaces);
+        sorted.materialIDs.resize(numFaces);
+        sorted.positions.reserve(mesh.positions.size());
+        sorted.normals.reserve(mesh.normals.size());
+        sorted.uvs.reserve(mesh.uvs.size());
+
+        std::vector<uint32_t> vertexRemap(mesh.positions.size(), UINT32_MAX);
+        auto RemapVertex = [&](const uint32_t vertexIdx) -> uint32_t {
+            uint32_t& remapped = vertexRemap[vertexIdx];
+            if (remapped == UINT32_MAX) {
+                remapped = static_cast<uint32_t>(sorted.positions.size());
+                sorted.positions.push_back(mesh.positions[vertexIdx]);
+                sorted.normals.push_back(mesh.normals[vertexIdx]);
+                sorted.uvs.push_back(mesh.uvs[vertexIdx]);
+            }
+            return remapped;
+        };
+
+        for (size_t f = 0; f < numFaces; ++f) {
+            const uint32_t srcFace = keys[f].second;
+            const Face& face = mesh.faces[srcFace];
+
+            sorted.faces[f].a = RemapVertex(face.a);
+            sorted.faces[f].b = RemapVertex(face.b);
+            sorted.faces[f].c = RemapVertex(face.c);
+            sorted.materialIDs[f] = mesh.materialIDs[srcFace];
+        }
+
+        mesh = std::move(sorted);
+    }
+
+    // meshes are packed one after another in the scene buffers, so their order matters too
+    const vec3 sceneInvExtent = InvExtent(sceneMin, sceneMax);
+    std::vector<std::pair<uint32_t, size_t>> meshKeys(mMeshes.size());
+    for (size_t meshIdx = 0; meshIdx < mMeshes.size(); ++meshIdx) {
+        meshKeys[meshIdx] = std::make_pair(MortonCode(meshCenters[meshIdx], sceneMin, sceneInvExtent), meshIdx);
+    }
+    std::stable_sort(meshKeys.begin(), meshKeys.end(), [](const std::pair<uint32_t, size_t>& a, const std::pair<uint32_t, size_t>& b) {
+        return a.first < b.first;
+    });
+
+    MeshesArray meshes(mMeshes.size());
+    for (size_t i = 0; i < meshKeys.size(); ++i) {
+        meshes[i] = std::move(mMeshes[meshKeys[i].second]);
+    }
+    mMeshes = std::move(meshes);
+}
+
+double GeometryLoader::EstimateVertexMissRatio() const {
+    // Faces are fetched in the order they are stored and the position of every corner goes
+    // through a 32 KB FIFO cache of 64 byte lines, addressed as in the packed buffer
+    static const size_t sCacheLineSize = 64;
+    static const size_t sCacheLines = 512;
+
+    std::vector<size_t> fifo(sCacheLines, SIZE_MAX);
+    std::unordered_set<size_t> cached;
+    cached.reserve(sCacheLines * 2);
+    size_t fifoHead = 0;
+    size_t fetches = 0;
+    size_t misses = 0;
+
+    size_t vertexOffset = 0;
+    for (const Mesh& mesh : mMeshes) {
+        for (const Face& face : mesh.faces) {
+            for (const uint32_t vertexIdx : { face.a, face.b, face.c }) {
+                const size_t line = ((vertexOffset + vertexIdx) * sizeof(vec3)) / sCacheLineSize;
+                ++fetches;
+                if (cached.count(line)) {
+                    continue;
+                }
+
+                ++misses;
+                if (fifo[fifoHead] != SIZE_MAX) {
+                    cached.erase(fifo[fifoHead]);
+                }
+                fifo[fifoHead] = line;
+                cached.insert(line);
+                fifoHead = (fifoHead + 1) % sCacheLines;
+            }
+        }
+        vertexOffset += mesh.positions.size();
+    }
+
+    return fetches ? static_cast<double>(misses) / static_cast<double>(fetches) : 0.0;
+}
+
+void GeometryLoader::BuildPages() {
+    mPages.clear();
+    for (size_t meshIdx = 0; meshIdx < mMeshes.size(); ++meshIdx) {
+        const Mesh& mesh = mMeshes[meshIdx];
+        const size_t numFaces = mesh.faces.size();
+
+        for (size_t first = 0; first < numFaces; first += sGeometryPageMaxFaces) {
+            const size_t last = std::min(first + sGeometryPageMaxFaces, numFaces);
+
+            uint32_t minVertex = std::numeric_limits<uint32_t>::max();
+            uint32_t maxVertex = 0;
+            GeometryPage page;
+            page.boundsMin = vec3(std::numeric_limits<float>::max());
+            page.boundsMax = vec3(-std::numeric_limits<float>::max());
+            for (size_t f = first; f < last; ++f) {
+                for (const uint32_t v : { mesh.faces[f].a, mesh.faces[f].b, mesh.faces[f].c }) {
+                    minVertex = std::min(minVertex, v);
+                    maxVertex = std::max(maxVertex, v);
+                    page.boundsMin = glm::min(page.boundsMin, mesh.positions[v]);
+                    page.boundsMax = glm::max(page.boundsMax, mesh.positions[v]);
+                }
+            }
+
+            page.meshIdx = static_cast<uint32_t>(meshIdx);
+            page.firstFace = static_cast<uint32_t>(first);
+            page.numFaces = static_cast<uint32_t>(last - first);
+            page.firstVertex = minVertex;
+            page.numVertices = maxVertex - minVertex + 1;
+            mPages.push_back(page);
+        }
+    }
+}
+
+void GeometryLoader::BuildLods() {
+    mLodChains.assign(mMeshes.size(), MeshesArray());
+    if (!mLodLevels) {
+        return;
+    }
+
+    // every level is simplified from the one before, the meshes are independent of each other
+    auto BuildChains = [this](const uint32_t begin, const uint32_t end) {
+        for (uint32_t meshIdx = begin; meshIdx < end; ++meshIdx) {
+            MeshesArray& chain = mLodChains[meshIdx];
+            chain.reserve(mLodLevels);
+
+            const Mesh* previous = &mMeshes[meshIdx];
+            while (chain.size() < mLodLevels && previous->faces.size() / 2 >= sLodMinFaces) {
+                Mesh lod;
+                MeshSimplifier::Simplify(*previous, previous->faces.size() / 2, lod);
+                // nothing left to collapse without folding faces over, another level would be the same
+                if (lod.faces.size() * 10 > previous->faces.size() * 9) {
+                    break;
+                }
+                chain.push_back(std::move(lod));
+                previous = &chain.back();
+            }
+        }
+    };
+
+    // a mesh per job, they differ too much in size for bigger ranges to come out even
+    const uint32_t numMeshes = static_cast<uint32_t>(mMeshes.size());
+    if (mJobSystem != nullptr) {
+        mJobSystem->ParallelFor(numMeshes, 1, BuildChains);
+    } else {
+        BuildChains(0, numMeshes);
+    }
+}
+
+uint32_t GeometryLoader::GetMaxPageFaces() {
+    return sGeometryPageMaxFaces;
+}
+
+size_t GeometryLoader::GetNumPages() const {
+    return mPages.size();
+}
+
+const GeometryPage& GeometryLoader::GetPage(const size_t pageIdx) const {
+    return mPages[pageIdx];
+}
+
+void GeometryLoader::ReadPage(const size_t pageIdx, vec3* positions, vec3* normals, vec2* uvs, Face* faces, uint32_t* materialIDs) const {
+    const GeometryPage& page = mPages[pageIdx];
+
+    const vec3* srcPositions;
+    const vec3* srcNormals;
+    const vec2* srcUVs;
+    const Face* srcFaces;
+    const uint32_t* srcMaterialIDs;
+    if (mPagedFile) {
+        // touching the mapping is what pulls the page in from disk
+        const PagedMesh& mesh = mPagedMeshes[page.meshIdx];
+        const uint8_t* data = mPagedFile->GetData() + mesh.dataOffset;
+        srcPositions = reinterpret_cast<const vec3*>(data);
+        srcNormals = srcPositions + mesh.numVertices;
+        srcUVs = reinterpret_cast<const vec2*>(srcNormals + mesh.numVertices);
+        srcFaces = reinterpret_cast<const Face*>(srcUVs + mesh.numVertices);
+        srcMaterialIDs = reinterpret_cast<const uint32_t*>(srcFaces + mesh.numFaces);
+    } else {
+        const Mesh& mesh = mMeshes[page.meshIdx];
+        srcPositions = mesh.positions.data();
+        srcNormals = mesh.normals.data();
+        srcUVs = mesh.uvs.data();
+        srcFaces = mesh.faces.data();
+        srcMaterialIDs = mesh.materialIDs.data();
+    }
+
+    memcpy(positions, srcPositions + page.firstVertex, page.numVertices * sizeof(vec3));
+    memcpy(normals, srcNormals + page.firstVertex, page.numVertices * sizeof(vec3));
+    memcpy(uvs, srcUVs + page.firstVertex, page.numVertices * sizeof(vec2));
+    memcpy(materialIDs, srcMaterialIDs + page.firstFace, page.numFaces * sizeof(uint32_t));
+    for (uint32_t i = 0; i < page.numFaces; ++i) {
+        const Face& face = srcFaces[page.firstFace + i];
+        faces[i] = { face.a - page.firstVertex, face.b - page.firstVertex, face.c - page.firstVertex };
+    }
+}
+
 size_t GeometryLoader::GetNumMeshes() const {
     return mMeshes.size();
 }
@@ -135,3 +775,27 @@ size_t GeometryLoader::GetNumMaterials() const {
 const Material_s* GeometryLoader::GetMaterials() const {
     return mMaterials.data();
 }
+
+size_t GeometryLoader::GetNumTextures() const {
+    return mTextures.size();
+}
+
+const std::wstring& GeometryLoader::GetTexturePath(const size_t textureIdx) const {
+    return mTextures[textureIdx];
+}
+
+uint32_t GeometryLoader::RegisterTexture(const std::string& baseDir, const std::string& textureName) {
+    std::wstring path = Utf8ToUnicode(baseDir + "/" + textureName);
+    std::replace(path.begin(), path.end(), L'\\', L'/');
+
+    // many materials share the same image, each file is loaded only once
+    auto it = mTexturesMap.find(path);
+    if (it != mTexturesMap.end()) {
+        return it->second;
+    }
+
+    const uint32_t textureIdx = static_cast<uint32_t>(mTextures.size());
+    mTextures.push_back(path);
+    mTexturesMap[path] = textureIdx;
+    return textureIdx;
+}
@@ -1,6 +1,8 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #include "shared_with_shaders.h"
 
@@ -21,6 +23,23 @@ struct Mesh {
     FaceMaterialIDs materialIDs;
 };
 
+// A run of up to GeometryLoader::GetMaxPageFaces faces of one mesh and the range of vertices they
+// use, the unit GeometryPager keeps resident. With reordering the faces are in Morton order and
+// the vertices in first use order, so a page is a compact part of the mesh and its vertex range
+// is tight.
+struct GeometryPage {
+    uint32_t    meshIdx;
+    uint32_t    firstFace;
+    uint32_t    numFaces;
+    uint32_t    firstVertex;
+    uint32_t    numVertices;
+    vec3        boundsMin;
+    vec3        boundsMax;
+};
+
+class JobSystem;
+class MappedFile;
+
 class GeometryLoader {
 public:
     GeometryLoader();
@@ -28,6 +47,47 @@ public:
 
     bool                LoadFromOBJ(const std::wstring& fileName);
 
+    // Call before loading. With a folder set the parsed and reordered scene is kept there in a
+    // binary .vkgeo file, keyed on the OBJ's path, its write time and the reorder setting, and
+    // LoadFromOBJ reads that instead while it is current. Edits to the .mtl alone go unnoticed.
+    void                SetCacheFolder(const std::wstring& folderPath);
+    bool                WasLoadedFromCache() const;
+
+    // Call before loading, needs a cache folder. The meshes stay in the .vkgeo file, which is kept
+    // mapped, and are only read a page at a time through ReadPage; GetNumMeshes is 0 then.
+    // Materials and textures load as usual. When the cache can't be written the meshes are
+    // kept in memory instead and IsPaged is false, ReadPage works either way.
+    void                SetPagingEnabled(const bool enabled);
+    bool                IsPaged() const;
+
+    static uint32_t     GetMaxPageFaces();
+    size_t              GetNumPages() const;
+    const GeometryPage& GetPage(const size_t pageIdx) const;
+    // Copies the page's vertices and faces out, the faces index from the page's first vertex
+    void                ReadPage(const size_t pageIdx, vec3* positions, vec3* normals, vec2* uvs, Face* faces, uint32_t* materialIDs) const;
+
+    // Call before loading. Every mesh gets up to this many simplified levels of detail after its
+    // full one, each with about half the faces of the level before, see MeshSimplifier. They are
+    // kept in the cache next to the meshes and not read by paged loads. 0 by default.
+    void                SetLodLevels(const uint32_t levels);
+    // Call before loading. The levels of detail are simplified on its threads, without one on
+    // the loading thread alone. None by default.
+    void                SetJobSystem(JobSystem* jobSystem);
+    // the full mesh and the simplified levels it got, small meshes stop early
+    size_t              GetNumLods(const size_t meshIdx) const;
+    // level 0 is the mesh itself
+    const Mesh&         GetLod(const size_t meshIdx, const size_t lod) const;
+
+    // Call before loading. Faces are sorted by the Morton code of their centroid and vertices
+    // renumbered in first use order, meshes by the Morton code of their center. On by default.
+    // Either way the OBJ corners that share all their indices are welded into one vertex first.
+    void                SetReorderEnabled(const bool enabled);
+    // Fraction of vertex position fetches missing a small FIFO cache of lines when the faces are
+    // walked in the order they are stored. For the order in the file, welded, and for the order
+    // the meshes ended up in.
+    double              GetFileOrderVertexMissRatio() const;
+    double              GetVertexMissRatio() const;
+
     size_t              GetNumMeshes() const;
 
     size_t              GetNumVertices(const size_t meshIdx) const;
@@ -42,10 +102,52 @@ public:
     size_t              GetNumMaterials() const;
     const Material_s*   GetMaterials() const;
 
+    // unique textures referenced by the materials, Material_s::textures index into this list
+    size_t              GetNumTextures() const;
+    const std::wstring& GetTexturePath(const size_t textureIdx) const;
+
+private:
+    uint32_t            RegisterTexture(const std::string& baseDir, const std::string& textureName);
+    void                ReorderMeshes();
+    void                BuildPages();
+    void                BuildLods();
+    double              EstimateVertexMissRatio() const;
+    uint64_t            ComputeCacheKey(const std::wstring& fileName) const;
+    std::wstring        GetCacheFilePath(const uint64_t key) const;
+    bool                ReadCacheFile(const std::wstring& cacheFilePath, const uint64_t key);
+    bool                WriteCacheFile(const std::wstring& cacheFilePath, const uint64_t key) const;
+
 private:
+    // where a paged mesh's data starts in the mapped cache file
+    struct PagedMesh {
+        size_t      dataOffset;
+        uint32_t    numVertices;
+        uint32_t    numFaces;
+    };
+
     using MeshesArray = std::vector<Mesh>;
     using MaterialsArray = std::vector<Material_s>;
+    using TexturesArray = std::vector<std::wstring>;
+    using TexturesMap = std::unordered_map<std::wstring, uint32_t>;
+    using PagesArray = std::vector<GeometryPage>;
+    using PagedMeshesArray = std::vector<PagedMesh>;
 
     MeshesArray     mMeshes;
     MaterialsArray  mMaterials;
+    TexturesArray   mTextures;
+    TexturesMap     mTexturesMap;
+    PagesArray      mPages;
+    // levels 1 and up of every mesh
+    std::vector<MeshesArray> mLodChains;
+
+    bool            mReorderEnabled;
+    uint32_t        mLodLevels;
+    JobSystem*      mJobSystem;
+    std::wstring    mCacheFolder;
+    bool            mLoadedFromCache;
+    bool            mPagingEnabled;
+    std::unique_ptr<MappedFile> mPagedFile;
+    PagedMeshesArray mPagedMeshes;
+    double          mFileOrderVertexMissRatio;
+    double          mVertexMissRatio;
 };
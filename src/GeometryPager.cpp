@@ -0,0 +1,301 @@
+#include "GeometryPager.h"
+
+#include <algorithm>
+#include <utility>
+
+// of the budget, kept for the bottom level structures; they come out about as big as the
+// page data they are built over
+static const double sAccelerationStructureReserve = 0.5;
+
+GeometryPager::GeometryPager()
+    : mLoader(nullptr)
+    , mBudgetBytes(0)
+    , mMaxFaultsPerUpdate(0)
+    , mVertexCapacity(0)
+    , mFaceCapacity(0)
+    , mUpdateIndex(0)
+    , mReportedASBytes(0)
+    , mReportedASFaces(0)
+    , mStats()
+{
+
+}
+GeometryPager::~GeometryPager() {
+
+}
+
+void GeometryPager::Create(const GeometryLoader& loader, const uint64_t budgetBytes, const uint32_t maxFaultsPerUpdate) {
+    mLoader = &loader;
+    mBudgetBytes = budgetBytes;
+    mMaxFaultsPerUpdate = std::max(maxFaultsPerUpdate, 1u);
+    mUpdateIndex = 0;
+    mReportedASBytes = 0;
+    mReportedASFaces = 0;
+    mStats = GeometryPagerStats();
+    mStats.budgetBytes = budgetBytes;
+    mLRU.clear();
+
+    const size_t numPages = loader.GetNumPages();
+    mPages.assign(numPages, PageState());
+
+    // pages share a few vertices at their seams, the pools are sized by what the pages hold
+    uint64_t sceneVertices = 0;
+    uint64_t sceneFaces = 0;
+    uint32_t maxPageVertices = 0;
+    uint32_t maxPageFaces = 0;
+    for (size_t i = 0; i < numPages; ++i) {
+        const GeometryPage& page = loader.GetPage(i);
+        sceneVertices += page.numVertices;
+        sceneFaces += page.numFaces;
+        maxPageVertices = std::max(maxPageVertices, page.numVertices);
+        maxPageFaces = std::max(maxPageFaces, page.numFaces);
+        mPages[i].resident = false;
+        mPages[i].vertexOffset = 0;
+        mPages[i].faceOffset = 0;
+        mPages[i].asBytes = 0;
+        mPages[i].lastWanted = 0;
+    }
+
+    const uint64_t sceneVertexBytes = sceneVertices * GetBytesPerVertex();
+    const uint64_t sceneFaceBytes = sceneFaces * GetBytesPerFace();
+    const double poolBudget = static_cast<double>(budgetBytes) * (1.0 - sAccelerationStructureReserve);
+    uint64_t vertexCapacity = sceneVertices;
+    uint64_t faceCapacity = sceneFaces;
+    if (static_cast<double>(sceneVertexBytes + sceneFaceBytes) > poolBudget) {
+        const double vertexShare = static_cast<double>(sceneVertexBytes) / static_cast<double>(sceneVertexBytes + sceneFaceBytes);
+        vertexCapacity = static_cast<uint64_t>(poolBudget * vertexShare) / GetBytesPerVertex();
+        faceCapacity = static_cast<uint64_t>(poolBudget * (1.0 - vertexShare)) / GetBytesPerFace();
+    }
+    mVertexCapacity = static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(vertexCapacity, maxPageVertices), UINT32_MAX));
+    mFaceCapacity = static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(faceCapacity, maxPageFaces), UINT32_MAX));
+    mVertexPool.Reset(mVertexCapacity);
+    mFacePool.Reset(mFaceCapacity);
+
+    // the caller allocates the pools whole, empty or not they take their memory
+    mStats.poolBytes = static_cast<uint64_t>(mVertexCapacity) * GetBytesPerVertex() + static_cast<uint64_t>(mFaceCapacity) * GetBytesPerFace();
+    mStats.residentBytes = mStats.poolBytes;
+}
+
+bool GeometryPager::IsCreated() const {
+    return mLoader != nullptr;
+}
+
+uint32_t GeometryPager::GetBytesPerVertex() {
+    return static_cast<uint32_t>(2 * sizeof(vec3) + sizeof(vec2));
+}
+
+uint32_t GeometryPager::GetBytesPerFace() {
+    return static_cast<uint32_t>(sizeof(Face) + sizeof(uint32_t));
+}
+
+uint32_t GeometryPager::GetVertexCapacity() const {
+    return mVertexCapacity;
+}
+
+uint32_t GeometryPager::GetFaceCapacity() const {
+    return mFaceCapacity;
+}
+
+bool GeometryPager::Update(const GeometryPagerView& view, std::vector<uint32_t>& evictedPages, std::vector<uint32_t>& loadedPages) {
+    evictedPages.clear();
+    loadedPages.clear();
+    ++mUpdateIndex;
+
+    // nearest first, those cover the most pixels
+    std::vector<std::pair<float, uint32_t>> missingPages;
+    mStats.wantedPages = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(mPages.size()); ++i) {
+        float distance = 0.0f;
+        if (!this->IsWanted(mLoader->GetPage(i), view, distance)) {
+            continue;
+        }
+
+        ++mStats.wantedPages;
+        PageState& state = mPages[i];
+        state.lastWanted = mUpdateIndex;
+        if (state.resident) {
+            mLRU.splice(mLRU.begin(), mLRU, state.lruPosition);
+        } else {
+            missingPages.push_back({ distance, i });
+        }
+    }
+
+    // structure sizes reported since the last update can put it over
+    while (mStats.residentBytes > mBudgetBytes && this->EvictOne(evictedPages)) {
+    }
+
+    const size_t numFaults = std::min<size_t>(missingPages.size(), mMaxFaultsPerUpdate);
+    std::partial_sort(missingPages.begin(), missingPages.begin() + numFaults, missingPages.end());
+
+    for (size_t i = 0; i < numFaults; ++i) {
+        const uint32_t pageIdx = missingPages[i].second;
+        const GeometryPage& page = mLoader->GetPage(pageIdx);
+        PageState& state = mPages[pageIdx];
+
+        // the structure size is only known once built, so it is guessed; a page over the whole
+        // budget still loads into otherwise empty pools
+        const uint64_t pageBytes = this->GuessAccelerationStructureBytes(pageIdx);
+        bool evicted = true;
+        while (evicted && mStats.residentPages > 0 && mStats.residentBytes + pageBytes > mBudgetBytes) {
+            evicted = this->EvictOne(evictedPages);
+        }
+
+        // fragmented pools evict more until the ranges free up
+        bool allocated = false;
+        while (evicted && !allocated) {
+            if (mVertexPool.Allocate(page.numVertices, state.vertexOffset)) {
+                allocated = mFacePool.Allocate(page.numFaces, state.faceOffset);
+                if (!allocated) {
+                    mVertexPool.Free(state.vertexOffset, page.numVertices);
+                }
+            }
+            if (!allocated) {
+                evicted = this->EvictOne(evictedPages);
+            }
+        }
+
+        // whatever is left is in view and nearer, the rest waits for the view to change
+        if (!allocated) {
+            break;
+        }
+
+        // its structure counts once reported, the pools are paid for already
+        state.resident = true;
+        state.asBytes = 0;
+        mLRU.push_front(pageIdx);
+        state.lruPosition = mLRU.begin();
+        ++mStats.residentPages;
+        ++mStats.pageFaults;
+        loadedPages.push_back(pageIdx);
+    }
+
+    return !evictedPages.empty() || !loadedPages.empty();
+}
+
+bool GeometryPager::IsResident(const uint32_t pageIdx) const {
+    return mPages[pageIdx].resident;
+}
+
+uint32_t GeometryPager::GetVertexOffset(const uint32_t pageIdx) const {
+    return mPages[pageIdx].vertexOffset;
+}
+
+uint32_t GeometryPager::GetFaceOffset(const uint32_t pageIdx) const {
+    return mPages[pageIdx].faceOffset;
+}
+
+void GeometryPager::SetAccelerationStructureSize(const uint32_t pageIdx, const uint64_t size) {
+    PageState& state = mPages[pageIdx];
+    if (state.resident) {
+        mStats.residentBytes = mStats.residentBytes - state.asBytes + size;
+    }
+    state.asBytes = size;
+
+    mReportedASBytes += size;
+    mReportedASFaces += mLoader->GetPage(pageIdx).numFaces;
+}
+
+const GeometryPagerStats& GeometryPager::GetStats() const {
+    return mStats;
+}
+
+bool GeometryPager::IsWanted(const GeometryPage& page, const GeometryPagerView& view, float& distance) const {
+    const vec3 closest = glm::min(glm::max(view.position, page.boundsMin), page.boundsMax);
+    distance = glm::length(closest - view.position);
+    if (distance <= view.nearDistance) {
+        return true;
+    }
+    if (distance > view.farDistance) {
+        return false;
+    }
+
+    // the four side planes through the eye, normals pointing in; a box is out when the corner
+    // furthest along a normal is still behind that plane
+    const float tanHalfFovX = view.tanHalfFovY * view.aspect;
+    const vec3 planes[4] = {
+        view.direction * tanHalfFovX + view.side,
+        view.direction * tanHalfFovX - view.side,
+        view.direction * view.tanHalfFovY + view.up,
+        view.direction * view.tanHalfFovY - view.up,
+    };
+    for (const vec3& normal : planes) {
+        const vec3 corner(normal.x >= 0.0f ? page.boundsMax.x : page.boundsMin.x,
+                          normal.y >= 0.0f ? page.boundsMax.y : page.boundsMin.y,
+                          normal.z >= 0.0f ? page.boundsMax.z : page.boundsMin.z);
+        if (glm::dot(normal, corner - view.position) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t GeometryPager::GuessAccelerationStructureBytes(const uint32_t pageIdx) const {
+    // the one from its last stay, or the average per face of all the others so far
+    const PageState& state = mPages[pageIdx];
+    if (state.asBytes > 0 || mReportedASFaces == 0) {
+        return state.asBytes;
+    }
+    return mReportedASBytes * mLoader->GetPage(pageIdx).numFaces / mReportedASFaces;
+}
+
+bool GeometryPager::EvictOne(std::vector<uint32_t>& evictedPages) {
+    if (mLRU.empty() || mPages[mLRU.back()].lastWanted == mUpdateIndex) {
+        return false;
+    }
+
+    const uint32_t pageIdx = mLRU.back();
+    mLRU.pop_back();
+
+    const GeometryPage& page = mLoader->GetPage(pageIdx);
+    PageState& state = mPages[pageIdx];
+    mVertexPool.Free(state.vertexOffset, page.numVertices);
+    mFacePool.Free(state.faceOffset, page.numFaces);
+    state.resident = false;
+
+    mStats.residentBytes -= state.asBytes;
+    --mStats.residentPages;
+    ++mStats.evictions;
+    evictedPages.push_back(pageIdx);
+    return true;
+}
+
+void GeometryPager::PoolAllocator::Reset(const uint32_t capacity) {
+    mFreeRanges.clear();
+    if (capacity > 0) {
+        mFreeRanges[0] = capacity;
+    }
+}
+
+bool GeometryPager::PoolAllocator::Allocate(const uint32_t size, uint32_t& offset) {
+    for (auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+
+        offset = it->first;
+        const uint32_t remaining = it->second - size;
+        mFreeRanges.erase(it);
+        if (remaining > 0) {
+            mFreeRanges[offset + size] = remaining;
+        }
+        return true;
+    }
+    return false;
+}
+
+void GeometryPager::PoolAllocator::Free(const uint32_t offset, const uint32_t size) {
+    auto it = mFreeRanges.insert({ offset, size }).first;
+
+    auto next = std::next(it);
+    if (next != mFreeRanges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        mFreeRanges.erase(next);
+    }
+    if (it != mFreeRanges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            mFreeRanges.erase(it);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <map>
+#include <vector>
+
+#include "GeometryLoader.h"
+
+// what GeometryPager::Update decides visibility from
+struct GeometryPagerView {
+    vec3    position;
+    vec3    direction;
+    vec3    up;
+    vec3    side;
+    float   tanHalfFovY;
+    float   aspect;
+    // pages past this are never wanted
+    float   farDistance;
+    // pages within this are wanted whichever way the camera looks, that is where most bounce
+    // and shadow rays end up
+    float   nearDistance;
+};
+
+struct GeometryPagerStats {
+    uint32_t    residentPages;
+    // the pools, whole as they are allocated up front, and the acceleration structures
+    uint64_t    residentBytes;
+    uint64_t    poolBytes;
+    uint64_t    budgetBytes;
+    // pages loaded and dropped since Create
+    uint64_t    pageFaults;
+    uint64_t    evictions;
+    // in view as of the last Update
+    uint32_t    wantedPages;
+};
+
+// Keeps the pages of a GeometryLoader scene that are in view resident within a byte budget,
+// least recently wanted pages go first. The page data lives in two pools the caller owns, one
+// for vertices and one for faces, and the pager only hands out ranges in them: copying the data
+// in and building acceleration structures for it is up to the caller, which reports each
+// structure's size back. The pools count against the budget in full from the start, the
+// structures as they are reported.
+class GeometryPager {
+public:
+    GeometryPager();
+    ~GeometryPager();
+
+    // The pools cover what the budget leaves after a reserve for the acceleration structures,
+    // split between vertices and faces like the scene is, or the whole scene when that's less.
+    // At least the largest page always fits.
+    void        Create(const GeometryLoader& loader, const uint64_t budgetBytes, const uint32_t maxFaultsPerUpdate);
+    bool        IsCreated() const;
+
+    static uint32_t GetBytesPerVertex();
+    static uint32_t GetBytesPerFace();
+    uint32_t    GetVertexCapacity() const;
+    uint32_t    GetFaceCapacity() const;
+
+    // Pages in the view frustum within the far distance, or within the near distance at all,
+    // are wanted. Missing ones are faulted in nearest first, at most maxFaultsPerUpdate of them,
+    // making room by evicting pages that are not wanted now. Evicted pages are freed when this
+    // returns and loaded ones have their pool ranges; true if either list is not empty.
+    bool        Update(const GeometryPagerView& view, std::vector<uint32_t>& evictedPages, std::vector<uint32_t>& loadedPages);
+
+    bool        IsResident(const uint32_t pageIdx) const;
+    uint32_t    GetVertexOffset(const uint32_t pageIdx) const;
+    uint32_t    GetFaceOffset(const uint32_t pageIdx) const;
+    void        SetAccelerationStructureSize(const uint32_t pageIdx, const uint64_t size);
+
+    const GeometryPagerStats& GetStats() const;
+
+private:
+    // first fit over a free list, neighbours merge when freed
+    class PoolAllocator {
+    public:
+        void        Reset(const uint32_t capacity);
+        bool        Allocate(const uint32_t size, uint32_t& offset);
+        void        Free(const uint32_t offset, const uint32_t size);
+
+    private:
+        // offset to size
+        std::map<uint32_t, uint32_t>    mFreeRanges;
+    };
+
+    struct PageState {
+        bool        resident;
+        uint32_t    vertexOffset;
+        uint32_t    faceOffset;
+        uint64_t    asBytes;
+        uint32_t    lastWanted;
+        std::list<uint32_t>::iterator lruPosition;
+    };
+
+    bool        IsWanted(const GeometryPage& page, const GeometryPagerView& view, float& distance) const;
+    // what the page's structure is expected to take before it is built
+    uint64_t    GuessAccelerationStructureBytes(const uint32_t pageIdx) const;
+    // the least recently wanted page, if it isn't wanted by this update
+    bool        EvictOne(std::vector<uint32_t>& evictedPages);
+
+private:
+    const GeometryLoader*   mLoader;
+    uint64_t                mBudgetBytes;
+    uint32_t                mMaxFaultsPerUpdate;
+    uint32_t                mVertexCapacity;
+    uint32_t                mFaceCapacity;
+    PoolAllocator           mVertexPool;
+    PoolAllocator           mFacePool;
+    std::vector<PageState>  mPages;
+    // most recently wanted first
+    std::list<uint32_t>     mLRU;
+    uint32_t                mUpdateIndex;
+    // every structure size reported so far and the faces they were built over
+    uint64_t                mReportedASBytes;
+    uint64_t                mReportedASFaces;
+    GeometryPagerStats      mStats;
+};
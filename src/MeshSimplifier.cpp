@@ -0,0 +1,342 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+// borders weigh this much more than faces of the same size, so open edges don't shrink away
+static const double sBorderWeight = 100.0;
+// a collapse may turn a face by up to ~78 degrees, past that it counts as folded over
+static const double sMaxNormalTurnCos = 0.2;
+
+namespace {
+
+// symmetric 4x4 sum of squared plane distances, upper triangle row by row
+struct Quadric {
+    double q[10];
+
+    Quadric() {
+        std::fill(q, q + 10, 0.0);
+    }
+
+    // plane n.p + d = 0, n normalized
+    void AddPlane(const double nx, const double ny, const double nz, const double d, const double weight) {
+        q[0] += weight * nx * nx; q[1] += weight * nx * ny; q[2] += weight * nx * nz; q[3] += weight * nx * d;
+        q[4] += weight * ny * ny; q[5] += weight * ny * nz; q[6] += weight * ny * d;
+        q[7] += weight * nz * nz; q[8] += weight * nz * d;
+        q[9] += weight * d * d;
+    }
+
+    void Add(const Quadric& other) {
+        for (int i = 0; i < 10; ++i) {
+            q[i] += other.q[i];
+        }
+    }
+
+    double Evaluate(const vec3& p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+             + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+             + q[7] * z * z + 2.0 * q[8] * z
+             + q[9];
+    }
+
+    // the point of least error, false when the quadric is too flat to have one
+    bool Minimize(vec3& p) const {
+        const double a = q[0], b = q[1], c = q[2], e = q[4], f = q[5], h = q[7];
+        const double det = a * (e * h - f * f) - b * (b * h - f * c) + c * (b * f - e * c);
+        if (std::abs(det) < 1e-12) {
+            return false;
+        }
+
+        const double dx = -q[3], dy = -q[6], dz = -q[8];
+        const double invDet = 1.0 / det;
+        p.x = static_cast<float>(invDet * (dx * (e * h - f * f) - b * (dy * h - f * dz) + c * (dy * f - e * dz)));
+        p.y = static_cast<float>(invDet * (a * (dy * h - f * dz) - dx * (b * h - f * c) + c * (b * dz - dy * c)));
+        p.z = static_cast<float>(invDet * (a * (e * dz - dy * f) - b * (b * dz - dy * c) + dx * (b * f - e * c)));
+        return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+    }
+};
+
+struct Collapse {
+    double      cost;
+    uint32_t    v0;
+    uint32_t    v1;
+    uint32_t    version0;
+    uint32_t    version1;
+    vec3        position;
+
+    bool operator>(const Collapse& other) const {
+        return cost > other.cost;
+    }
+};
+
+} // namespace
+
+void MeshSimplifier::Simplify(const Mesh& mesh, const size_t targetFaces, Mesh& result) {
+    const size_t numVertices = mesh.positions.size();
+    const size_t numFaces = mesh.faces.size();
+
+    // weld by exact position, sorting keeps it deterministic
+    std::vector<uint32_t> order(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        order[i] = i;
+    }
+    auto PositionLess = [&mesh](const uint32_t a, const uint32_t b) {
+        const vec3& pa = mesh.positions[a];
+        const vec3& pb = mesh.positions[b];
+        return (pa.x != pb.x) ? pa.x < pb.x : ((pa.y != pb.y) ? pa.y < pb.y : pa.z < pb.z);
+    };
+    std::sort(order.begin(), order.end(), PositionLess);
+
+    std::vector<uint32_t> welded(numVertices);
+    std::vector<vec3> positions;
+    for (size_t i = 0; i < numVertices; ++i) {
+        if (i == 0 || PositionLess(order[i - 1], order[i])) {
+            positions.push_back(mesh.positions[order[i]]);
+        }
+        welded[order[i]] = static_cast<uint32_t>(positions.size() - 1);
+    }
+    const size_t numWelded = positions.size();
+
+    // corners of the welded faces, faces already degenerate after welding are gone from the start
+    std::vector<uint32_t> corners(numFaces * 3);
+    std::vector<bool> faceAlive(numFaces, false);
+    size_t numAlive = 0;
+    for (size_t f = 0; f < numFaces; ++f) {
+        const Face& face = mesh.faces[f];
+        corners[f * 3 + 0] = welded[face.a];
+        corners[f * 3 + 1] = welded[face.b];
+        corners[f * 3 + 2] = welded[face.c];
+        faceAlive[f] = corners[f * 3 + 0] != corners[f * 3 + 1] && corners[f * 3 + 1] != corners[f * 3 + 2] && corners[f * 3 + 2] != corners[f * 3 + 0];
+        numAlive += faceAlive[f] ? 1 : 0;
+    }
+
+    std::vector<Quadric> quadrics(numWelded);
+    std::vector<std::vector<uint32_t>> vertexFaces(numWelded);
+    // edge to the number of faces using it and the last of them
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> edges;
+    auto EdgeKey = [](const uint32_t a, const uint32_t b) -> uint64_t {
+        return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+    };
+    auto FaceNormal = [](const vec3& p0, const vec3& p1, const vec3& p2) -> vec3 {
+        return glm::cross(p1 - p0, p2 - p0);
+    };
+
+    for (uint32_t f = 0; f < numFaces; ++f) {
+        if (!faceAlive[f]) {
+            continue;
+        }
+
+        const uint32_t* c = &corners[f * 3];
+        const vec3 normal = FaceNormal(positions[c[0]], positions[c[1]], positions[c[2]]);
+        const double length = glm::length(normal);
+        for (int k = 0; k < 3; ++k) {
+            vertexFaces[c[k]].push_back(f);
+
+            auto& edge = edges[EdgeKey(c[k], c[(k + 1) % 3])];
+            ++edge.first;
+            edge.second = f;
+        }
+        if (length <= 0.0) {
+            continue;
+        }
+
+        // weighted by area, big faces hold their shape
+        const vec3 n = normal / static_cast<float>(length);
+        const double d = -glm::dot(n, positions[c[0]]);
+        for (int k = 0; k < 3; ++k) {
+            quadrics[c[k]].AddPlane(n.x, n.y, n.z, d, 0.5 * length);
+        }
+    }
+
+    // a border edge gets a plane through it at a right angle to its face
+    for (const auto& edge : edges) {
+        if (edge.second.first != 1) {
+            continue;
+        }
+
+        const uint32_t v0 = static_cast<uint32_t>(edge.first >> 32);
+        const uint32_t v1 = static_cast<uint32_t>(edge.first & 0xFFFFFFFFu);
+        const uint32_t* c = &corners[edge.second.second * 3];
+        const vec3 faceNormal = FaceNormal(positions[c[0]], positions[c[1]], positions[c[2]]);
+        const vec3 direction = positions[v1] - positions[v0];
+        const vec3 normal = glm::cross(direction, faceNormal);
+        const double length = glm::length(normal);
+        if (length <= 0.0) {
+            continue;
+        }
+
+        const vec3 n = normal / static_cast<float>(length);
+        const double d = -glm::dot(n, positions[v0]);
+        const double weight = sBorderWeight * glm::dot(direction, direction);
+        quadrics[v0].AddPlane(n.x, n.y, n.z, d, weight);
+        quadrics[v1].AddPlane(n.x, n.y, n.z, d, weight);
+    }
+
+    // stale heap entries are told apart by the vertex versions, a collapse bumps both ends
+    std::vector<uint32_t> versions(numWelded, 0);
+    std::vector<uint32_t> collapsedInto(numWelded);
+    for (uint32_t v = 0; v < numWelded; ++v) {
+        collapsedInto[v] = v;
+    }
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    auto PushCollapse = [&](const uint32_t v0, const uint32_t v1) {
+        Quadric quadric = quadrics[v0];
+        quadric.Add(quadrics[v1]);
+
+        Collapse collapse;
+        collapse.v0 = v0;
+        collapse.v1 = v1;
+        collapse.version0 = versions[v0];
+        collapse.version1 = versions[v1];
+        if (!quadric.Minimize(collapse.position)) {
+            collapse.position = (positions[v0] + positions[v1]) * 0.5f;
+        }
+        collapse.cost = quadric.Evaluate(collapse.position);
+
+        // the optimum of a nearly flat quadric can land far off, the ends are safe bets
+        for (const vec3& candidate : { positions[v0], positions[v1] }) {
+            const double cost = quadric.Evaluate(candidate);
+            if (cost < collapse.cost) {
+                collapse.cost = cost;
+                collapse.position = candidate;
+            }
+        }
+        heap.push(collapse);
+    };
+
+    for (const auto& edge : edges) {
+        PushCollapse(static_cast<uint32_t>(edge.first >> 32), static_cast<uint32_t>(edge.first & 0xFFFFFFFFu));
+    }
+    edges.clear();
+
+    // no face around either end may fold over, the ones on the edge itself disappear
+    auto FoldsOver = [&](const uint32_t v, const uint32_t other, const vec3& position) -> bool {
+        for (const uint32_t f : vertexFaces[v]) {
+            const uint32_t* c = &corners[f * 3];
+            if (!faceAlive[f] || c[0] == other || c[1] == other || c[2] == other) {
+                continue;
+            }
+
+            const vec3 before = FaceNormal(positions[c[0]], positions[c[1]], positions[c[2]]);
+            const vec3 after = FaceNormal(c[0] == v ? position : positions[c[0]], c[1] == v ? position : positions[c[1]], c[2] == v ? position : positions[c[2]]);
+            const double lengths = static_cast<double>(glm::length(before)) * glm::length(after);
+            if (lengths <= 0.0 || glm::dot(before, after) < sMaxNormalTurnCos * lengths) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<uint32_t> neighbours;
+    while (numAlive > targetFaces && !heap.empty()) {
+        const Collapse collapse = heap.top();
+        heap.pop();
+
+        const uint32_t v0 = collapse.v0;
+        const uint32_t v1 = collapse.v1;
+        if (collapse.version0 != versions[v0] || collapse.version1 != versions[v1] ||
+            collapsedInto[v0] != v0 || collapsedInto[v1] != v1) {
+            continue;
+        }
+        if (FoldsOver(v0, v1, collapse.position) || FoldsOver(v1, v0, collapse.position)) {
+            continue;
+        }
+
+        // v1 goes into v0, faces on the edge die, the rest of v1's move over
+        positions[v0] = collapse.position;
+        quadrics[v0].Add(quadrics[v1]);
+        collapsedInto[v1] = v0;
+        ++versions[v0];
+        ++versions[v1];
+
+        for (const uint32_t f : vertexFaces[v1]) {
+            if (!faceAlive[f]) {
+                continue;
+            }
+
+            uint32_t* c = &corners[f * 3];
+            if (c[0] == v0 || c[1] == v0 || c[2] == v0) {
+                faceAlive[f] = false;
+                --numAlive;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                c[k] = (c[k] == v1) ? v0 : c[k];
+            }
+            vertexFaces[v0].push_back(f);
+        }
+        std::vector<uint32_t>().swap(vertexFaces[v1]);
+
+        std::vector<uint32_t>& faces = vertexFaces[v0];
+        faces.erase(std::remove_if(faces.begin(), faces.end(), [&faceAlive](const uint32_t f) { return !faceAlive[f]; }), faces.end());
+
+        // every edge around v0 changed cost
+        neighbours.clear();
+        for (const uint32_t f : faces) {
+            for (int k = 0; k < 3; ++k) {
+                const uint32_t v = corners[f * 3 + k];
+                if (v != v0) {
+                    neighbours.push_back(v);
+                }
+            }
+        }
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (const uint32_t v : neighbours) {
+            PushCollapse(v0, v);
+        }
+    }
+
+    // a corner keeps its own attributes at the position its welded vertex ended up at, corners
+    // that now share a position and attributes share a vertex
+    auto Resolve = [&collapsedInto](uint32_t v) {
+        while (collapsedInto[v] != v) {
+            v = collapsedInto[v] = collapsedInto[collapsedInto[v]];
+        }
+        return v;
+    };
+
+    result = Mesh();
+    result.faces.reserve(numAlive);
+    result.materialIDs.reserve(numAlive);
+    std::vector<uint32_t> remap(numVertices, UINT32_MAX);
+    std::vector<std::vector<uint32_t>> weldedOutputs(numWelded);
+    for (size_t f = 0; f < numFaces; ++f) {
+        if (!faceAlive[f]) {
+            continue;
+        }
+
+        uint32_t out[3];
+        const uint32_t source[3] = { mesh.faces[f].a, mesh.faces[f].b, mesh.faces[f].c };
+        for (int k = 0; k < 3; ++k) {
+            uint32_t& index = remap[source[k]];
+            if (index == UINT32_MAX) {
+                const vec3& normal = mesh.normals[source[k]];
+                const vec2& uv = mesh.uvs[source[k]];
+                std::vector<uint32_t>& outputs = weldedOutputs[Resolve(welded[source[k]])];
+                for (const uint32_t candidate : outputs) {
+                    if (result.normals[candidate] == normal && result.uvs[candidate] == uv) {
+                        index = candidate;
+                        break;
+                    }
+                }
+            }
+            if (index == UINT32_MAX) {
+                const uint32_t v = Resolve(welded[source[k]]);
+                index = static_cast<uint32_t>(result.positions.size());
+                result.positions.push_back(positions[v]);
+                result.normals.push_back(mesh.normals[source[k]]);
+                result.uvs.push_back(mesh.uvs[source[k]]);
+                weldedOutputs[v].push_back(index);
+            }
+            out[k] = index;
+        }
+        result.faces.push_back({ out[0], out[1], out[2] });
+        result.materialIDs.push_back(mesh.materialIDs[f]);
+    }
+}
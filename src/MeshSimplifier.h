@@ -0,0 +1,15 @@
+#pragma once
+#include "GeometryLoader.h"
+
+// Edge collapse simplification by quadric error (Garland and Heckbert), for the level of detail
+// chains GeometryLoader keeps in its cache. Runs offline, the result is only as good as the
+// heuristics below are for the meshes at hand.
+class MeshSimplifier {
+public:
+    // Collapses the cheapest edges until at most targetFaces faces are left, or no edge can go
+    // without folding a face over. Vertices are welded by position first, so meshes with a vertex
+    // per corner simplify too; every corner keeps its normal and uv and only its position moves.
+    // Open borders are held in place by planes through them. Faces keep their material and their
+    // order, vertices come out in first use order, corners that end up alike share one.
+    static void Simplify(const Mesh& mesh, const size_t targetFaces, Mesh& result);
+};
@@ -0,0 +1,233 @@
+#include "Sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+SamplerTables_s SamplerTables;
+
+static bool sSamplerTablesBuilt = false;
+
+void Sampler::Init() {
+    if (sSamplerTablesBuilt) {
+        return;
+    }
+    Sampler::BuildSobolMatrices();
+    Sampler::BuildBlueNoise();
+    sSamplerTablesBuilt = true;
+}
+
+void Sampler::BuildSobolMatrices() {
+    // primitive polynomials and initial direction numbers of the dimensions after the first one,
+    // from new-joe-kuo-6.21201
+    struct SobolPolynomial {
+        uint32_t    degree;
+        uint32_t    coefficients;
+        uint32_t    initial[3];
+    };
+    static const SobolPolynomial sPolynomials[SWS_SAMPLER_SOBOL_DIMS - 1] = {
+        { 1, 0, { 1, 0, 0 } },
+        { 2, 1, { 1, 3, 0 } },
+        { 3, 1, { 1, 3, 1 } },
+    };
+
+    // the first dimension is the van der Corput sequence
+    uint32_t* matrix = SamplerTables.sobolMatrices;
+    for (uint32_t bit = 0; bit < SWS_SAMPLER_SOBOL_BITS; ++bit) {
+        matrix[bit] = 1u << (31 - bit);
+    }
+
+    for (uint32_t dim = 1; dim < SWS_SAMPLER_SOBOL_DIMS; ++dim) {
+        const SobolPolynomial& polynomial = sPolynomials[dim - 1];
+        const uint32_t degree = polynomial.degree;
+        matrix = SamplerTables.sobolMatrices + dim * SWS_SAMPLER_SOBOL_BITS;
+
+        for (uint32_t bit = 0; bit < SWS_SAMPLER_SOBOL_BITS; ++bit) {
+            if (bit < degree) {
+                matrix[bit] = polynomial.initial[bit] << (31 - bit);
+                continue;
+            }
+            matrix[bit] = matrix[bit - degree] ^ (matrix[bit - degree] >> degree);
+            for (uint32_t k = 1; k < degree; ++k) {
+                if ((polynomial.coefficients >> (degree - 1 - k)) & 1u) {
+                    matrix[bit] ^= matrix[bit - k];
+                }
+            }
+        }
+    }
+}
+
+void Sampler::BuildBlueNoise() {
+    const int size = static_cast<int>(SWS_SAMPLER_BLUE_NOISE_SIZE);
+    const int count = size * size;
+
+    // the paper's gaussian with sigma 1.5, wrapped around so the tile repeats seamlessly
+    std::vector<float> kernel(count);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const float dx = static_cast<float>(std::min(x, size - x));
+            const float dy = static_cast<float>(std::min(y, size - y));
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * 1.5f * 1.5f));
+        }
+    }
+
+    std::vector<uint8_t> pattern(count, 0);
+    std::vector<float> energy(count, 0.0f);
+
+    auto Toggle = [&](const int index) {
+        const float sign = pattern[index] ? -1.0f : 1.0f;
+        pattern[index] ^= 1;
+        const int px = index % size;
+        const int py = index / size;
+        for (int y = 0; y < size; ++y) {
+            const float* kernelRow = kernel.data() + ((y - py + size) % size) * size;
+            float* energyRow = energy.data() + y * size;
+            for (int x = 0; x < size; ++x) {
+                energyRow[x] += sign * kernelRow[(x - px + size) % size];
+            }
+        }
+    };
+    // the set pixel with the most neighbours, or the unset one with the fewest
+    auto Extreme = [&](const uint8_t value) {
+        int best = -1;
+        for (int i = 0; i < count; ++i) {
+            if (pattern[i] == value && (best < 0 || (value ? energy[i] > energy[best] : energy[i] < energy[best]))) {
+                best = i;
+            }
+        }
+        return best;
+    };
+
+    // a tenth of the pixels from a fixed seed, the tile comes out the same every run
+    int initialCount = 0;
+    for (uint32_t state = 1; initialCount < count / 10; ) {
+        state = HashUint(state);
+        const int index = static_cast<int>(state % static_cast<uint32_t>(count));
+        if (!pattern[index]) {
+            Toggle(index);
+            ++initialCount;
+        }
+    }
+
+    // spread it out, the tightest cluster moves into the largest void until it stays put; a swap
+    // can cycle between equal energies, every pixel moving once is more than it ever needs
+    for (int iteration = 0; iteration < count; ++iteration) {
+        const int cluster = Extreme(1);
+        Toggle(cluster);
+        const int gap = Extreme(0);
+        Toggle(gap);
+        if (gap == cluster) {
+            break;
+        }
+    }
+
+    const std::vector<uint8_t> initialPattern = pattern;
+    const std::vector<float> initialEnergy = energy;
+    std::vector<uint32_t> ranks(count);
+
+    // the initial pixels are ranked by taking the clusters away
+    for (int rank = initialCount - 1; rank >= 0; --rank) {
+        const int cluster = Extreme(1);
+        Toggle(cluster);
+        ranks[cluster] = static_cast<uint32_t>(rank);
+    }
+
+    // the others by filling the voids
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for (int rank = initialCount; rank < count; ++rank) {
+        const int gap = Extreme(0);
+        Toggle(gap);
+        ranks[gap] = static_cast<uint32_t>(rank);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        SamplerTables.blueNoise[i] = static_cast<uint32_t>((static_cast<uint64_t>(ranks[i]) << 32) / static_cast<uint64_t>(count));
+    }
+}
+
+bool Sampler::PrintConvergenceReport() {
+    Sampler::Init();
+
+    struct Integrand {
+        const char* name;
+        double      (*function)(double x, double y);
+        double      reference;
+    };
+    const double pi = 3.14159265358979323846;
+    const double gaussian = 0.5 * std::sqrt(pi) * std::erf(1.0);
+    const Integrand integrands[] = {
+        { "gaussian",     [](double x, double y) { return std::exp(-(x * x + y * y)); }, gaussian * gaussian },
+        { "quarter disk", [](double x, double y) { return (x * x + y * y < 1.0) ? 1.0 : 0.0; }, pi * 0.25 },
+    };
+    const uint32_t sampleCounts[] = { 1, 4, 16, 64, 256, 1024 };
+    const size_t numCounts = sizeof(sampleCounts) / sizeof(sampleCounts[0]);
+    // every pixel of a 64 x 16 block is an independent estimate
+    const uint32_t numTrials = 1024;
+
+    // a hash per sample and dimension, what uncorrelated random numbers would do
+    auto WhiteNoise2D = [](uvec2 pixel, uint32_t sampleIndex) {
+        const uint32_t seed = HashUint(HashUint(pixel.x + HashUint(pixel.y)) + sampleIndex);
+        return vec2(UintToUnitFloat(HashUint(seed)), UintToUnitFloat(HashUint(seed + 0x9E3779B9u)));
+    };
+
+    // slope of log(error) over log(samples), -0.5 is plain Monte Carlo
+    auto FitRate = [&](const std::vector<double>& errors) {
+        double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+        for (size_t i = 0; i < numCounts; ++i) {
+            const double x = std::log(static_cast<double>(sampleCounts[i]));
+            const double y = std::log(std::max(errors[i], 1e-12));
+            sx += x;
+            sy += y;
+            sxx += x * x;
+            sxy += x * y;
+        }
+        const double n = static_cast<double>(numCounts);
+        return (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    };
+
+    bool faster = true;
+    std::cout << std::fixed << std::setprecision(6);
+    for (const Integrand& integrand : integrands) {
+        std::vector<double> whiteErrors(numCounts), samplerErrors(numCounts);
+
+        for (size_t c = 0; c < numCounts; ++c) {
+            double whiteSum = 0.0, samplerSum = 0.0;
+            for (uint32_t trial = 0; trial < numTrials; ++trial) {
+                const uvec2 pixel(trial % 64, trial / 64);
+
+                double whiteEstimate = 0.0, samplerEstimate = 0.0;
+                for (uint32_t n = 0; n < sampleCounts[c]; ++n) {
+                    const vec2 white = WhiteNoise2D(pixel, n);
+                    const vec2 sampled = SamplerGet2D(pixel, n, SWS_SAMPLE_DIM_PIXEL);
+                    whiteEstimate += integrand.function(white.x, white.y);
+                    samplerEstimate += integrand.function(sampled.x, sampled.y);
+                }
+
+                const double whiteError = whiteEstimate / sampleCounts[c] - integrand.reference;
+                const double samplerError = samplerEstimate / sampleCounts[c] - integrand.reference;
+                whiteSum += whiteError * whiteError;
+                samplerSum += samplerError * samplerError;
+            }
+            whiteErrors[c] = std::sqrt(whiteSum / numTrials);
+            samplerErrors[c] = std::sqrt(samplerSum / numTrials);
+        }
+
+        std::cout << "Sampler convergence, " << integrand.name << "\n"
+                  << "  samples     white rmse    sampler rmse\n";
+        for (size_t c = 0; c < numCounts; ++c) {
+            std::cout << "  " << std::setw(7) << sampleCounts[c] << "  " << std::setw(12) << whiteErrors[c] << "  " << std::setw(12) << samplerErrors[c] << "\n";
+        }
+
+        const double whiteRate = FitRate(whiteErrors);
+        const double samplerRate = FitRate(samplerErrors);
+        std::cout << std::setprecision(2) << "  rate        " << std::setw(12) << whiteRate << "  " << std::setw(12) << samplerRate << "\n" << std::setprecision(6);
+
+        // anything stratified beats the -0.5 of white noise by a wide margin
+        faster = faster && samplerRate < whiteRate - 0.15;
+    }
+
+    return faster;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "shared_with_shaders.h"
+
+// The tables sampler_with_shaders.h reads on the CPU, built by Sampler::Init
+extern SamplerTables_s SamplerTables;
+
+#include "sampler_with_shaders.h"
+
+// Builds the sampler tables: Sobol direction numbers (Joe and Kuo) and a blue noise tile made by
+// void and cluster (Ulichney). The renderer uploads them as they are, so SamplerGet1D and
+// SamplerGet2D return the same values on both sides.
+class Sampler {
+public:
+    // later calls return right away
+    static void Init();
+
+    // Prints the RMS error of integrals over the unit square against the sample count, for white
+    // noise and for the sampler, with the convergence rate fitted in log-log space. False when
+    // the sampler doesn't converge clearly faster than white noise.
+    static bool PrintConvergenceReport();
+
+private:
+    static void BuildSobolMatrices();
+    static void BuildBlueNoise();
+};
@@ -1,18 +1,40 @@
 #include "Application.h"
+#include "TextureCache.h"
+#include "Profiler.h"
+#include "StartupReport.h"
+#include "MemoryTracker.h"
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb\stb_image.h"
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <cstring>
 
 std::wstring ToString(VkResult value)
 {
     return std::to_wstring(value);
 }
 
+// VkPipelineCacheHeaderVersionOne, the header does not declare it yet
+struct PipelineCacheHeader
+{
+    uint32_t HeaderSize;
+    uint32_t HeaderVersion;
+    uint32_t VendorID;
+    uint32_t DeviceID;
+    uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+};
+
 void LogError(const std::wstring& message, bool silent)
 {
+#ifdef _WIN32
     if (!silent)
     {
         MessageBox(nullptr, message.c_str(), L"Error", MB_OK | MB_ICONERROR);
     }
+#else
+    // nothing but the console to report to
+    (void)silent;
+#endif
     std::cerr << message.c_str() << "\n";
 }
 
@@ -28,9 +50,12 @@ VkDevice ResourceBase::_device;
 VkPhysicalDeviceMemoryProperties ResourceBase::_physicalDeviceMemoryProperties;
 VkCommandPool ResourceBase::_commandPool;
 VkQueue ResourceBase::_transferQueue;
+Profiler* ResourceBase::_profiler = nullptr;
+MemoryTracker* ResourceBase::_memoryTracker = nullptr;
 
 std::wstring ShaderResource::_folderPath;
 std::wstring ImageResource::_folderPath;
+TextureCache* ImageResource::_textureCache = nullptr;
 
 Application* Application::_applicationInstance = nullptr;
 
@@ -40,6 +65,7 @@ Application::Application()
     , _shadersFolder(L"/Assets/Shaders/")
     , _imagesFolder(L"/Assets/Textures/")
     , _geometryFolder(L"/Assets/Geometries/")
+    , _startupReport(new StartupReport())
 {
     _applicationInstance = this;
 }
@@ -71,6 +97,13 @@ Application::~Application()
         NVVK_RESOLVE_INSTANCE_FUNCTION_ADDRESS(_instance, vkDestroyDebugReportCallbackEXT);
         vkDestroyDebugReportCallbackEXT(_instance, _debugReportCallback, nullptr);
     }
+    if (_pipelineCache)
+    {
+        vkDestroyPipelineCache(_device, _pipelineCache, nullptr);
+    }
+    ResourceBase::SetProfiler(nullptr);
+    _profiler.reset();
+    ResourceBase::SetMemoryTracker(nullptr);
     if (_device)
     {
         vkDestroyDevice(_device, nullptr);
@@ -79,6 +112,15 @@ Application::~Application()
     {
         vkDestroyInstance(_instance, nullptr);
     }
+    // still open when the loop was left through RequestQuit
+    if (_platform)
+    {
+        _platform->CloseWindow();
+    }
+    if (_applicationInstance == this)
+    {
+        _applicationInstance = nullptr;
+    }
 }
 
 Application* Application::GetInstance()
@@ -93,28 +135,18 @@ void Application::Run()
     Shutdown();
 }
 
-void Application::HandleMessages(MsgInfo* info)
+void Application::SetHeadless(bool headless)
 {
-    switch (info->uMsg)
-    {
-    case WM_CLOSE:
-        DestroyWindow(info->hWnd);
-        PostQuitMessage(0);
-        break;
+    _settings.Headless = headless;
+}
 
-    case WM_KEYDOWN:
-        switch (info->wParam)
-        {
-        case VK_ESCAPE:
-            PostQuitMessage(0);
-            break;
-        }
-        break;
-    }
+void Application::RequestQuit()
+{
+    _quitRequested = true;
 }
 
-VKAPI_ATTR VkBool32 VKAPI_CALL MessageCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objType,
-    uint64_t srcObject, size_t location, int32_t msgCode, const char* pLayerPrefix, const char* pMsg, void* pUserData)
+VKAPI_ATTR VkBool32 VKAPI_CALL MessageCallback(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT /*objType*/,
+    uint64_t /*srcObject*/, size_t /*location*/, int32_t msgCode, const char* pLayerPrefix, const char* pMsg, void* /*pUserData*/)
 {
     std::stringstream debugMessage;
     
@@ -146,147 +178,114 @@ VKAPI_ATTR VkBool32 VKAPI_CALL MessageCallback(VkDebugReportFlagsEXT flags, VkDe
     return VK_FALSE;
 }
 
-LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
-{
-    Application* application = Application::GetInstance();
-    if (application != nullptr)
-    {
-        MsgInfo info{ hWnd, uMsg, wParam, lParam };
-        application->HandleMessages(&info);
-    }
-    return (DefWindowProc(hWnd, uMsg, wParam, lParam));
-}
-
 void Application::Initialize()
 {
+    _startupReport->BeginPhase("startup");
+
+    _startupReport->BeginPhase("common");
     InitCommon();
+    _startupReport->EndPhase();
+
+    _startupReport->BeginPhase("window");
     CreateApplicationWindow();
     GetSettings();
+    _startupReport->EndPhase();
+
+    _startupReport->BeginPhase("instance");
     CreateInstance();
     CreateDebugReportCallback();
+    _startupReport->EndPhase();
+
+    _startupReport->BeginPhase("device");
     FindDeviceAndQueues();
     CreateDevice();
     PostCreateDevice();
-    CreateSurface();
-    CreateSwapchain();
-    CreateFences();
+    CreateMemoryTracker();
+    CreatePipelineCache();
+    // before the swapchain, the headless images are resources too
     CreateCommandPool();
     ResourceBase::Init(_physicalDevice, _device, _commandPool, _queuesInfo.Graphics.Queue);
+    _startupReport->EndPhase();
+
+    _startupReport->BeginPhase("swapchain");
+    if (_platform->IsHeadless())
+    {
+        CreateHeadlessImages();
+    }
+    else
+    {
+        CreateSurface();
+        CreateSwapchain();
+    }
+    CreateFences();
+    _startupReport->EndPhase();
+
+    _startupReport->BeginPhase("frame_resources");
     CreateOffsreenBuffers();
     CreateCommandBuffers();
+    CreateProfiler();
     CreateSynchronization();
+    _startupReport->EndPhase();
 
-    Init(); // finally call user initialize code
+    // finally call user initialize code, it can add nested phases
+    _startupReport->BeginPhase("init");
+    Init();
+    _startupReport->EndPhase();
 
+    _startupReport->BeginPhase("record_commands");
     FillCommandBuffers();
+    _startupReport->EndPhase();
 
-    NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkAcquireNextImageKHR);
-    NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkQueuePresentKHR);
+    if (!_platform->IsHeadless())
+    {
+        NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkAcquireNextImageKHR);
+        NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkQueuePresentKHR);
+    }
+
+    _startupReport->EndPhase();
+
+    _startupReport->Print();
+    _startupReport->WriteJson(_basePath + L"/" + _appName + L"_startup.json");
 }
 
 void Application::Loop()
 {
-    MSG msg;
-    bool quitMessageReceived = false;
-    while (!quitMessageReceived)
+    // the same loop with and without a window, so headless numbers compare to windowed ones
+    while (!_quitRequested && _platform->PumpEvents())
     {
-        while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
-        {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
-            if (msg.message == WM_QUIT)
-            {
-                quitMessageReceived = true;
-                break;
-            }
-        }
-        if (!quitMessageReceived)
-        {
-            DrawFrame();
-        }
+        DrawFrame();
     }
 }
 
 void Application::Shutdown()
 {
     vkDeviceWaitIdle(_device);
+    SavePipelineCache();
+
+    if (_profiler)
+    {
+        _profiler->PrintStats();
+        _profiler->WriteChromeTrace(_basePath + L"/" + _appName + L"_trace.json");
+    }
 }
 
 void Application::InitCommon()
 {
-    TCHAR dest[MAX_PATH];
-    const DWORD length = GetModuleFileName(nullptr, dest, MAX_PATH);
-    PathRemoveFileSpec(dest);
-
-    _basePath = std::wstring(dest);
+    _basePath = Platform::GetExecutableFolder();
     ShaderResource::SetFolderPath(_basePath + _shadersFolder);
     ImageResource::SetFolderPath(_basePath + _imagesFolder);
 }
 
 void Application::CreateApplicationWindow()
 {
-    _windowInfo.WindowInstance = GetModuleHandle(0);
-
-    WNDCLASSEX wndClass;
-    wndClass.cbSize = sizeof(WNDCLASSEX);
-    wndClass.style = CS_HREDRAW | CS_VREDRAW;
-    wndClass.lpfnWndProc = WndProc;
-    wndClass.cbClsExtra = 0;
-    wndClass.cbWndExtra = 0;
-    wndClass.hInstance = _windowInfo.WindowInstance;
-    wndClass.hIcon = LoadIcon(nullptr, IDI_APPLICATION);
-    wndClass.hCursor = LoadCursor(nullptr, IDC_ARROW);
-    wndClass.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
-    wndClass.lpszMenuName = nullptr;
-    wndClass.lpszClassName = _appName.c_str();
-    wndClass.hIconSm = LoadIcon(nullptr, IDI_WINLOGO);
-
-    if (!RegisterClassEx(&wndClass))
-    {
-        ExitError(L"Failed RegisterClassEx");
-    }
-
-    const uint32_t screenWidth = (uint32_t)GetSystemMetrics(SM_CXSCREEN);
-    const uint32_t screenHeight = (uint32_t)GetSystemMetrics(SM_CYSCREEN);
-
     _actualWindowWidth = _settings.DesiredWindowWidth;
     _actualWindowHeight = _settings.DesiredWindowHeight;
 
-    const DWORD exStyle = WS_EX_APPWINDOW | WS_EX_WINDOWEDGE;
-    const DWORD style = WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
-
-    RECT windowRect;
-    windowRect.left = 0;
-    windowRect.top = 0;
-    windowRect.right = _actualWindowWidth;
-    windowRect.bottom = _actualWindowHeight;
-    AdjustWindowRectEx(&windowRect, style, FALSE, exStyle);
-
-    _windowInfo.Window = CreateWindowEx(0,
-        _appName.c_str(),
-        _appName.c_str(),
-        style | WS_CLIPSIBLINGS | WS_CLIPCHILDREN,
-        0,
-        0,
-        windowRect.right - windowRect.left,
-        windowRect.bottom - windowRect.top,
-        nullptr,
-        nullptr,
-        _windowInfo.WindowInstance,
-        nullptr);
-
-    if (!_windowInfo.Window)
+    _platform = Platform::Create(_settings.Headless);
+    if (!_platform->OpenWindow(_appName, _actualWindowWidth, _actualWindowHeight))
     {
         ExitError(L"Failed to create window");
     }
-
-    const uint32_t x = (screenWidth - windowRect.right) / 2;
-    const uint32_t y = (screenHeight - windowRect.bottom) / 2;
-    SetWindowPos(_windowInfo.Window, 0, x, y, 0, 0, SWP_NOZORDER | SWP_NOSIZE);
-
-    ShowWindow(_windowInfo.Window, SW_SHOW);
-    SetForegroundWindow(_windowInfo.Window);
-    SetFocus(_windowInfo.Window);
 }
 
 void Application::GetSettings()
@@ -294,6 +293,9 @@ void Application::GetSettings()
 #ifdef NVVK_FORCE_VALIDATION
     _settings.ValidationEnabled = true;
 #endif
+#ifdef NVVK_DISABLE_VSYNC
+    _settings.VSyncEnabled = false;
+#endif
 }
 
 void Application::CreateInstance()
@@ -309,7 +311,12 @@ void Application::CreateInstance()
     applicationInfo.engineVersion = 0;
     applicationInfo.apiVersion = VK_API_VERSION_1_1;
 
-    std::vector<const char*> enabledExtensions = { VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WIN32_SURFACE_EXTENSION_NAME };
+    std::vector<const char*> enabledExtensions;
+    if (_platform->GetSurfaceExtensionName() != nullptr)
+    {
+        enabledExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        enabledExtensions.push_back(_platform->GetSurfaceExtensionName());
+    }
     if (_settings.ValidationEnabled)
     {
         enabledExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
@@ -421,7 +428,11 @@ void Application::CreateDevice()
         deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
     }
 
-    const std::vector<const char*> deviceExtensions({ VK_KHR_SWAPCHAIN_EXTENSION_NAME });
+    std::vector<const char*> deviceExtensions;
+    if (!_platform->IsHeadless())
+    {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     const VkPhysicalDeviceFeatures features = { };
 
     VkDeviceCreateInfo deviceCreateInfo;
@@ -447,6 +458,123 @@ void Application::PostCreateDevice()
     vkGetDeviceQueue(_device, _queuesInfo.Transfer.QueueFamilyIndex, 0, &_queuesInfo.Transfer.Queue);
 }
 
+void Application::CreateMemoryTracker()
+{
+    _memoryTracker.reset(new MemoryTracker());
+    _memoryTracker->Initialize(_physicalDevice, _memoryBudgetEnabled);
+    ResourceBase::SetMemoryTracker(_memoryTracker.get());
+}
+
+bool Application::IsDeviceExtensionSupported(const char* extensionName) const
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    return std::any_of(extensions.begin(), extensions.end(), [extensionName](const VkExtensionProperties& extension) {
+        return strcmp(extension.extensionName, extensionName) == 0;
+    });
+}
+
+void Application::CreatePipelineCache()
+{
+    _pipelineCacheFilePath = _basePath + L"/_data/cache/pipeline_cache.bin";
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+
+    // The blob from a previous run is only handed to the driver if it was produced by the
+    // same device and driver build, anything else is dropped and the cache starts cold
+    std::vector<char> initialData;
+    std::ifstream file(Platform::ToNativePath(_pipelineCacheFilePath), std::ios::binary | std::ios::ate);
+    if (file.is_open())
+    {
+        const std::streamsize size = file.tellg();
+        if (size >= static_cast<std::streamsize>(sizeof(PipelineCacheHeader)))
+        {
+            initialData.resize(static_cast<size_t>(size));
+            file.seekg(0, std::ios::beg);
+            if (!file.read(initialData.data(), size))
+            {
+                initialData.clear();
+            }
+        }
+        file.close();
+    }
+
+    if (!initialData.empty())
+    {
+        PipelineCacheHeader header;
+        memcpy(&header, initialData.data(), sizeof(header));
+
+        if (header.HeaderSize < sizeof(header) || header.HeaderSize > initialData.size() ||
+            header.HeaderVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            header.VendorID != properties.vendorID ||
+            header.DeviceID != properties.deviceID ||
+            memcmp(header.PipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            std::cout << "Pipeline cache: discarding data from another device or driver\n";
+            initialData.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipelineCacheCreateInfo;
+    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipelineCacheCreateInfo.pNext = nullptr;
+    pipelineCacheCreateInfo.flags = 0;
+    pipelineCacheCreateInfo.initialDataSize = initialData.size();
+    pipelineCacheCreateInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    VkResult code = vkCreatePipelineCache(_device, &pipelineCacheCreateInfo, nullptr, &_pipelineCache);
+    if (code != VK_SUCCESS && !initialData.empty())
+    {
+        // the driver is free to reject data it no longer understands, retry empty
+        pipelineCacheCreateInfo.initialDataSize = 0;
+        pipelineCacheCreateInfo.pInitialData = nullptr;
+        initialData.clear();
+        code = vkCreatePipelineCache(_device, &pipelineCacheCreateInfo, nullptr, &_pipelineCache);
+    }
+    NVVK_CHECK_ERROR(code, L"vkCreatePipelineCache");
+
+    _pipelineCacheWarm = !initialData.empty();
+}
+
+void Application::SavePipelineCache()
+{
+    if (!_pipelineCache || _pipelineCacheFilePath.empty())
+    {
+        return;
+    }
+
+    size_t size = 0;
+    VkResult code = vkGetPipelineCacheData(_device, _pipelineCache, &size, nullptr);
+    if (code != VK_SUCCESS || size == 0)
+    {
+        return;
+    }
+
+    std::vector<char> data(size);
+    code = vkGetPipelineCacheData(_device, _pipelineCache, &size, data.data());
+    if (code != VK_SUCCESS)
+    {
+        LogError(L"vkGetPipelineCacheData ErrorCode: " + ToString(code), true);
+        return;
+    }
+
+    Platform::CreateDirectories(_basePath + L"/_data/cache");
+
+    // an interrupted exit keeps the previous cache, another instance exiting at the same time can't mix into it
+    const bool written = Platform::WriteFileAtomically(_pipelineCacheFilePath, [&](FILE* file)
+    {
+        return fwrite(data.data(), 1, size, file) == size;
+    });
+    if (!written)
+    {
+        LogError(L"Can't write " + _pipelineCacheFilePath, true);
+    }
+}
+
 void Application::CreateDebugReportCallback()
 {
     if (!_settings.ValidationEnabled)
@@ -473,15 +601,8 @@ void Application::CreateDebugReportCallback()
 
 void Application::CreateSurface()
 {
-    VkWin32SurfaceCreateInfoKHR surfaceCreateInfo;
-    surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-    surfaceCreateInfo.pNext = nullptr;
-    surfaceCreateInfo.flags = 0;
-    surfaceCreateInfo.hinstance = _windowInfo.WindowInstance;
-    surfaceCreateInfo.hwnd = _windowInfo.Window;
-
-    VkResult code = vkCreateWin32SurfaceKHR(_instance, &surfaceCreateInfo, nullptr, &_surface);
-    NVVK_CHECK_ERROR(code, L"vkCreateWin32SurfaceKHR");
+    VkResult code = _platform->CreateSurface(_instance, _surface);
+    NVVK_CHECK_ERROR(code, L"Platform::CreateSurface");
 
     PFN_vkGetPhysicalDeviceSurfaceSupportKHR vkGetPhysicalDeviceSurfaceSupportKHR;
     NVVK_RESOLVE_INSTANCE_FUNCTION_ADDRESS(_instance, vkGetPhysicalDeviceSurfaceSupportKHR);
@@ -544,11 +665,23 @@ void Application::CreateSwapchain()
     std::vector<VkPresentModeKHR> presentModes(presentModeCount);
     vkGetPhysicalDeviceSurfacePresentModesKHR(_physicalDevice, _surface, &presentModeCount, presentModes.data());
 
-    bool isMailboxModeSupported = std::find(presentModes.begin(), presentModes.end(), VK_PRESENT_MODE_MAILBOX_KHR) != presentModes.end();
-#ifndef NVVK_DISABLE_VSYNC
-    isMailboxModeSupported = false;
-#endif
-    VkPresentModeKHR presentMode = isMailboxModeSupported ? VK_PRESENT_MODE_MAILBOX_KHR : VK_PRESENT_MODE_FIFO_KHR;
+    auto IsPresentModeSupported = [&presentModes](VkPresentModeKHR mode) -> bool {
+        return std::find(presentModes.begin(), presentModes.end(), mode) != presentModes.end();
+    };
+
+    // FIFO is the only mode that is always there
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    if (!_settings.VSyncEnabled)
+    {
+        if (IsPresentModeSupported(VK_PRESENT_MODE_MAILBOX_KHR))
+        {
+            presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+        else if (IsPresentModeSupported(VK_PRESENT_MODE_IMMEDIATE_KHR))
+        {
+            presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+    }
 
     const VkSwapchainKHR prevSwapchain = _swapchain;
 
@@ -614,6 +747,27 @@ void Application::CreateSwapchain()
     }
 }
 
+void Application::CreateHeadlessImages()
+{
+    // as many as a swapchain would usually have, so as many frames are in flight
+    const uint32_t imageCount = 3;
+
+    _surfaceFormat.format = _settings.DesiredSurfaceFormat;
+    _surfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+    _headlessImages.resize(imageCount);
+    _swapchainImages.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        const VkResult code = _headlessImages[i].CreateImage(VK_IMAGE_TYPE_2D, _surfaceFormat.format,
+            { _actualWindowWidth, _actualWindowHeight, 1 }, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        NVVK_CHECK_ERROR(code, L"CreateImage headless " + std::to_wstring(i));
+
+        _swapchainImages[i] = _headlessImages[i].Image;
+    }
+}
+
 void Application::CreateFences()
 {
     VkFenceCreateInfo fenceCreateInfo;
@@ -621,7 +775,7 @@ void Application::CreateFences()
     fenceCreateInfo.pNext = nullptr;
     fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    _frameReadinessFences.resize(_swapchainImageViews.size());
+    _frameReadinessFences.resize(_swapchainImages.size());
     for (auto& fence : _frameReadinessFences)
         vkCreateFence(_device, &fenceCreateInfo, nullptr, &fence);
 
@@ -671,6 +825,19 @@ void Application::CreateCommandBuffers()
     NVVK_CHECK_ERROR(code, L"vkAllocateCommandBuffers");
 }
 
+void Application::CreateProfiler()
+{
+    // one query slot per prerecorded command buffer
+    const uint32_t maxScopesPerSlot = 16;
+
+    _profiler.reset(new Profiler());
+    const VkResult code = _profiler->Initialize(_physicalDevice, _device, _queuesInfo.Graphics.QueueFamilyIndex,
+        static_cast<uint32_t>(_commandBuffers.size()), maxScopesPerSlot);
+    NVVK_CHECK_ERROR(code, L"Profiler::Initialize");
+
+    ResourceBase::SetProfiler(_profiler.get());
+}
+
 void Application::CreateSynchronization()
 {
     VkSemaphoreCreateInfo semaphoreCreatInfo;
@@ -703,6 +870,10 @@ void Application::CleanupRendering()
         vkDestroyCommandPool(_device, _commandPool, nullptr);
     }
     _offsreenImageResource.Cleanup();
+    for (auto& image : _headlessImages)
+    {
+        image.Cleanup();
+    }
 
     for (auto& fence : _frameReadinessFences)
     {
@@ -752,11 +923,15 @@ void Application::FillCommandBuffers()
         VkResult code = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
         NVVK_CHECK_ERROR(code, L"vkBeginCommandBuffer");
 
+        _profiler->BeginSlot(commandBuffer, i);
+
         ImageBarrier(commandBuffer, _offsreenImageResource.Image, subresourceRange,
             0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
 
         RecordCommandBufferForFrame(commandBuffer, i); // user draw code
 
+        const uint32_t copyScope = _profiler->BeginGpuScope(commandBuffer, i, "copy_to_swapchain");
+
         ImageBarrier(commandBuffer, _swapchainImages[i], subresourceRange,
             0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
 
@@ -772,8 +947,12 @@ void Application::FillCommandBuffers()
         vkCmdCopyImage(commandBuffer, _offsreenImageResource.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
             _swapchainImages[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
 
+        // headless images are left ready for a read back, there is no present layout without the swapchain
         ImageBarrier(commandBuffer, _swapchainImages[i], subresourceRange,
-            VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+            VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            _platform->IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+        _profiler->EndGpuScope(commandBuffer, i, copyScope);
 
         code = vkEndCommandBuffer(commandBuffer);
         NVVK_CHECK_ERROR(code, L"vkEndCommandBuffer");
@@ -782,32 +961,62 @@ void Application::FillCommandBuffers()
 
 void Application::DrawFrame()
 {
+    ProfilerCpuScope frameScope(_profiler.get(), "frame");
+
     uint32_t imageIndex;
-    VkResult code = vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, _imageAcquiredSemaphore, nullptr, &imageIndex);
-    NVVK_CHECK_ERROR(code, L"Failed to acquire next image");
+    VkResult code;
+    VkFence fence;
+    {
+        ProfilerCpuScope waitScope(_profiler.get(), "acquire_and_wait");
 
-    const VkFence fence = _frameReadinessFences[imageIndex];
-    code = vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX);
-    NVVK_CHECK_ERROR(code, L"Failed to wait for fence");
-    vkResetFences(_device, 1, &fence);
+        if (_platform->IsHeadless())
+        {
+            imageIndex = _headlessImageIndex;
+            _headlessImageIndex = (_headlessImageIndex + 1) % static_cast<uint32_t>(_swapchainImages.size());
+        }
+        else
+        {
+            code = vkAcquireNextImageKHR(_device, _swapchain, UINT64_MAX, _imageAcquiredSemaphore, nullptr, &imageIndex);
+            NVVK_CHECK_ERROR(code, L"Failed to acquire next image");
+        }
+
+        fence = _frameReadinessFences[imageIndex];
+        code = vkWaitForFences(_device, 1, &fence, VK_TRUE, UINT64_MAX);
+        NVVK_CHECK_ERROR(code, L"Failed to wait for fence");
+        vkResetFences(_device, 1, &fence);
+    }
 
-    UpdateDataForFrame(imageIndex);
+    // the fence covers the previous submission of this command buffer, its queries are ready
+    _profiler->CollectSlot(imageIndex);
+
+    {
+        ProfilerCpuScope updateScope(_profiler.get(), "update");
+        UpdateDataForFrame(imageIndex);
+    }
 
     const VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
     VkSubmitInfo submitInfo;
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.pNext = nullptr;
-    submitInfo.waitSemaphoreCount = 1;
+    // headless frames only wait on the fence, nothing is acquired or presented
+    const uint32_t semaphoreCount = _platform->IsHeadless() ? 0 : 1;
+    submitInfo.waitSemaphoreCount = semaphoreCount;
     submitInfo.pWaitSemaphores = &_imageAcquiredSemaphore;
     submitInfo.pWaitDstStageMask = &waitStageMask;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &_commandBuffers[imageIndex];
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = semaphoreCount;
     submitInfo.pSignalSemaphores = &_renderFinishedSemaphore;
 
     code = vkQueueSubmit(_queuesInfo.Graphics.Queue, 1, &submitInfo, fence);
     NVVK_CHECK_ERROR(code, L"vkQueueSubmit");
+    _profiler->MarkSubmitted(imageIndex);
+
+    if (_platform->IsHeadless())
+    {
+        return;
+    }
 
     VkPresentInfoKHR presentInfo;
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -832,11 +1041,11 @@ void Application::Cleanup()
 {
 }
 
-void Application::RecordCommandBufferForFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+void Application::RecordCommandBufferForFrame(VkCommandBuffer /*commandBuffer*/, uint32_t /*frameIndex*/)
 {
 }
 
-void Application::UpdateDataForFrame(uint32_t frameIndex)
+void Application::UpdateDataForFrame(uint32_t /*frameIndex*/)
 {
 }
 
@@ -853,6 +1062,16 @@ void ResourceBase::Init(VkPhysicalDevice physicalDevice, VkDevice device, VkComm
     _transferQueue = transferQueue;
 }
 
+void ResourceBase::SetProfiler(Profiler* profiler)
+{
+    _profiler = profiler;
+}
+
+void ResourceBase::SetMemoryTracker(MemoryTracker* memoryTracker)
+{
+    _memoryTracker = memoryTracker;
+}
+
 uint32_t ResourceBase::GetMemoryType(VkMemoryRequirements& memoryRequiriments, VkMemoryPropertyFlags memoryProperties)
 {
     uint32_t result = 0;
@@ -870,6 +1089,51 @@ uint32_t ResourceBase::GetMemoryType(VkMemoryRequirements& memoryRequiriments, V
     return result;
 }
 
+VkResult ResourceBase::AllocateMemory(const VkMemoryAllocateInfo& allocateInfo, VkDeviceMemory& memory, MemoryCategory category)
+{
+    if (_memoryTracker && !_memoryTracker->CanAllocate(allocateInfo.memoryTypeIndex, allocateInfo.allocationSize))
+    {
+        memory = VK_NULL_HANDLE;
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    const VkResult code = vkAllocateMemory(_device, &allocateInfo, nullptr, &memory);
+    if (code != VK_SUCCESS)
+    {
+        return code;
+    }
+
+    if (_memoryTracker)
+    {
+        _memoryTracker->AddAllocation(memory, allocateInfo.memoryTypeIndex, allocateInfo.allocationSize, category);
+    }
+    return code;
+}
+
+void ResourceBase::FreeMemory(VkDeviceMemory memory)
+{
+    if (memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (_memoryTracker)
+    {
+        _memoryTracker->RemoveAllocation(memory);
+    }
+    vkFreeMemory(_device, memory, nullptr);
+}
+
+VkDeviceSize ResourceBase::GetAllocatedMemorySize()
+{
+    return _memoryTracker ? _memoryTracker->GetTotalUsage() : 0;
+}
+
+VkDeviceSize ResourceBase::GetAllocatedMemoryPeak()
+{
+    return _memoryTracker ? _memoryTracker->GetPeakUsage() : 0;
+}
+
 // ============================================================
 // Image resource
 // ============================================================
@@ -884,10 +1148,16 @@ void ImageResource::SetFolderPath(const std::wstring& folderPath)
     _folderPath = folderPath;
 }
 
+void ImageResource::SetTextureCache(TextureCache* textureCache)
+{
+    _textureCache = textureCache;
+}
+
 VkResult ImageResource::CreateImage(VkImageType imageType, VkFormat format, VkExtent3D extent, VkImageTiling tiling,
-    VkImageUsageFlags usage, VkMemoryPropertyFlags memoryProperties)
+    VkImageUsageFlags usage, VkMemoryPropertyFlags memoryProperties, uint32_t mipLevels, MemoryCategory category)
 {
     Format = format;
+    MipLevels = mipLevels;
 
     VkImageCreateInfo imageCreateInfo;
     imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -896,7 +1166,7 @@ VkResult ImageResource::CreateImage(VkImageType imageType, VkFormat format, VkEx
     imageCreateInfo.imageType = imageType;
     imageCreateInfo.format = format;
     imageCreateInfo.extent = extent;
-    imageCreateInfo.mipLevels = 1;
+    imageCreateInfo.mipLevels = mipLevels;
     imageCreateInfo.arrayLayers = 1;
     imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageCreateInfo.tiling = tiling;
@@ -922,7 +1192,7 @@ VkResult ImageResource::CreateImage(VkImageType imageType, VkFormat format, VkEx
     memoryAllocateInfo.allocationSize = memoryRequirements.size;
     memoryAllocateInfo.memoryTypeIndex = GetMemoryType(memoryRequirements, memoryProperties);
 
-    code = vkAllocateMemory(_device, &memoryAllocateInfo, nullptr, &Memory);
+    code = AllocateMemory(memoryAllocateInfo, Memory, category);
     if (code != VK_SUCCESS)
     {
         vkDestroyImage(_device, Image, nullptr);
@@ -935,7 +1205,7 @@ VkResult ImageResource::CreateImage(VkImageType imageType, VkFormat format, VkEx
     if (code != VK_SUCCESS)
     {
         vkDestroyImage(_device, Image, nullptr);
-        vkFreeMemory(_device, Memory, nullptr);
+        FreeMemory(Memory);
         Image = VK_NULL_HANDLE;
         Memory = VK_NULL_HANDLE;
         return code;
@@ -949,54 +1219,54 @@ bool ImageResource::LoadTexture2DFromFile(const std::wstring& fileName, VkResult
     code = VK_SUCCESS;
 
     const std::wstring filePath = _folderPath + fileName;
-    FILE *file;
-    if (_wfopen_s(&file, filePath.c_str(), L"rb") != 0)
+
+    TextureData texture;
+    const bool loaded = _textureCache ? _textureCache->Load(filePath, texture) : TextureCache::Decode(filePath, texture);
+    if (!loaded)
     {
         return false;
     }
 
-    const std::wstring extension = fileName.substr(fileName.length() - 3);
+    // all levels go into one staging buffer, each starting on a 16 byte boundary
+    const uint32_t levelCount = static_cast<uint32_t>(texture.Levels.size());
+    std::vector<VkBufferImageCopy> regions(levelCount);
+    VkDeviceSize imageSize = 0;
 
-    int32_t textureWidth;
-    int32_t textureHeight;
-    int32_t textureChannels;
-    bool textureHDR = false;
-    stbi_uc* pixelData = nullptr;
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        const TextureLevel& level = texture.Levels[i];
 
-    if (extension == L"hdr") {
-        textureHDR = true;
-        pixelData = reinterpret_cast<stbi_uc*>(stbi_loadf_from_file(file, &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha));
-    } else {
-        pixelData = stbi_load_from_file(file, &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha);
-    }
+        regions[i].bufferOffset = (imageSize + 15) & ~VkDeviceSize(15);
+        regions[i].bufferRowLength = 0;
+        regions[i].bufferImageHeight = 0;
+        regions[i].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+        regions[i].imageOffset = { 0, 0, 0 };
+        regions[i].imageExtent = { level.Width, level.Height, 1 };
 
-    if (!pixelData)
-    {
-        stbi_image_free(pixelData);
-        return false;
+        imageSize = regions[i].bufferOffset + level.RowPitch * level.RowCount;
     }
 
-    const int32_t bpp = textureHDR ? sizeof(float[4]) : sizeof(uint8_t[4]);
-    VkDeviceSize imageSize = textureWidth * textureHeight * bpp;
     BufferResource stagingBuffer;
-    code = stagingBuffer.Create(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    code = stagingBuffer.Create(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging);
     if (code != VK_SUCCESS)
     {
-        stbi_image_free(pixelData);
         return false;
     }
 
-    if (!stagingBuffer.CopyToBufferUsingMapUnmap(pixelData, imageSize))
+    uint8_t* stagingMemory = static_cast<uint8_t*>(stagingBuffer.Map(imageSize));
+    if (!stagingMemory)
     {
-        stbi_image_free(pixelData);
         return false;
     }
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        const TextureLevel& level = texture.Levels[i];
+        memcpy(stagingMemory + regions[i].bufferOffset, level.Data, static_cast<size_t>(level.RowPitch * level.RowCount));
+    }
+    stagingBuffer.Unmap();
 
-    stbi_image_free(pixelData);
-
-    VkExtent3D imageExtent { (uint32_t)textureWidth, (uint32_t)textureHeight, 1 };
-    Format = textureHDR ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_SRGB;
-    code = CreateImage(VK_IMAGE_TYPE_2D, Format, imageExtent, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkExtent3D imageExtent { texture.Width, texture.Height, 1 };
+    code = CreateImage(VK_IMAGE_TYPE_2D, texture.Format, imageExtent, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, levelCount, MemoryCategory::Texture);
     if (code != VK_SUCCESS)
     {
         return false;
@@ -1039,19 +1309,23 @@ bool ImageResource::LoadTexture2DFromFile(const std::wstring& fileName, VkResult
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = Image;
-    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
 
     vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    VkBufferImageCopy region;
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = imageExtent;
+    uint32_t uploadScope = 0;
+    if (_profiler)
+    {
+        _profiler->BeginSlot(commandBuffer, _profiler->GetImmediateSlot());
+        uploadScope = _profiler->BeginGpuScope(commandBuffer, _profiler->GetImmediateSlot(), "upload");
+    }
 
-    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.Buffer, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer.Buffer, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions.data());
+
+    if (_profiler)
+    {
+        _profiler->EndGpuScope(commandBuffer, _profiler->GetImmediateSlot(), uploadScope);
+    }
 
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
@@ -1092,6 +1366,12 @@ bool ImageResource::LoadTexture2DFromFile(const std::wstring& fileName, VkResult
         return false;
     }
 
+    if (_profiler)
+    {
+        _profiler->MarkSubmitted(_profiler->GetImmediateSlot());
+        _profiler->CollectSlot(_profiler->GetImmediateSlot());
+    }
+
     vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
 
     return true;
@@ -1118,7 +1398,8 @@ VkResult ImageResource::CreateImageView(VkImageViewType viewType, VkFormat forma
     return code;
 }
 
-VkResult ImageResource::CreateSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerMipmapMode mipmapMode, VkSamplerAddressMode addressMode)
+VkResult ImageResource::CreateSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerMipmapMode mipmapMode, VkSamplerAddressMode addressMode,
+    float maxLod)
 {
     VkSamplerCreateInfo samplerCreateInfo;
     samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -1136,7 +1417,7 @@ VkResult ImageResource::CreateSampler(VkFilter magFilter, VkFilter minFilter, Vk
     samplerCreateInfo.compareEnable = VK_FALSE;
     samplerCreateInfo.compareOp = VK_COMPARE_OP_ALWAYS;
     samplerCreateInfo.minLod = 0;
-    samplerCreateInfo.maxLod = 0;
+    samplerCreateInfo.maxLod = maxLod;
     samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
     samplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
 
@@ -1153,7 +1434,7 @@ void ImageResource::Cleanup()
     }
     if (Memory)
     {
-        vkFreeMemory(_device, Memory, nullptr);
+        FreeMemory(Memory);
         Memory = VK_NULL_HANDLE;
     }
     if (Image)
@@ -1187,7 +1468,7 @@ VkResult ShaderResource::LoadFromFile(const std::wstring& fileName, bool& cantOp
     cantOpenFile = false;
 
     const std::wstring filePath = _folderPath + fileName;
-    std::ifstream fileStream(filePath, std::ios::binary | std::ios::in | std::ios::ate);
+    std::ifstream fileStream(Platform::ToNativePath(filePath), std::ios::binary | std::ios::in | std::ios::ate);
     if (!fileStream.is_open())
     {
         cantOpenFile = true;
@@ -1199,20 +1480,25 @@ VkResult ShaderResource::LoadFromFile(const std::wstring& fileName, bool& cantOp
     fileStream.read(bytecode.data(), shaderSize);
     fileStream.close();
 
+    return LoadFromSpirv((uint32_t*)bytecode.data(), shaderSize);
+}
+
+VkResult ShaderResource::LoadFromSpirv(const uint32_t* code, size_t codeSize)
+{
     VkShaderModuleCreateInfo shaderModuleCreateInfo;
     shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     shaderModuleCreateInfo.pNext = nullptr;
-    shaderModuleCreateInfo.codeSize = shaderSize;
-    shaderModuleCreateInfo.pCode = (uint32_t*)bytecode.data();
+    shaderModuleCreateInfo.codeSize = codeSize;
+    shaderModuleCreateInfo.pCode = code;
     shaderModuleCreateInfo.flags = 0;
 
-    const VkResult code = vkCreateShaderModule(_device, &shaderModuleCreateInfo, nullptr, &_module);
-    if (code != VK_SUCCESS)
+    const VkResult result = vkCreateShaderModule(_device, &shaderModuleCreateInfo, nullptr, &_module);
+    if (result != VK_SUCCESS)
     {
         _module = VK_NULL_HANDLE;
     }
 
-    return code;
+    return result;
 }
 
 VkPipelineShaderStageCreateInfo ShaderResource::GetShaderStage(VkShaderStageFlagBits stage)
@@ -1246,7 +1532,7 @@ BufferResource::~BufferResource()
     Cleanup();
 }
 
-VkResult BufferResource::Create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties)
+VkResult BufferResource::Create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties, MemoryCategory category)
 {
     VkBufferCreateInfo bufferCreateInfo;
     bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1276,7 +1562,7 @@ VkResult BufferResource::Create(VkDeviceSize size, VkBufferUsageFlags usage, VkM
     memoryAllocateInfo.allocationSize = memoryRequirements.size;
     memoryAllocateInfo.memoryTypeIndex = GetMemoryType(memoryRequirements, memoryProperties);
 
-    code = vkAllocateMemory(_device, &memoryAllocateInfo, nullptr, &Memory);
+    code = AllocateMemory(memoryAllocateInfo, Memory, category);
     if (code != VK_SUCCESS)
     {
         vkDestroyBuffer(_device, Buffer, nullptr);
@@ -1289,7 +1575,7 @@ VkResult BufferResource::Create(VkDeviceSize size, VkBufferUsageFlags usage, VkM
     if (code != VK_SUCCESS)
     {
         vkDestroyBuffer(_device, Buffer, nullptr);
-        vkFreeMemory(_device, Memory, nullptr);
+        FreeMemory(Memory);
         Buffer = VK_NULL_HANDLE;
         Memory = VK_NULL_HANDLE;
         return code;
@@ -1307,7 +1593,7 @@ void BufferResource::Cleanup()
     }
     if (Memory)
     {
-        vkFreeMemory(_device, Memory, nullptr);
+        FreeMemory(Memory);
         Memory = VK_NULL_HANDLE;
     }
 }
@@ -1340,4 +1626,93 @@ bool BufferResource::CopyToBufferUsingMapUnmap(const void* memoryToCopyFrom, VkD
     memcpy(mappedMemory, memoryToCopyFrom, size);
     Unmap();
     return true;
+}
+
+bool BufferResource::CopyToBufferUsingStaging(const void* memoryToCopyFrom, VkDeviceSize size) const
+{
+    BufferResource stagingBuffer;
+    VkResult code = stagingBuffer.Create(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging);
+    if (code != VK_SUCCESS || !stagingBuffer.CopyToBufferUsingMapUnmap(memoryToCopyFrom, size))
+    {
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo;
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.commandPool = _commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    code = vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer);
+    if (code != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkCommandBufferBeginInfo beginInfo;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    code = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (code != VK_SUCCESS)
+    {
+        vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+        return false;
+    }
+
+    VkBufferCopy region;
+    region.srcOffset = 0;
+    region.dstOffset = 0;
+    region.size = size;
+    uint32_t uploadScope = 0;
+    if (_profiler)
+    {
+        _profiler->BeginSlot(commandBuffer, _profiler->GetImmediateSlot());
+        uploadScope = _profiler->BeginGpuScope(commandBuffer, _profiler->GetImmediateSlot(), "upload");
+    }
+
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer.Buffer, Buffer, 1, &region);
+
+    if (_profiler)
+    {
+        _profiler->EndGpuScope(commandBuffer, _profiler->GetImmediateSlot(), uploadScope);
+    }
+
+    code = vkEndCommandBuffer(commandBuffer);
+    if (code != VK_SUCCESS)
+    {
+        vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+        return false;
+    }
+
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = nullptr;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = nullptr;
+    submitInfo.pWaitDstStageMask = nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 0;
+    submitInfo.pSignalSemaphores = nullptr;
+
+    // waiting for the queue to drain also makes the copy visible to later submissions
+    code = vkQueueSubmit(_transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (code == VK_SUCCESS)
+    {
+        code = vkQueueWaitIdle(_transferQueue);
+    }
+
+    if (code == VK_SUCCESS && _profiler)
+    {
+        _profiler->MarkSubmitted(_profiler->GetImmediateSlot());
+        _profiler->CollectSlot(_profiler->GetImmediateSlot());
+    }
+
+    vkFreeCommandBuffers(_device, _commandPool, 1, &commandBuffer);
+    return code == VK_SUCCESS;
 }
\ No newline at end of file
@@ -10,13 +10,14 @@
 #include <array>
 #include <cassert>
 
+#ifdef _WIN32
 #define NOMINMAX
 #include <Windows.h>
-#include "Shlwapi.h"
-#pragma comment(lib, "shlwapi.lib")
+#endif
 
-#define VK_USE_PLATFORM_WIN32_KHR
+// the window system part of Vulkan is only seen by the Platform backends
 #include "vulkan/vulkan.h"
+#include "Platform.h"
 
 std::wstring ToString(VkResult value);
 void LogError(const std::wstring& message, bool silent = false);
@@ -25,15 +26,12 @@ void ExitError(const std::wstring& message, bool silent = false);
 struct Settings
 {
     bool ValidationEnabled = false;
+    bool VSyncEnabled = true;
     uint32_t DesiredWindowWidth = 1280;
     uint32_t DesiredWindowHeight = 720;
     VkFormat DesiredSurfaceFormat = VK_FORMAT_B8G8R8A8_UNORM;
-};
-
-struct WindowInfo
-{
-    HWND Window;
-    HINSTANCE WindowInstance;
+    // no window and no swapchain, frames go to images of our own
+    bool Headless = false;
 };
 
 struct QueueInfo
@@ -49,14 +47,23 @@ struct QueuesInfo
     QueueInfo Transfer;
 };
 
-struct MsgInfo
+// what device memory is used for, see MemoryTracker
+enum class MemoryCategory : uint32_t
 {
-    HWND hWnd;
-    UINT uMsg;
-    WPARAM wParam;
-    LPARAM lParam;
+    General,
+    Geometry,
+    AccelerationStructure,
+    Texture,
+    Scratch,
+    Staging,
+    Count
 };
 
+class TextureCache;
+class Profiler;
+class StartupReport;
+class MemoryTracker;
+
 
 class ResourceBase
 {
@@ -66,19 +73,35 @@ protected:
     static VkPhysicalDeviceMemoryProperties _physicalDeviceMemoryProperties;
     static VkCommandPool _commandPool;
     static VkQueue _transferQueue;
+    static Profiler* _profiler;
+    static MemoryTracker* _memoryTracker;
 
 public:
     static void Init(VkPhysicalDevice physicalDevice, VkDevice device, VkCommandPool commandPool, VkQueue transferQueue);
+    // GPU scopes around one-shot uploads go to the profiler's immediate slot
+    static void SetProfiler(Profiler* profiler);
+    static void SetMemoryTracker(MemoryTracker* memoryTracker);
     static uint32_t GetMemoryType(VkMemoryRequirements& memoryRequiriments, VkMemoryPropertyFlags memoryProperties);
+
+    // Device memory goes through these so it can be accounted for. Allocations that would
+    // exceed the heap budget fail with VK_ERROR_OUT_OF_DEVICE_MEMORY before reaching the driver.
+    static VkResult AllocateMemory(const VkMemoryAllocateInfo& allocateInfo, VkDeviceMemory& memory,
+        MemoryCategory category = MemoryCategory::General);
+    static void FreeMemory(VkDeviceMemory memory);
+    // Bytes currently allocated and the high-water mark
+    static VkDeviceSize GetAllocatedMemorySize();
+    static VkDeviceSize GetAllocatedMemoryPeak();
 };
 
 class ImageResource : public ResourceBase
 {
 private:
     static std::wstring _folderPath;
+    static TextureCache* _textureCache;
 
 public:
     VkFormat Format;
+    uint32_t MipLevels = 1;
     VkImage Image = VK_NULL_HANDLE;
     VkDeviceMemory Memory = VK_NULL_HANDLE;
     VkImageView ImageView = VK_NULL_HANDLE;
@@ -89,15 +112,18 @@ public:
 
 public:
     static void SetFolderPath(const std::wstring& folderPath);
+    static void SetTextureCache(TextureCache* textureCache);
 
     VkResult CreateImage(VkImageType imageType, VkFormat format, VkExtent3D extent, VkImageTiling tiling,
-        VkImageUsageFlags usage, VkMemoryPropertyFlags memoryProperties);
+        VkImageUsageFlags usage, VkMemoryPropertyFlags memoryProperties, uint32_t mipLevels = 1,
+        MemoryCategory category = MemoryCategory::General);
 
     bool LoadTexture2DFromFile(const std::wstring& fileName, VkResult& vkResult);
 
     VkResult CreateImageView(VkImageViewType viewType, VkFormat format, VkImageSubresourceRange subresourceRange);
 
-    VkResult CreateSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerMipmapMode mipmapMode, VkSamplerAddressMode addressMode);
+    VkResult CreateSampler(VkFilter magFilter, VkFilter minFilter, VkSamplerMipmapMode mipmapMode, VkSamplerAddressMode addressMode,
+        float maxLod = 0.0f);
 
     void Cleanup();
 };
@@ -115,6 +141,7 @@ public:
     static void SetFolderPath(const std::wstring& folderPath);
 
     VkResult LoadFromFile(const std::wstring& fileName, bool& cantOpenFile);
+    VkResult LoadFromSpirv(const uint32_t* code, size_t codeSize);
     void Cleanup();
 
     VkPipelineShaderStageCreateInfo GetShaderStage(VkShaderStageFlagBits stage);
@@ -131,13 +158,16 @@ public:
     ~BufferResource();
 
 public:
-    VkResult Create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties);
+    VkResult Create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties,
+        MemoryCategory category = MemoryCategory::General);
     void Cleanup();
 
     void* Map(VkDeviceSize size) const;
     void Unmap() const;
 
     bool CopyToBufferUsingMapUnmap(const void* memoryToCopyFrom, VkDeviceSize size) const;
+    // For device local buffers, needs VK_BUFFER_USAGE_TRANSFER_DST_BIT. Blocks until the copy is done.
+    bool CopyToBufferUsingStaging(const void* memoryToCopyFrom, VkDeviceSize size) const;
 };
 
 
@@ -152,7 +182,7 @@ protected:
     std::wstring _geometryFolder;
     Settings _settings;
     std::wstring _basePath;
-    WindowInfo _windowInfo = { };
+    std::unique_ptr<Platform> _platform;
     uint32_t _actualWindowWidth = 0;
     uint32_t _actualWindowHeight = 0;
     VkSurfaceFormatKHR _surfaceFormat = { };
@@ -165,6 +195,9 @@ protected:
     VkSwapchainKHR _swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> _swapchainImages;
     std::vector<VkImageView> _swapchainImageViews;
+    // stand in for the swapchain images when headless
+    std::vector<ImageResource> _headlessImages;
+    uint32_t _headlessImageIndex = 0;
     PFN_vkAcquireNextImageKHR vkAcquireNextImageKHR = VK_NULL_HANDLE;
     PFN_vkQueuePresentKHR vkQueuePresentKHR = VK_NULL_HANDLE;
     ImageResource _offsreenImageResource;
@@ -174,6 +207,14 @@ protected:
     VkSemaphore _renderFinishedSemaphore = VK_NULL_HANDLE;
     std::vector<VkFence> _frameReadinessFences;
     uint32_t _bufferedFrameMaxNum = 0;
+    std::unique_ptr<Profiler> _profiler;
+    std::unique_ptr<StartupReport> _startupReport;
+    std::unique_ptr<MemoryTracker> _memoryTracker;
+    bool _memoryBudgetEnabled = false;
+    VkPipelineCache _pipelineCache = VK_NULL_HANDLE;
+    std::wstring _pipelineCacheFilePath;
+    bool _pipelineCacheWarm = false;
+    bool _quitRequested = false;
 
 protected:
     Application();
@@ -184,7 +225,10 @@ public:
 public:
     static Application* GetInstance();
     void Run();
-    void HandleMessages(MsgInfo* info);
+    // Before Run, the benchmark uses it on machines without a display
+    void SetHeadless(bool headless);
+    // Leaves the main loop after the current frame
+    void RequestQuit();
 
 protected:
     void Initialize();
@@ -196,13 +240,19 @@ protected:
     void CreateInstance();
     void FindDeviceAndQueues();
     void PostCreateDevice();
+    void CreateMemoryTracker();
+    void CreatePipelineCache();
+    void SavePipelineCache();
     void CreateDebugReportCallback();
+    bool IsDeviceExtensionSupported(const char* extensionName) const;
     void CreateSurface();
     void CreateSwapchain();
+    void CreateHeadlessImages();
     void CreateFences();
     void CreateOffsreenBuffers();
     void CreateCommandPool();
     void CreateCommandBuffers();
+    void CreateProfiler();
     void CreateSynchronization();
     void CleanupRendering();
     void ImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageSubresourceRange& subresourceRange,
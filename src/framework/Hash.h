@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// 64-bit FNV-1a, used to build content keys for the on-disk caches
+static const uint64_t FNV1A64_OFFSET_BASIS = 14695981039346656037ull;
+static const uint64_t FNV1A64_PRIME = 1099511628211ull;
+
+inline uint64_t HashFNV1a64(const void* data, size_t size, uint64_t hash = FNV1A64_OFFSET_BASIS)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV1A64_PRIME;
+    }
+    return hash;
+}
+
+template <typename T>
+inline uint64_t HashValue(const T& value, uint64_t hash = FNV1A64_OFFSET_BASIS)
+{
+    return HashFNV1a64(&value, sizeof(T), hash);
+}
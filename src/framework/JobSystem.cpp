@@ -0,0 +1,225 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// more than a frame's worth of tiles or a BVH build's worth of subtrees, a full deque runs the job inline
+static const uint32_t JOB_SYSTEM_DEQUE_CAPACITY = 4096;
+// rounds of stealing attempts before an idle worker goes to sleep
+static const uint32_t JOB_SYSTEM_SPIN_COUNT = 64;
+
+static thread_local const JobSystem* tlsJobSystem = nullptr;
+static thread_local uint32_t tlsWorkerIndex = 0;
+
+bool JobSystem::Counter::IsDone() const
+{
+    return _pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(uint32_t numThreads, const NumaTopology* topology)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    _pinned = (topology != nullptr);
+    _topology = _pinned ? *topology : NumaTopology::SingleNode(numThreads);
+    const uint32_t numNodes = _pinned ? std::max(_topology.GetNumNodes(), 1u) : 1;
+
+    _workers.resize(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        _workers[i].reset(new Worker());
+        _workers[i]->Jobs.reset(new WorkStealingDeque<Job>(JOB_SYSTEM_DEQUE_CAPACITY));
+        _workers[i]->StealSeed = i * 0x9E3779B9u + 1;
+        _workers[i]->Node = (i == 0) ? 0 : static_cast<uint32_t>(static_cast<uint64_t>(i) * numNodes / numThreads);
+    }
+
+    // all deques exist before any thread looks at them
+    for (uint32_t i = 1; i < numThreads; ++i)
+    {
+        _workers[i]->Thread = std::thread(&JobSystem::WorkerMain, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _quit.store(true);
+    }
+    _sleepCondition.notify_all();
+
+    for (std::unique_ptr<Worker>& worker : _workers)
+    {
+        if (worker->Thread.joinable())
+        {
+            worker->Thread.join();
+        }
+    }
+}
+
+uint32_t JobSystem::GetNumThreads() const
+{
+    return static_cast<uint32_t>(_workers.size());
+}
+
+uint32_t JobSystem::GetWorkerIndex() const
+{
+    return tlsJobSystem == this ? tlsWorkerIndex : 0;
+}
+
+uint32_t JobSystem::GetWorkerNode(uint32_t workerIndex) const
+{
+    return _workers[workerIndex]->Node;
+}
+
+const NumaTopology& JobSystem::GetTopology() const
+{
+    return _topology;
+}
+
+void JobSystem::Run(Counter& counter, JobFunction job)
+{
+    counter._pending.fetch_add(1, std::memory_order_relaxed);
+
+    Job* queued = new Job { std::move(job), &counter };
+    if (!_workers[GetWorkerIndex()]->Jobs->Push(queued))
+    {
+        Execute(queued);
+        return;
+    }
+
+    if (_workers.size() > 1)
+    {
+        _queuedJobs.fetch_add(1);
+        // a worker between checking the count and sleeping holds the mutex, it can't miss this
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+        }
+        _sleepCondition.notify_one();
+    }
+}
+
+void JobSystem::Wait(Counter& counter)
+{
+    const uint32_t workerIndex = GetWorkerIndex();
+    while (!counter.IsDone())
+    {
+        if (!RunOneJob(workerIndex))
+        {
+            // the remaining jobs are running elsewhere
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& body)
+{
+    grainSize = std::max(grainSize, 1u);
+
+    Counter counter;
+    for (uint32_t begin = 0; begin < count; begin += grainSize)
+    {
+        const uint32_t end = std::min(begin + grainSize, count);
+        Run(counter, [&body, begin, end]()
+        {
+            body(begin, end);
+        });
+    }
+    Wait(counter);
+}
+
+void JobSystem::WorkerMain(uint32_t workerIndex)
+{
+    tlsJobSystem = this;
+    tlsWorkerIndex = workerIndex;
+    if (_pinned)
+    {
+        _topology.PinCurrentThread(_workers[workerIndex]->Node);
+    }
+
+    uint32_t idleRounds = 0;
+    while (!_quit.load(std::memory_order_relaxed))
+    {
+        if (RunOneJob(workerIndex))
+        {
+            idleRounds = 0;
+            continue;
+        }
+
+        if (++idleRounds < JOB_SYSTEM_SPIN_COUNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _sleepCondition.wait(lock, [this]()
+        {
+            return _quit.load() || _queuedJobs.load() > 0;
+        });
+        idleRounds = 0;
+    }
+}
+
+bool JobSystem::RunOneJob(uint32_t workerIndex)
+{
+    Job* job = _workers[workerIndex]->Jobs->Pop();
+    if (job == nullptr)
+    {
+        job = StealJob(workerIndex);
+    }
+    if (job == nullptr)
+    {
+        return false;
+    }
+
+    if (_workers.size() > 1)
+    {
+        _queuedJobs.fetch_sub(1);
+    }
+    Execute(job);
+    return true;
+}
+
+JobSystem::Job* JobSystem::StealJob(uint32_t workerIndex)
+{
+    const uint32_t numWorkers = static_cast<uint32_t>(_workers.size());
+    if (numWorkers < 2)
+    {
+        return nullptr;
+    }
+
+    // a random victim first, so the thieves don't all line up behind the same worker
+    uint32_t& seed = _workers[workerIndex]->StealSeed;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    // the own node first, its jobs tend to touch memory that is already close by
+    const uint32_t node = _workers[workerIndex]->Node;
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        for (uint32_t i = 0; i < numWorkers; ++i)
+        {
+            const uint32_t victim = (seed + i) % numWorkers;
+            if (victim == workerIndex || (_workers[victim]->Node == node) != (pass == 0))
+            {
+                continue;
+            }
+            if (Job* job = _workers[victim]->Jobs->Steal())
+            {
+                return job;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    job->Function();
+    job->Group->_pending.fetch_sub(1, std::memory_order_release);
+    delete job;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Numa.h"
+
+// Fixed size work stealing deque (Chase and Lev, with the C11 orderings of Le et al.). The owner
+// pushes and pops at the bottom, any other thread steals from the top without taking a lock.
+template <typename T>
+class WorkStealingDeque
+{
+private:
+    std::atomic<int64_t> _top;
+    std::atomic<int64_t> _bottom;
+    std::unique_ptr<std::atomic<T*>[]> _items;
+    int64_t _mask;
+
+public:
+    // capacity is rounded up to a power of two
+    explicit WorkStealingDeque(uint32_t capacity);
+
+    // owner only, false when full
+    bool Push(T* item);
+    // owner only, the most recently pushed item
+    T* Pop();
+    // any thread, the oldest item or nullptr when empty or when another thief got it first
+    T* Steal();
+};
+
+// Pool of worker threads that each own a WorkStealingDeque. Jobs spawned from a job go to the
+// bottom of the spawning worker's deque, so a worker keeps going depth first on its own subtree
+// and idle workers steal the oldest, biggest pieces from the top of the others.
+//
+// The thread that created the system is worker 0, it only runs jobs while inside Wait. Run and
+// Wait may be called from that thread and from inside jobs, not from other threads.
+//
+// Given a topology the workers are spread over its NUMA nodes in contiguous blocks and pinned
+// there, and thieves look at the deques of their own node before crossing to another one.
+// Worker 0 keeps whatever affinity its thread had and counts as being on node 0.
+class JobSystem
+{
+public:
+    using JobFunction = std::function<void()>;
+
+    // Jobs that have been run but haven't finished yet, one per group of jobs to wait for
+    class Counter
+    {
+    private:
+        friend class JobSystem;
+        std::atomic<uint32_t> _pending { 0 };
+
+    public:
+        bool IsDone() const;
+    };
+
+private:
+    struct Job
+    {
+        JobFunction Function;
+        Counter* Group;
+    };
+
+    struct Worker
+    {
+        std::unique_ptr<WorkStealingDeque<Job>> Jobs;
+        std::thread Thread;
+        uint32_t StealSeed = 0;
+        uint32_t Node = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> _workers;
+    NumaTopology _topology;
+    bool _pinned = false;
+
+    // sleeping workers are woken through this when jobs come in
+    std::atomic<uint32_t> _queuedJobs { 0 };
+    std::atomic<bool> _quit { false };
+    std::mutex _sleepMutex;
+    std::condition_variable _sleepCondition;
+
+public:
+    // 0 is one thread per hardware thread, the creating thread counts as one of them
+    explicit JobSystem(uint32_t numThreads = 0, const NumaTopology* topology = nullptr);
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem();
+
+public:
+    uint32_t GetNumThreads() const;
+    // Index of the calling thread in [0, GetNumThreads()), for per thread scratch data
+    uint32_t GetWorkerIndex() const;
+    // NUMA node the worker was pinned to, 0 for every worker when there was no topology
+    uint32_t GetWorkerNode(uint32_t workerIndex) const;
+    // the given topology, a single node one without
+    const NumaTopology& GetTopology() const;
+
+    void Run(Counter& counter, JobFunction job);
+    // Runs queued and stolen jobs until every job of the counter has finished
+    void Wait(Counter& counter);
+
+    // Calls body(begin, end) over [0, count) in ranges of at most grainSize and waits for all of them
+    void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& body);
+
+private:
+    void WorkerMain(uint32_t workerIndex);
+    // one job of the calling worker's deque or one stolen from another, false when none was found
+    bool RunOneJob(uint32_t workerIndex);
+    Job* StealJob(uint32_t workerIndex);
+    void Execute(Job* job);
+};
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(uint32_t capacity)
+    : _top(0)
+    , _bottom(0)
+{
+    uint32_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    _items.reset(new std::atomic<T*>[size]);
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        _items[i].store(nullptr, std::memory_order_relaxed);
+    }
+    _mask = static_cast<int64_t>(size) - 1;
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::Push(T* item)
+{
+    const int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    const int64_t top = _top.load(std::memory_order_acquire);
+    if (bottom - top > _mask)
+    {
+        return false;
+    }
+
+    _items[bottom & _mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+template <typename T>
+T* WorkStealingDeque<T>::Pop()
+{
+    const int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    T* item = _items[bottom & _mask].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // the last item, a thief may be after it as well
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            item = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+}
+
+template <typename T>
+T* WorkStealingDeque<T>::Steal()
+{
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+    {
+        return nullptr;
+    }
+
+    T* item = _items[top & _mask].load(std::memory_order_relaxed);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return item;
+}
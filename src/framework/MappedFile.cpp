@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <codecvt>
+#include <locale>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::wstring& filePath)
+{
+    Close();
+
+#ifdef _WIN32
+    _file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(_file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    _data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_data == nullptr)
+    {
+        Close();
+        return false;
+    }
+    _size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+    _file = open(convert.to_bytes(filePath).c_str(), O_RDONLY);
+    if (_file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(_file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, _file, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(fileStat.st_size);
+#endif
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (_data)
+    {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping)
+    {
+        CloseHandle(_mapping);
+        _mapping = nullptr;
+    }
+    if (_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_file);
+        _file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (_data)
+    {
+        munmap(const_cast<uint8_t*>(_data), _size);
+    }
+    if (_file >= 0)
+    {
+        close(_file);
+        _file = -1;
+    }
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+bool MappedFile::IsOpen() const
+{
+    return _data != nullptr;
+}
+
+const uint8_t* MappedFile::GetData() const
+{
+    return _data;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return _size;
+}
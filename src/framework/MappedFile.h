@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Application.h"
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+private:
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _file = -1;
+#endif
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+public:
+    bool Open(const std::wstring& filePath);
+    void Close();
+
+    bool IsOpen() const;
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+};
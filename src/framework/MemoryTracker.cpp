@@ -0,0 +1,189 @@
+#include "MemoryTracker.h"
+
+#include <iomanip>
+
+// without the extension, leave room for the swapchain, driver internals and other processes
+static const double MEMORY_TRACKER_FALLBACK_BUDGET = 0.8;
+
+static const double MEMORY_TRACKER_MEGABYTE = 1024.0 * 1024.0;
+
+const char* ToString(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::General: return "general";
+    case MemoryCategory::Geometry: return "geometry";
+    case MemoryCategory::AccelerationStructure: return "acceleration_structure";
+    case MemoryCategory::Texture: return "texture";
+    case MemoryCategory::Scratch: return "scratch";
+    case MemoryCategory::Staging: return "staging";
+    default: return "unknown";
+    }
+}
+
+void MemoryTracker::Initialize(VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled)
+{
+    _physicalDevice = physicalDevice;
+    _budgetExtensionEnabled = budgetExtensionEnabled;
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+    for (uint32_t heap = 0; heap < _memoryProperties.memoryHeapCount; ++heap)
+    {
+        _heapBudget[heap] = static_cast<VkDeviceSize>(_memoryProperties.memoryHeaps[heap].size * MEMORY_TRACKER_FALLBACK_BUDGET);
+    }
+
+    UpdateBudget();
+}
+
+void MemoryTracker::UpdateBudget()
+{
+    if (!_budgetExtensionEnabled)
+    {
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = { };
+    budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memoryProperties = { };
+    memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties.pNext = &budget;
+    vkGetPhysicalDeviceMemoryProperties2(_physicalDevice, &memoryProperties);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (uint32_t heap = 0; heap < _memoryProperties.memoryHeapCount; ++heap)
+    {
+        _heapBudget[heap] = budget.heapBudget[heap];
+        _heapExternalUsage[heap] = budget.heapUsage[heap] > _heapUsage[heap] ? budget.heapUsage[heap] - _heapUsage[heap] : 0;
+    }
+}
+
+VkDeviceSize MemoryTracker::GetHeapAvailable(uint32_t heap) const
+{
+    const VkDeviceSize used = _heapUsage[heap] + _heapExternalUsage[heap];
+    return _heapBudget[heap] > used ? _heapBudget[heap] - used : 0;
+}
+
+bool MemoryTracker::CanAllocate(uint32_t memoryTypeIndex, VkDeviceSize size) const
+{
+    if (memoryTypeIndex >= _memoryProperties.memoryTypeCount)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return size <= GetHeapAvailable(_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex);
+}
+
+void MemoryTracker::AddAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category)
+{
+    Allocation allocation;
+    allocation.Size = size;
+    allocation.Heap = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    allocation.Category = category;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _allocations[memory] = allocation;
+    _heapUsage[allocation.Heap] += size;
+    _categoryUsage[static_cast<size_t>(category)] += size;
+    _totalUsage += size;
+    _peakUsage = std::max(_peakUsage, _totalUsage);
+}
+
+void MemoryTracker::RemoveAllocation(VkDeviceMemory memory)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto found = _allocations.find(memory);
+    if (found == _allocations.end())
+    {
+        return;
+    }
+
+    const Allocation& allocation = found->second;
+    _heapUsage[allocation.Heap] -= allocation.Size;
+    _categoryUsage[static_cast<size_t>(allocation.Category)] -= allocation.Size;
+    _totalUsage -= allocation.Size;
+    _allocations.erase(found);
+}
+
+VkDeviceSize MemoryTracker::GetTotalUsage() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _totalUsage;
+}
+
+VkDeviceSize MemoryTracker::GetPeakUsage() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _peakUsage;
+}
+
+VkDeviceSize MemoryTracker::GetCategoryUsage(MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _categoryUsage[static_cast<size_t>(category)];
+}
+
+VkDeviceSize MemoryTracker::GetDeviceLocalAvailable() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    VkDeviceSize available = 0;
+    for (uint32_t heap = 0; heap < _memoryProperties.memoryHeapCount; ++heap)
+    {
+        if (_memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        {
+            available += GetHeapAvailable(heap);
+        }
+    }
+    return available;
+}
+
+uint32_t MemoryTracker::FindHostMemoryType(uint32_t memoryTypeBits) const
+{
+    uint32_t fallback = UINT32_MAX;
+    for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < _memoryProperties.memoryTypeCount; ++memoryTypeIndex)
+    {
+        const VkMemoryType& memoryType = _memoryProperties.memoryTypes[memoryTypeIndex];
+        if (!(memoryTypeBits & (1 << memoryTypeIndex)) || !(memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        {
+            continue;
+        }
+        if (!(_memoryProperties.memoryHeaps[memoryType.heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+        {
+            return memoryTypeIndex;
+        }
+        if (fallback == UINT32_MAX)
+        {
+            fallback = memoryTypeIndex;
+        }
+    }
+    return fallback;
+}
+
+bool MemoryTracker::IsDeviceLocal(uint32_t memoryTypeIndex) const
+{
+    return memoryTypeIndex < _memoryProperties.memoryTypeCount &&
+        (_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void MemoryTracker::PrintStats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::cout << std::fixed << std::setprecision(1) << "Device memory (MB, "
+        << (_budgetExtensionEnabled ? "VK_EXT_memory_budget" : "estimated budget") << "):\n";
+    for (uint32_t heap = 0; heap < _memoryProperties.memoryHeapCount; ++heap)
+    {
+        const bool deviceLocal = (_memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        std::cout << "  heap " << heap << (deviceLocal ? " (device)" : " (host)  ")
+            << " used " << std::setw(9) << _heapUsage[heap] / MEMORY_TRACKER_MEGABYTE
+            << " other " << std::setw(9) << _heapExternalUsage[heap] / MEMORY_TRACKER_MEGABYTE
+            << " budget " << std::setw(9) << _heapBudget[heap] / MEMORY_TRACKER_MEGABYTE << "\n";
+    }
+    for (size_t category = 0; category < _categoryUsage.size(); ++category)
+    {
+        std::cout << "  " << std::left << std::setw(24) << ToString(static_cast<MemoryCategory>(category)) << std::right
+            << std::setw(9) << _categoryUsage[category] / MEMORY_TRACKER_MEGABYTE << "\n";
+    }
+    std::cout << "  " << std::left << std::setw(24) << "peak" << std::right << std::setw(9) << _peakUsage / MEMORY_TRACKER_MEGABYTE << "\n";
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Application.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// VK_EXT_memory_budget is newer than the bundled headers
+#ifndef VK_EXT_memory_budget
+#define VK_EXT_memory_budget 1
+#define VK_EXT_MEMORY_BUDGET_EXTENSION_NAME "VK_EXT_memory_budget"
+#define VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT static_cast<VkStructureType>(1000237000)
+
+typedef struct VkPhysicalDeviceMemoryBudgetPropertiesEXT
+{
+    VkStructureType sType;
+    void* pNext;
+    VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS];
+} VkPhysicalDeviceMemoryBudgetPropertiesEXT;
+#endif
+
+// Accounts every allocation made through ResourceBase::AllocateMemory per memory heap and
+// per category, and checks new allocations against the heap budget. With VK_EXT_memory_budget
+// the budget and the usage of other processes come from the driver, without it a fixed share
+// of the heap size is used and only our own allocations count.
+class MemoryTracker
+{
+private:
+    struct Allocation
+    {
+        VkDeviceSize Size;
+        uint32_t Heap;
+        MemoryCategory Category;
+    };
+
+    VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+    bool _budgetExtensionEnabled = false;
+    VkPhysicalDeviceMemoryProperties _memoryProperties = { };
+
+    mutable std::mutex _mutex;
+    std::unordered_map<VkDeviceMemory, Allocation> _allocations;
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapBudget = { };
+    // driver reported usage minus our own allocations at the last budget query
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapExternalUsage = { };
+    std::array<VkDeviceSize, VK_MAX_MEMORY_HEAPS> _heapUsage = { };
+    std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> _categoryUsage = { };
+    VkDeviceSize _totalUsage = 0;
+    VkDeviceSize _peakUsage = 0;
+
+public:
+    void Initialize(VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled);
+    // Re-reads the driver budget, a no-op without the extension
+    void UpdateBudget();
+
+    bool CanAllocate(uint32_t memoryTypeIndex, VkDeviceSize size) const;
+    void AddAllocation(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category);
+    void RemoveAllocation(VkDeviceMemory memory);
+
+    VkDeviceSize GetTotalUsage() const;
+    VkDeviceSize GetPeakUsage() const;
+    VkDeviceSize GetCategoryUsage(MemoryCategory category) const;
+    // What is left of the budget over all device local heaps
+    VkDeviceSize GetDeviceLocalAvailable() const;
+
+    // Prefers host visible types that don't live in a device local heap, UINT32_MAX if none fits
+    uint32_t FindHostMemoryType(uint32_t memoryTypeBits) const;
+    bool IsDeviceLocal(uint32_t memoryTypeIndex) const;
+
+    void PrintStats() const;
+
+private:
+    VkDeviceSize GetHeapAvailable(uint32_t heap) const;
+};
+
+const char* ToString(MemoryCategory category);
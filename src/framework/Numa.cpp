@@ -0,0 +1,372 @@
+#include "Numa.h"
+#include "Application.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <thread>
+
+#ifndef _WIN32
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+// from linux/mempolicy.h, called through syscall so there is no libnuma to link against
+static const int NUMA_MPOL_BIND = 2;
+static const int NUMA_MPOL_INTERLEAVE = 3;
+static const unsigned long NUMA_MAX_NODES = 1024;
+
+// "0-3,8-11" as the sysfs lists write it
+static std::vector<uint32_t> ParseCpuList(const std::string& list)
+{
+    std::vector<uint32_t> values;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        uint32_t first = 0;
+        uint32_t last = 0;
+        const int numParsed = sscanf(range.c_str(), "%u-%u", &first, &last);
+        if (numParsed < 1)
+        {
+            continue;
+        }
+        for (uint32_t value = first; value <= (numParsed == 2 ? last : first); ++value)
+        {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+static bool ReadFirstLine(const std::string& path, std::string& line)
+{
+    std::ifstream file(path);
+    return file.is_open() && std::getline(file, line);
+}
+
+static bool BindMemory(void* data, size_t size, int mode, const std::vector<uint32_t>& systemNodeIds)
+{
+    const size_t bitsPerWord = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> nodeMask(NUMA_MAX_NODES / bitsPerWord, 0);
+    for (const uint32_t node : systemNodeIds)
+    {
+        if (node >= NUMA_MAX_NODES)
+        {
+            return false;
+        }
+        nodeMask[node / bitsPerWord] |= 1ul << (node % bitsPerWord);
+    }
+
+    if (syscall(SYS_mbind, data, size, mode, nodeMask.data(), NUMA_MAX_NODES, 0) != 0)
+    {
+        LogError(L"NumaBuffer: mbind failed, errno " + std::to_wstring(errno), true);
+        return false;
+    }
+    return true;
+}
+#endif
+
+// ============================================================
+// NumaTopology
+// ============================================================
+
+NumaTopology NumaTopology::Query()
+{
+    NumaTopology topology;
+
+#ifdef _WIN32
+    ULONG highestNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNode))
+    {
+        for (USHORT node = 0; node <= highestNode; ++node)
+        {
+            GROUP_AFFINITY affinity = { };
+            if (!GetNumaNodeProcessorMaskEx(node, &affinity) || affinity.Mask == 0)
+            {
+                continue;
+            }
+
+            std::vector<uint32_t> processors;
+            for (uint32_t bit = 0; bit < sizeof(KAFFINITY) * 8; ++bit)
+            {
+                if (affinity.Mask & (static_cast<KAFFINITY>(1) << bit))
+                {
+                    processors.push_back(affinity.Group * 64 + bit);
+                }
+            }
+            topology._nodeProcessors.push_back(processors);
+            topology._systemNodeIds.push_back(node);
+        }
+    }
+#else
+    std::string online;
+    if (ReadFirstLine("/sys/devices/system/node/online", online))
+    {
+        for (const uint32_t node : ParseCpuList(online))
+        {
+            std::string cpuList;
+            if (ReadFirstLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpuList))
+            {
+                const std::vector<uint32_t> processors = ParseCpuList(cpuList);
+                // memory only nodes have nothing to pin to
+                if (!processors.empty())
+                {
+                    topology._nodeProcessors.push_back(processors);
+                    topology._systemNodeIds.push_back(node);
+                }
+            }
+        }
+    }
+#endif
+
+    if (topology._nodeProcessors.empty())
+    {
+        return SingleNode(std::max(std::thread::hardware_concurrency(), 1u));
+    }
+    return topology;
+}
+
+NumaTopology NumaTopology::SingleNode(uint32_t numProcessors)
+{
+    NumaTopology topology;
+    topology._nodeProcessors.resize(1);
+    topology._systemNodeIds.push_back(0);
+    for (uint32_t i = 0; i < numProcessors; ++i)
+    {
+        topology._nodeProcessors[0].push_back(i);
+    }
+    return topology;
+}
+
+uint32_t NumaTopology::GetNumNodes() const
+{
+    return static_cast<uint32_t>(_nodeProcessors.size());
+}
+
+const std::vector<uint32_t>& NumaTopology::GetProcessors(uint32_t node) const
+{
+    return _nodeProcessors[node];
+}
+
+uint32_t NumaTopology::GetSystemNodeId(uint32_t node) const
+{
+    return _systemNodeIds[node];
+}
+
+bool NumaTopology::ReadCounters(std::vector<NumaNodeCounters>& counters) const
+{
+    counters.assign(_nodeProcessors.size(), NumaNodeCounters());
+#ifdef _WIN32
+    // nothing the same without a performance counter query
+    return false;
+#else
+    for (size_t node = 0; node < _systemNodeIds.size(); ++node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(_systemNodeIds[node]) + "/numastat");
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        // "numa_hit 1234" per line
+        std::string name;
+        uint64_t value = 0;
+        while (file >> name >> value)
+        {
+            if (name == "numa_hit")
+            {
+                counters[node].Hits = value;
+            }
+            else if (name == "numa_miss")
+            {
+                counters[node].Misses = value;
+            }
+            else if (name == "other_node")
+            {
+                counters[node].OtherNode = value;
+            }
+        }
+    }
+    return true;
+#endif
+}
+
+bool NumaTopology::PinCurrentThread(uint32_t node) const
+{
+    const std::vector<uint32_t>& processors = _nodeProcessors[node];
+    if (processors.empty())
+    {
+        return false;
+    }
+
+#ifdef _WIN32
+    // a node never spans processor groups
+    GROUP_AFFINITY affinity = { };
+    affinity.Group = static_cast<WORD>(processors[0] / 64);
+    for (const uint32_t processor : processors)
+    {
+        affinity.Mask |= static_cast<KAFFINITY>(1) << (processor % 64);
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const uint32_t processor : processors)
+    {
+        CPU_SET(processor, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+}
+
+// ============================================================
+// NumaBuffer
+// ============================================================
+
+NumaBuffer::NumaBuffer(NumaBuffer&& other)
+{
+    *this = std::move(other);
+}
+
+NumaBuffer& NumaBuffer::operator=(NumaBuffer&& other)
+{
+    if (this != &other)
+    {
+        Free();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+        std::swap(_reservedSize, other._reservedSize);
+    }
+    return *this;
+}
+
+NumaBuffer::~NumaBuffer()
+{
+    Free();
+}
+
+bool NumaBuffer::Allocate(size_t size, const NumaTopology& topology, uint32_t node)
+{
+    Free();
+    if (size == 0)
+    {
+        return true;
+    }
+
+#ifdef _WIN32
+    void* data = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, topology.GetSystemNodeId(node));
+    if (data == nullptr)
+    {
+        return false;
+    }
+    _reservedSize = size;
+#else
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mappedSize = (size + pageSize - 1) / pageSize * pageSize;
+    void* data = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    _reservedSize = mappedSize;
+
+    // before the first touch, the pages are only taken from the node when they are written
+    if (topology.GetNumNodes() > 1 && !BindMemory(data, mappedSize, NUMA_MPOL_BIND, { topology.GetSystemNodeId(node) }))
+    {
+        munmap(data, mappedSize);
+        _reservedSize = 0;
+        return false;
+    }
+#endif
+
+    _data = static_cast<uint8_t*>(data);
+    _size = size;
+    return true;
+}
+
+bool NumaBuffer::AllocateInterleaved(size_t size, const NumaTopology& topology)
+{
+    Free();
+    if (size == 0)
+    {
+        return true;
+    }
+
+#ifdef _WIN32
+    // reserved in one piece, then committed a chunk per node in turn
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    const size_t chunkSize = systemInfo.dwAllocationGranularity;
+    const size_t reservedSize = (size + chunkSize - 1) / chunkSize * chunkSize;
+
+    uint8_t* data = static_cast<uint8_t*>(VirtualAlloc(nullptr, reservedSize, MEM_RESERVE, PAGE_READWRITE));
+    if (data == nullptr)
+    {
+        return false;
+    }
+    const uint32_t numNodes = std::max(topology.GetNumNodes(), 1u);
+    for (size_t offset = 0, chunk = 0; offset < reservedSize; offset += chunkSize, ++chunk)
+    {
+        if (!VirtualAllocExNuma(GetCurrentProcess(), data + offset, chunkSize, MEM_COMMIT, PAGE_READWRITE, topology.GetSystemNodeId(static_cast<uint32_t>(chunk % numNodes))))
+        {
+            VirtualFree(data, 0, MEM_RELEASE);
+            return false;
+        }
+    }
+    _reservedSize = reservedSize;
+#else
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t mappedSize = (size + pageSize - 1) / pageSize * pageSize;
+    void* data = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    _reservedSize = mappedSize;
+
+    std::vector<uint32_t> systemNodeIds;
+    for (uint32_t node = 0; node < topology.GetNumNodes(); ++node)
+    {
+        systemNodeIds.push_back(topology.GetSystemNodeId(node));
+    }
+    if (systemNodeIds.size() > 1 && !BindMemory(data, mappedSize, NUMA_MPOL_INTERLEAVE, systemNodeIds))
+    {
+        munmap(data, mappedSize);
+        _reservedSize = 0;
+        return false;
+    }
+#endif
+
+    _data = static_cast<uint8_t*>(data);
+    _size = size;
+    return true;
+}
+
+void NumaBuffer::Free()
+{
+    if (_data != nullptr)
+    {
+#ifdef _WIN32
+        VirtualFree(_data, 0, MEM_RELEASE);
+#else
+        munmap(_data, _reservedSize);
+#endif
+    }
+    _data = nullptr;
+    _size = 0;
+    _reservedSize = 0;
+}
+
+uint8_t* NumaBuffer::GetData() const
+{
+    return _data;
+}
+
+size_t NumaBuffer::GetSize() const
+{
+    return _size;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Page allocations the kernel counted on a node since boot (/sys/devices/system/node/node*/numastat)
+struct NumaNodeCounters
+{
+    uint64_t Hits = 0;      // numa_hit, placed on the node they were meant for
+    uint64_t Misses = 0;    // numa_miss, meant for another node and placed here
+    uint64_t OtherNode = 0; // other_node, placed here for a thread running on another node
+};
+
+// NUMA nodes of the machine and the logical processors on each. A machine without NUMA, or a
+// system that doesn't tell, is a single node holding every processor.
+// Nodes are numbered densely from 0, the system's own ids can have gaps.
+class NumaTopology
+{
+private:
+    std::vector<std::vector<uint32_t>> _nodeProcessors;
+    std::vector<uint32_t> _systemNodeIds;
+
+public:
+    static NumaTopology Query();
+    // one node with the given number of processors, for when the topology doesn't matter
+    static NumaTopology SingleNode(uint32_t numProcessors);
+
+    uint32_t GetNumNodes() const;
+    const std::vector<uint32_t>& GetProcessors(uint32_t node) const;
+    // what the system calls the node, for the allocation calls
+    uint32_t GetSystemNodeId(uint32_t node) const;
+
+    // One entry per node, false when the system doesn't count them. Only the difference
+    // between two reads means anything.
+    bool ReadCounters(std::vector<NumaNodeCounters>& counters) const;
+
+    // Restricts the calling thread to the processors of the node, false when the system refused
+    bool PinCurrentThread(uint32_t node) const;
+};
+
+// Page aligned memory placed on NUMA nodes. On a single node machine the memory ends up
+// wherever it would have anyway, elsewhere a placement the system refuses fails the allocation.
+class NumaBuffer
+{
+private:
+    uint8_t* _data = nullptr;
+    size_t _size = 0;
+    size_t _reservedSize = 0;
+
+public:
+    NumaBuffer() = default;
+    NumaBuffer(const NumaBuffer&) = delete;
+    NumaBuffer& operator=(const NumaBuffer&) = delete;
+    NumaBuffer(NumaBuffer&& other);
+    NumaBuffer& operator=(NumaBuffer&& other);
+    ~NumaBuffer();
+
+public:
+    // every page on the node of the topology
+    bool Allocate(size_t size, const NumaTopology& topology, uint32_t node);
+    // pages dealt out to the nodes of the topology in turn
+    bool AllocateInterleaved(size_t size, const NumaTopology& topology);
+    void Free();
+
+    uint8_t* GetData() const;
+    size_t GetSize() const;
+};
@@ -0,0 +1,407 @@
+#include "Application.h"
+
+#include <atomic>
+#include <codecvt>
+#include <cstring>
+#include <locale>
+
+#ifdef _WIN32
+#include "Shlwapi.h"
+#pragma comment(lib, "shlwapi.lib")
+#else
+#include <dlfcn.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// the windowed backends live next to their system headers
+#if defined(_WIN32)
+std::unique_ptr<Platform> CreatePlatformWin32();
+#elif defined(__linux__)
+std::unique_ptr<Platform> CreatePlatformXcb();
+#endif
+
+bool InputState::IsKeyDown(InputKey key) const
+{
+    return Keys[static_cast<size_t>(key)];
+}
+
+bool InputState::WasKeyPressed(InputKey key) const
+{
+    return KeysPressed[static_cast<size_t>(key)];
+}
+
+bool InputState::IsButtonDown(MouseButton button) const
+{
+    return Buttons[static_cast<size_t>(button)];
+}
+
+void InputState::BeginFrame()
+{
+    KeysPressed.fill(false);
+    CursorDeltaX = 0;
+    CursorDeltaY = 0;
+}
+
+void InputState::SetKey(InputKey key, bool down)
+{
+    bool& held = Keys[static_cast<size_t>(key)];
+    if (down && !held)
+    {
+        KeysPressed[static_cast<size_t>(key)] = true;
+    }
+    held = down;
+}
+
+void InputState::SetButton(MouseButton button, bool down)
+{
+    Buttons[static_cast<size_t>(button)] = down;
+}
+
+void InputState::MoveCursor(int32_t x, int32_t y)
+{
+    CursorDeltaX += x - CursorX;
+    CursorDeltaY += y - CursorY;
+    CursorX = x;
+    CursorY = y;
+}
+
+void InputState::Reset()
+{
+    Keys.fill(false);
+    Buttons.fill(false);
+}
+
+// ============================================================
+// Headless
+// ============================================================
+
+// No window, no surface and no events, the frame loop runs until Application::RequestQuit
+class PlatformHeadless : public Platform
+{
+public:
+    bool IsHeadless() const override
+    {
+        return true;
+    }
+
+    bool OpenWindow(const std::wstring&, uint32_t, uint32_t) override
+    {
+        return true;
+    }
+
+    void CloseWindow() override
+    {
+    }
+
+    const char* GetSurfaceExtensionName() const override
+    {
+        return nullptr;
+    }
+
+    VkResult CreateSurface(VkInstance, VkSurfaceKHR& surface) override
+    {
+        surface = VK_NULL_HANDLE;
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    bool PumpEvents() override
+    {
+        _input.BeginFrame();
+        return true;
+    }
+};
+
+std::unique_ptr<Platform> Platform::Create(bool headless)
+{
+    if (headless)
+    {
+        return std::unique_ptr<Platform>(new PlatformHeadless());
+    }
+#if defined(_WIN32)
+    return CreatePlatformWin32();
+#elif defined(__linux__)
+    return CreatePlatformXcb();
+#else
+    return std::unique_ptr<Platform>(new PlatformHeadless());
+#endif
+}
+
+const InputState& Platform::GetInput() const
+{
+    return _input;
+}
+
+// ============================================================
+// File system and process
+// ============================================================
+
+#ifdef _WIN32
+
+std::wstring Platform::GetExecutableFolder()
+{
+    wchar_t dest[MAX_PATH];
+    GetModuleFileNameW(nullptr, dest, MAX_PATH);
+    PathRemoveFileSpecW(dest);
+    return std::wstring(dest);
+}
+
+std::wstring Platform::GetExecutablePath()
+{
+    wchar_t dest[MAX_PATH];
+    GetModuleFileNameW(nullptr, dest, MAX_PATH);
+    return std::wstring(dest);
+}
+
+NativePath Platform::ToNativePath(const std::wstring& path)
+{
+    return path;
+}
+
+FILE* Platform::OpenFile(const std::wstring& path, const char* mode)
+{
+    const std::wstring wideMode(mode, mode + strlen(mode));
+    FILE* file = nullptr;
+    return _wfopen_s(&file, path.c_str(), wideMode.c_str()) == 0 ? file : nullptr;
+}
+
+void Platform::CreateDirectories(const std::wstring& path)
+{
+    for (size_t i = 1; i < path.length(); ++i)
+    {
+        if (path[i] == L'/' || path[i] == L'\\')
+        {
+            CreateDirectoryW(path.substr(0, i).c_str(), nullptr);
+        }
+    }
+    CreateDirectoryW(path.c_str(), nullptr);
+}
+
+bool Platform::RenameFile(const std::wstring& fromPath, const std::wstring& toPath)
+{
+    return MoveFileExW(fromPath.c_str(), toPath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+void Platform::RemoveFile(const std::wstring& path)
+{
+    DeleteFileW(path.c_str());
+}
+
+uint64_t Platform::GetFileWriteTime(const std::wstring& path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes))
+    {
+        return 0;
+    }
+    return (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+void* Platform::LoadSharedLibrary(const std::string& baseName)
+{
+    return LoadLibraryA((baseName + ".dll").c_str());
+}
+
+void* Platform::GetSharedLibrarySymbol(void* library, const char* name)
+{
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(library), name));
+}
+
+void Platform::FreeSharedLibrary(void* library)
+{
+    FreeLibrary(static_cast<HMODULE>(library));
+}
+
+uint64_t Platform::StartProcess(const std::wstring& executablePath, const std::vector<std::string>& arguments)
+{
+    // quoted, the arguments are expected to hold no quotes of their own
+    std::wstring commandLine = L"\"" + executablePath + L"\"";
+    for (const std::string& argument : arguments)
+    {
+        commandLine += L" \"" + std::wstring(argument.begin(), argument.end()) + L"\"";
+    }
+
+    STARTUPINFOW startupInfo = { };
+    startupInfo.cb = sizeof(startupInfo);
+    PROCESS_INFORMATION processInfo = { };
+    if (!CreateProcessW(executablePath.c_str(), &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+    {
+        return 0;
+    }
+    CloseHandle(processInfo.hThread);
+    return reinterpret_cast<uint64_t>(processInfo.hProcess);
+}
+
+int Platform::WaitForProcess(uint64_t process)
+{
+    const HANDLE handle = reinterpret_cast<HANDLE>(process);
+    DWORD exitCode = static_cast<DWORD>(-1);
+    if (WaitForSingleObject(handle, INFINITE) != WAIT_OBJECT_0 || !GetExitCodeProcess(handle, &exitCode))
+    {
+        exitCode = static_cast<DWORD>(-1);
+    }
+    CloseHandle(handle);
+    return static_cast<int>(exitCode);
+}
+
+bool Platform::HasProcessEnded(uint64_t process, int& exitCode)
+{
+    const HANDLE handle = reinterpret_cast<HANDLE>(process);
+    if (WaitForSingleObject(handle, 0) == WAIT_TIMEOUT)
+    {
+        return false;
+    }
+    exitCode = WaitForProcess(process);
+    return true;
+}
+
+#else
+
+std::wstring Platform::GetExecutableFolder()
+{
+    const std::wstring path = GetExecutablePath();
+    return path.substr(0, path.find_last_of(L'/') == std::wstring::npos ? 0 : path.find_last_of(L'/'));
+}
+
+std::wstring Platform::GetExecutablePath()
+{
+    char dest[PATH_MAX];
+    const ssize_t length = readlink("/proc/self/exe", dest, sizeof(dest) - 1);
+    const std::string path(dest, length > 0 ? static_cast<size_t>(length) : 0);
+
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+    return convert.from_bytes(path);
+}
+
+NativePath Platform::ToNativePath(const std::wstring& path)
+{
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+    return convert.to_bytes(path);
+}
+
+FILE* Platform::OpenFile(const std::wstring& path, const char* mode)
+{
+    return fopen(ToNativePath(path).c_str(), mode);
+}
+
+void Platform::CreateDirectories(const std::wstring& path)
+{
+    const std::string nativePath = ToNativePath(path);
+    for (size_t i = 1; i < nativePath.length(); ++i)
+    {
+        if (nativePath[i] == '/')
+        {
+            mkdir(nativePath.substr(0, i).c_str(), 0755);
+        }
+    }
+    mkdir(nativePath.c_str(), 0755);
+}
+
+bool Platform::RenameFile(const std::wstring& fromPath, const std::wstring& toPath)
+{
+    return rename(ToNativePath(fromPath).c_str(), ToNativePath(toPath).c_str()) == 0;
+}
+
+void Platform::RemoveFile(const std::wstring& path)
+{
+    unlink(ToNativePath(path).c_str());
+}
+
+uint64_t Platform::GetFileWriteTime(const std::wstring& path)
+{
+    struct stat attributes;
+    if (stat(ToNativePath(path).c_str(), &attributes) != 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(attributes.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(attributes.st_mtim.tv_nsec);
+}
+
+void* Platform::LoadSharedLibrary(const std::string& baseName)
+{
+    return dlopen(("lib" + baseName + ".so").c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+void* Platform::GetSharedLibrarySymbol(void* library, const char* name)
+{
+    return dlsym(library, name);
+}
+
+void Platform::FreeSharedLibrary(void* library)
+{
+    dlclose(library);
+}
+
+uint64_t Platform::StartProcess(const std::wstring& executablePath, const std::vector<std::string>& arguments)
+{
+    // everything exec needs is prepared before the fork, the child only calls exec and _exit
+    const std::string nativePath = ToNativePath(executablePath);
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(nativePath.c_str()));
+    for (const std::string& argument : arguments)
+    {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        execv(nativePath.c_str(), argv.data());
+        _exit(127);
+    }
+    return pid > 0 ? static_cast<uint64_t>(pid) : 0;
+}
+
+int Platform::WaitForProcess(uint64_t process)
+{
+    int status = 0;
+    if (waitpid(static_cast<pid_t>(process), &status, 0) < 0 || !WIFEXITED(status))
+    {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+bool Platform::HasProcessEnded(uint64_t process, int& exitCode)
+{
+    int status = 0;
+    const pid_t result = waitpid(static_cast<pid_t>(process), &status, WNOHANG);
+    if (result == 0)
+    {
+        return false;
+    }
+    exitCode = (result > 0 && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+    return true;
+}
+
+#endif
+
+bool Platform::WriteFileAtomically(const std::wstring& path, const std::function<bool(FILE* file)>& write)
+{
+    // the process id keeps processes apart, the counter the threads of this one
+    static std::atomic<uint32_t> nextTempFile(0);
+#ifdef _WIN32
+    const uint64_t processId = GetCurrentProcessId();
+#else
+    const uint64_t processId = static_cast<uint64_t>(getpid());
+#endif
+    const std::wstring tempPath = path + L"." + std::to_wstring(processId) + L"." + std::to_wstring(nextTempFile++) + L".tmp";
+
+    FILE* file = OpenFile(tempPath, "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = write(file);
+    written = (fclose(file) == 0) && written;
+    if (!written || !RenameFile(tempPath, path))
+    {
+        RemoveFile(tempPath);
+        return false;
+    }
+    return true;
+}
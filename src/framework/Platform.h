@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// Keys and mouse buttons the applications react to, the backends translate their native codes
+enum class InputKey : uint32_t
+{
+    W,
+    A,
+    S,
+    D,
+    I,
+    P,
+    R,
+    Shift,
+    Escape,
+    Count
+};
+
+enum class MouseButton : uint32_t
+{
+    Left,
+    Right,
+    Count
+};
+
+// Snapshot of the events one Platform::PumpEvents dispatched on top of what was held before,
+// cursor in window pixels. The per-frame parts, presses and cursor motion, are cleared at the
+// start of every pump, so a frame without events sees no presses and a zero delta.
+struct InputState
+{
+    std::array<bool, static_cast<size_t>(InputKey::Count)> Keys = { };
+    std::array<bool, static_cast<size_t>(InputKey::Count)> KeysPressed = { };
+    std::array<bool, static_cast<size_t>(MouseButton::Count)> Buttons = { };
+    int32_t CursorX = 0;
+    int32_t CursorY = 0;
+    int32_t CursorDeltaX = 0;
+    int32_t CursorDeltaY = 0;
+
+    bool IsKeyDown(InputKey key) const;
+    // went down during the last pump, auto repeat does not count
+    bool WasKeyPressed(InputKey key) const;
+    bool IsButtonDown(MouseButton button) const;
+
+    // for the backends
+    void BeginFrame();
+    void SetKey(InputKey key, bool down);
+    void SetButton(MouseButton button, bool down);
+    void MoveCursor(int32_t x, int32_t y);
+    // everything up, for when the window loses focus and the releases go elsewhere
+    void Reset();
+};
+
+// What the standard streams and the C runtime take as a file name
+#ifdef _WIN32
+typedef std::wstring NativePath;
+#else
+typedef std::string NativePath;
+#endif
+
+// Window, events, input and the presentation surface of one windowing system, plus the few
+// file system and process calls that differ between operating systems. The headless backend
+// has no window and no surface, Application renders into images of its own then.
+class Platform
+{
+protected:
+    InputState _input;
+    bool _closeRequested = false;
+
+public:
+    virtual ~Platform() = default;
+
+    // Win32 or XCB depending on the build, headless on request
+    static std::unique_ptr<Platform> Create(bool headless);
+
+    virtual bool IsHeadless() const = 0;
+    // The client area is width x height, the window is not resizable
+    virtual bool OpenWindow(const std::wstring& title, uint32_t width, uint32_t height) = 0;
+    virtual void CloseWindow() = 0;
+    // Instance extension CreateSurface needs besides VK_KHR_surface, nullptr without a window
+    virtual const char* GetSurfaceExtensionName() const = 0;
+    virtual VkResult CreateSurface(VkInstance instance, VkSurfaceKHR& surface) = 0;
+    // Handles the pending events without blocking and leaves them in the input snapshot, false
+    // once the window was closed or Escape pressed
+    virtual bool PumpEvents() = 0;
+
+    const InputState& GetInput() const;
+
+    // ============================================================
+    // File system and process
+    // ============================================================
+
+    // Folder of the running executable, without the trailing separator
+    static std::wstring GetExecutableFolder();
+    static std::wstring GetExecutablePath();
+    static NativePath ToNativePath(const std::wstring& path);
+    static FILE* OpenFile(const std::wstring& path, const char* mode);
+    // Every missing folder along the path
+    static void CreateDirectories(const std::wstring& path);
+    // Replaces an existing target
+    static bool RenameFile(const std::wstring& fromPath, const std::wstring& toPath);
+    static void RemoveFile(const std::wstring& path);
+    // Writes the file through the callback into a temporary next to it and renames that over the
+    // path, so a crash never leaves a truncated file behind. Any number of threads and processes
+    // may write the same path at once, the last rename wins. False when open, write or rename failed.
+    static bool WriteFileAtomically(const std::wstring& path, const std::function<bool(FILE* file)>& write);
+    // 0 when the file does not exist, only good for comparing against an earlier value
+    static uint64_t GetFileWriteTime(const std::wstring& path);
+
+    // The base name gets the platform prefix and extension, "shaderc_shared" is shaderc_shared.dll
+    // or libshaderc_shared.so
+    static void* LoadSharedLibrary(const std::string& baseName);
+    static void* GetSharedLibrarySymbol(void* library, const char* name);
+    static void FreeSharedLibrary(void* library);
+
+    // Starts the executable with the arguments and returns right away, 0 when it couldn't be started
+    static uint64_t StartProcess(const std::wstring& executablePath, const std::vector<std::string>& arguments);
+    // Waits for a process StartProcess started to end and returns its exit code, -1 when it crashed
+    static int WaitForProcess(uint64_t process);
+    // WaitForProcess without the wait, false while the process runs. Once it returns true the
+    // process is gone, it must not be waited for again.
+    static bool HasProcessEnded(uint64_t process, int& exitCode);
+};
@@ -0,0 +1,246 @@
+#ifdef _WIN32
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include "Application.h"
+
+#include <windowsx.h>
+
+class PlatformWin32 : public Platform
+{
+private:
+    HINSTANCE _windowInstance = nullptr;
+    HWND _window = nullptr;
+
+public:
+    ~PlatformWin32() override;
+
+    bool IsHeadless() const override;
+    bool OpenWindow(const std::wstring& title, uint32_t width, uint32_t height) override;
+    void CloseWindow() override;
+    const char* GetSurfaceExtensionName() const override;
+    VkResult CreateSurface(VkInstance instance, VkSurfaceKHR& surface) override;
+    bool PumpEvents() override;
+
+    // false lets DefWindowProc have the message
+    bool HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam);
+
+private:
+    void SetKey(WPARAM virtualKey, bool down);
+    void SetButton(MouseButton button, bool down);
+};
+
+static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    PlatformWin32* platform = reinterpret_cast<PlatformWin32*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    if (platform != nullptr && platform->HandleMessage(uMsg, wParam, lParam))
+    {
+        return 0;
+    }
+    return DefWindowProc(hWnd, uMsg, wParam, lParam);
+}
+
+std::unique_ptr<Platform> CreatePlatformWin32()
+{
+    return std::unique_ptr<Platform>(new PlatformWin32());
+}
+
+PlatformWin32::~PlatformWin32()
+{
+    CloseWindow();
+}
+
+bool PlatformWin32::IsHeadless() const
+{
+    return false;
+}
+
+bool PlatformWin32::OpenWindow(const std::wstring& title, uint32_t width, uint32_t height)
+{
+    _windowInstance = GetModuleHandle(0);
+
+    WNDCLASSEX wndClass;
+    wndClass.cbSize = sizeof(WNDCLASSEX);
+    wndClass.style = CS_HREDRAW | CS_VREDRAW;
+    wndClass.lpfnWndProc = WndProc;
+    wndClass.cbClsExtra = 0;
+    wndClass.cbWndExtra = 0;
+    wndClass.hInstance = _windowInstance;
+    wndClass.hIcon = LoadIcon(nullptr, IDI_APPLICATION);
+    wndClass.hCursor = LoadCursor(nullptr, IDC_ARROW);
+    wndClass.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
+    wndClass.lpszMenuName = nullptr;
+    wndClass.lpszClassName = title.c_str();
+    wndClass.hIconSm = LoadIcon(nullptr, IDI_WINLOGO);
+
+    // the class outlives the window, it is already registered when the application runs again
+    if (!RegisterClassEx(&wndClass) && GetLastError() != ERROR_CLASS_ALREADY_EXISTS)
+    {
+        LogError(L"Failed RegisterClassEx", true);
+        return false;
+    }
+
+    const uint32_t screenWidth = (uint32_t)GetSystemMetrics(SM_CXSCREEN);
+    const uint32_t screenHeight = (uint32_t)GetSystemMetrics(SM_CYSCREEN);
+
+    const DWORD exStyle = WS_EX_APPWINDOW | WS_EX_WINDOWEDGE;
+    const DWORD style = WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+
+    RECT windowRect;
+    windowRect.left = 0;
+    windowRect.top = 0;
+    windowRect.right = width;
+    windowRect.bottom = height;
+    AdjustWindowRectEx(&windowRect, style, FALSE, exStyle);
+
+    _window = CreateWindowEx(0,
+        title.c_str(),
+        title.c_str(),
+        style | WS_CLIPSIBLINGS | WS_CLIPCHILDREN,
+        0,
+        0,
+        windowRect.right - windowRect.left,
+        windowRect.bottom - windowRect.top,
+        nullptr,
+        nullptr,
+        _windowInstance,
+        nullptr);
+
+    if (!_window)
+    {
+        return false;
+    }
+
+    // messages sent from inside CreateWindowEx don't reach us, none of them matter
+    SetWindowLongPtr(_window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+    const uint32_t x = (screenWidth - windowRect.right) / 2;
+    const uint32_t y = (screenHeight - windowRect.bottom) / 2;
+    SetWindowPos(_window, 0, x, y, 0, 0, SWP_NOZORDER | SWP_NOSIZE);
+
+    ShowWindow(_window, SW_SHOW);
+    SetForegroundWindow(_window);
+    SetFocus(_window);
+    return true;
+}
+
+void PlatformWin32::CloseWindow()
+{
+    if (_window && IsWindow(_window))
+    {
+        SetWindowLongPtr(_window, GWLP_USERDATA, 0);
+        DestroyWindow(_window);
+    }
+    _window = nullptr;
+}
+
+const char* PlatformWin32::GetSurfaceExtensionName() const
+{
+    return VK_KHR_WIN32_SURFACE_EXTENSION_NAME;
+}
+
+VkResult PlatformWin32::CreateSurface(VkInstance instance, VkSurfaceKHR& surface)
+{
+    VkWin32SurfaceCreateInfoKHR surfaceCreateInfo;
+    surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+    surfaceCreateInfo.pNext = nullptr;
+    surfaceCreateInfo.flags = 0;
+    surfaceCreateInfo.hinstance = _windowInstance;
+    surfaceCreateInfo.hwnd = _window;
+
+    return vkCreateWin32SurfaceKHR(instance, &surfaceCreateInfo, nullptr, &surface);
+}
+
+bool PlatformWin32::PumpEvents()
+{
+    _input.BeginFrame();
+
+    MSG msg;
+    while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+    {
+        if (msg.message == WM_QUIT)
+        {
+            _closeRequested = true;
+        }
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    return !_closeRequested;
+}
+
+bool PlatformWin32::HandleMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    switch (uMsg)
+    {
+    case WM_CLOSE:
+        // the window stays until CloseWindow, the swapchain still presents to it
+        _closeRequested = true;
+        return true;
+
+    case WM_KEYDOWN:
+        if (wParam == VK_ESCAPE)
+        {
+            _closeRequested = true;
+        }
+        SetKey(wParam, true);
+        return true;
+
+    case WM_KEYUP:
+        SetKey(wParam, false);
+        return true;
+
+    case WM_LBUTTONDOWN:
+    case WM_LBUTTONUP:
+        SetButton(MouseButton::Left, uMsg == WM_LBUTTONDOWN);
+        return true;
+
+    case WM_RBUTTONDOWN:
+    case WM_RBUTTONUP:
+        SetButton(MouseButton::Right, uMsg == WM_RBUTTONDOWN);
+        return true;
+
+    case WM_MOUSEMOVE:
+        _input.MoveCursor(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+        return true;
+
+    case WM_KILLFOCUS:
+        _input.Reset();
+        return false;
+    }
+    return false;
+}
+
+void PlatformWin32::SetKey(WPARAM virtualKey, bool down)
+{
+    InputKey key;
+    switch (virtualKey)
+    {
+    case 'W': key = InputKey::W; break;
+    case 'A': key = InputKey::A; break;
+    case 'S': key = InputKey::S; break;
+    case 'D': key = InputKey::D; break;
+    case 'I': key = InputKey::I; break;
+    case 'P': key = InputKey::P; break;
+    case 'R': key = InputKey::R; break;
+    case VK_SHIFT: key = InputKey::Shift; break;
+    case VK_ESCAPE: key = InputKey::Escape; break;
+    default: return;
+    }
+    _input.SetKey(key, down);
+}
+
+void PlatformWin32::SetButton(MouseButton button, bool down)
+{
+    _input.SetButton(button, down);
+
+    // keep the cursor coming while dragging outside the window
+    if (down)
+    {
+        SetCapture(_window);
+    }
+    else if (!_input.IsButtonDown(MouseButton::Left) && !_input.IsButtonDown(MouseButton::Right))
+    {
+        ReleaseCapture();
+    }
+}
+
+#endif
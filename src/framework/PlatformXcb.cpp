@@ -0,0 +1,261 @@
+#ifdef __linux__
+
+#define VK_USE_PLATFORM_XCB_KHR
+#include "Application.h"
+
+#include <codecvt>
+#include <cstdlib>
+#include <cstring>
+#include <locale>
+
+// X keycodes as the evdev driver every current X server uses hands them out, layout independent
+static const xcb_keycode_t PLATFORM_XCB_KEY_ESCAPE = 9;
+static const xcb_keycode_t PLATFORM_XCB_KEY_W = 25;
+static const xcb_keycode_t PLATFORM_XCB_KEY_R = 27;
+static const xcb_keycode_t PLATFORM_XCB_KEY_I = 31;
+static const xcb_keycode_t PLATFORM_XCB_KEY_P = 33;
+static const xcb_keycode_t PLATFORM_XCB_KEY_A = 38;
+static const xcb_keycode_t PLATFORM_XCB_KEY_S = 39;
+static const xcb_keycode_t PLATFORM_XCB_KEY_D = 40;
+static const xcb_keycode_t PLATFORM_XCB_KEY_SHIFT_LEFT = 50;
+static const xcb_keycode_t PLATFORM_XCB_KEY_SHIFT_RIGHT = 62;
+
+static const xcb_button_t PLATFORM_XCB_BUTTON_LEFT = 1;
+static const xcb_button_t PLATFORM_XCB_BUTTON_RIGHT = 3;
+
+class PlatformXcb : public Platform
+{
+private:
+    xcb_connection_t* _connection = nullptr;
+    xcb_window_t _window = 0;
+    xcb_atom_t _deleteWindowAtom = 0;
+
+public:
+    ~PlatformXcb() override;
+
+    bool IsHeadless() const override;
+    bool OpenWindow(const std::wstring& title, uint32_t width, uint32_t height) override;
+    void CloseWindow() override;
+    const char* GetSurfaceExtensionName() const override;
+    VkResult CreateSurface(VkInstance instance, VkSurfaceKHR& surface) override;
+    bool PumpEvents() override;
+
+private:
+    xcb_atom_t InternAtom(const char* name, bool onlyIfExists);
+    void SetKey(xcb_keycode_t keycode, bool down);
+    void SetButton(xcb_button_t button, bool down);
+};
+
+std::unique_ptr<Platform> CreatePlatformXcb()
+{
+    return std::unique_ptr<Platform>(new PlatformXcb());
+}
+
+PlatformXcb::~PlatformXcb()
+{
+    CloseWindow();
+}
+
+bool PlatformXcb::IsHeadless() const
+{
+    return false;
+}
+
+xcb_atom_t PlatformXcb::InternAtom(const char* name, bool onlyIfExists)
+{
+    const xcb_intern_atom_cookie_t cookie = xcb_intern_atom(_connection, onlyIfExists ? 1 : 0, static_cast<uint16_t>(strlen(name)), name);
+    xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(_connection, cookie, nullptr);
+    const xcb_atom_t atom = reply ? reply->atom : static_cast<xcb_atom_t>(XCB_ATOM_NONE);
+    free(reply);
+    return atom;
+}
+
+bool PlatformXcb::OpenWindow(const std::wstring& title, uint32_t width, uint32_t height)
+{
+    int screenIndex = 0;
+    _connection = xcb_connect(nullptr, &screenIndex);
+    if (xcb_connection_has_error(_connection))
+    {
+        LogError(L"Can't connect to the X server, run with --headless on machines without a display", true);
+        xcb_disconnect(_connection);
+        _connection = nullptr;
+        return false;
+    }
+
+    xcb_screen_iterator_t screenIterator = xcb_setup_roots_iterator(xcb_get_setup(_connection));
+    for (int i = 0; i < screenIndex; ++i)
+    {
+        xcb_screen_next(&screenIterator);
+    }
+    const xcb_screen_t* screen = screenIterator.data;
+
+    const uint32_t eventMask = XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
+        XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION |
+        XCB_EVENT_MASK_FOCUS_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    const uint32_t values[] = { screen->black_pixel, eventMask };
+
+    const int16_t x = static_cast<int16_t>((static_cast<int32_t>(screen->width_in_pixels) - static_cast<int32_t>(width)) / 2);
+    const int16_t y = static_cast<int16_t>((static_cast<int32_t>(screen->height_in_pixels) - static_cast<int32_t>(height)) / 2);
+
+    _window = xcb_generate_id(_connection);
+    xcb_create_window(_connection, XCB_COPY_FROM_PARENT, _window, screen->root, x, y,
+        static_cast<uint16_t>(width), static_cast<uint16_t>(height), 0, XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+        XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK, values);
+
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+    const std::string utf8Title = convert.to_bytes(title);
+    xcb_change_property(_connection, XCB_PROP_MODE_REPLACE, _window, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+        static_cast<uint32_t>(utf8Title.length()), utf8Title.c_str());
+
+    // the window manager sends WM_DELETE_WINDOW instead of killing the connection on close
+    const xcb_atom_t protocolsAtom = InternAtom("WM_PROTOCOLS", true);
+    _deleteWindowAtom = InternAtom("WM_DELETE_WINDOW", false);
+    xcb_change_property(_connection, XCB_PROP_MODE_REPLACE, _window, protocolsAtom, XCB_ATOM_ATOM, 32, 1, &_deleteWindowAtom);
+
+    xcb_map_window(_connection, _window);
+    xcb_flush(_connection);
+    return true;
+}
+
+void PlatformXcb::CloseWindow()
+{
+    if (_connection)
+    {
+        xcb_destroy_window(_connection, _window);
+        xcb_disconnect(_connection);
+    }
+    _connection = nullptr;
+    _window = 0;
+}
+
+const char* PlatformXcb::GetSurfaceExtensionName() const
+{
+    return VK_KHR_XCB_SURFACE_EXTENSION_NAME;
+}
+
+VkResult PlatformXcb::CreateSurface(VkInstance instance, VkSurfaceKHR& surface)
+{
+    VkXcbSurfaceCreateInfoKHR surfaceCreateInfo;
+    surfaceCreateInfo.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+    surfaceCreateInfo.pNext = nullptr;
+    surfaceCreateInfo.flags = 0;
+    surfaceCreateInfo.connection = _connection;
+    surfaceCreateInfo.window = _window;
+
+    return vkCreateXcbSurfaceKHR(instance, &surfaceCreateInfo, nullptr, &surface);
+}
+
+bool PlatformXcb::PumpEvents()
+{
+    _input.BeginFrame();
+
+    xcb_generic_event_t* pending = nullptr;
+    while (xcb_generic_event_t* event = pending ? pending : xcb_poll_for_event(_connection))
+    {
+        pending = nullptr;
+
+        switch (event->response_type & 0x7f)
+        {
+        case XCB_KEY_PRESS:
+        {
+            const xcb_key_press_event_t* keyEvent = reinterpret_cast<const xcb_key_press_event_t*>(event);
+            if (keyEvent->detail == PLATFORM_XCB_KEY_ESCAPE)
+            {
+                _closeRequested = true;
+            }
+            SetKey(keyEvent->detail, true);
+            break;
+        }
+
+        case XCB_KEY_RELEASE:
+        {
+            // auto repeat is a release and a press with the same time stamp, the key stays down
+            const xcb_key_release_event_t* keyEvent = reinterpret_cast<const xcb_key_release_event_t*>(event);
+            xcb_generic_event_t* next = xcb_poll_for_queued_event(_connection);
+            const xcb_key_press_event_t* nextKeyEvent = reinterpret_cast<const xcb_key_press_event_t*>(next);
+            if (next && (next->response_type & 0x7f) == XCB_KEY_PRESS &&
+                nextKeyEvent->detail == keyEvent->detail && nextKeyEvent->time == keyEvent->time)
+            {
+                free(next);
+                break;
+            }
+            SetKey(keyEvent->detail, false);
+            pending = next;
+            break;
+        }
+
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        {
+            const xcb_button_press_event_t* buttonEvent = reinterpret_cast<const xcb_button_press_event_t*>(event);
+            _input.MoveCursor(buttonEvent->event_x, buttonEvent->event_y);
+            SetButton(buttonEvent->detail, (event->response_type & 0x7f) == XCB_BUTTON_PRESS);
+            break;
+        }
+
+        case XCB_MOTION_NOTIFY:
+        {
+            const xcb_motion_notify_event_t* motionEvent = reinterpret_cast<const xcb_motion_notify_event_t*>(event);
+            _input.MoveCursor(motionEvent->event_x, motionEvent->event_y);
+            break;
+        }
+
+        case XCB_FOCUS_OUT:
+            _input.Reset();
+            break;
+
+        case XCB_CLIENT_MESSAGE:
+        {
+            const xcb_client_message_event_t* messageEvent = reinterpret_cast<const xcb_client_message_event_t*>(event);
+            if (messageEvent->data.data32[0] == _deleteWindowAtom)
+            {
+                _closeRequested = true;
+            }
+            break;
+        }
+        }
+
+        free(event);
+    }
+
+    if (xcb_connection_has_error(_connection))
+    {
+        _closeRequested = true;
+    }
+    return !_closeRequested;
+}
+
+void PlatformXcb::SetKey(xcb_keycode_t keycode, bool down)
+{
+    InputKey key;
+    switch (keycode)
+    {
+    case PLATFORM_XCB_KEY_W: key = InputKey::W; break;
+    case PLATFORM_XCB_KEY_A: key = InputKey::A; break;
+    case PLATFORM_XCB_KEY_S: key = InputKey::S; break;
+    case PLATFORM_XCB_KEY_D: key = InputKey::D; break;
+    case PLATFORM_XCB_KEY_I: key = InputKey::I; break;
+    case PLATFORM_XCB_KEY_P: key = InputKey::P; break;
+    case PLATFORM_XCB_KEY_R: key = InputKey::R; break;
+    case PLATFORM_XCB_KEY_SHIFT_LEFT:
+    case PLATFORM_XCB_KEY_SHIFT_RIGHT: key = InputKey::Shift; break;
+    case PLATFORM_XCB_KEY_ESCAPE: key = InputKey::Escape; break;
+    default: return;
+    }
+    _input.SetKey(key, down);
+}
+
+void PlatformXcb::SetButton(xcb_button_t button, bool down)
+{
+    // X grabs the pointer for the window while a button is held, dragging outside keeps working
+    if (button == PLATFORM_XCB_BUTTON_LEFT)
+    {
+        _input.SetButton(MouseButton::Left, down);
+    }
+    else if (button == PLATFORM_XCB_BUTTON_RIGHT)
+    {
+        _input.SetButton(MouseButton::Right, down);
+    }
+}
+
+#endif
@@ -0,0 +1,308 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+// samples kept per scope for the rolling statistics
+static const size_t PROFILER_HISTORY_SIZE = 256;
+// the trace export stops recording past this, a few minutes of frames
+static const size_t PROFILER_MAX_TRACE_EVENTS = 256 * 1024;
+
+static const uint32_t PROFILER_TRACK_CPU = 0;
+static const uint32_t PROFILER_TRACK_GPU = 1;
+
+static const uint32_t PROFILER_INVALID_SCOPE = ~0u;
+
+Profiler::~Profiler()
+{
+    Cleanup();
+}
+
+VkResult Profiler::Initialize(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlotCount, uint32_t maxScopesPerSlot)
+{
+    Cleanup();
+
+    _device = device;
+    _queriesPerSlot = maxScopesPerSlot * 2;
+    _slots.resize(frameSlotCount + 1);
+    for (uint32_t i = 0; i < _slots.size(); ++i)
+    {
+        _slots[i].FirstQuery = i * _queriesPerSlot;
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    const uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+    if (validBits == 0)
+    {
+        // CPU scopes keep working, GPU scopes turn into no-ops
+        return VK_SUCCESS;
+    }
+
+    _timestampPeriod = properties.limits.timestampPeriod;
+    _timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo;
+    queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolCreateInfo.pNext = nullptr;
+    queryPoolCreateInfo.flags = 0;
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = static_cast<uint32_t>(_slots.size()) * _queriesPerSlot;
+    queryPoolCreateInfo.pipelineStatistics = 0;
+
+    return vkCreateQueryPool(_device, &queryPoolCreateInfo, nullptr, &_queryPool);
+}
+
+void Profiler::Cleanup()
+{
+    if (_queryPool)
+    {
+        vkDestroyQueryPool(_device, _queryPool, nullptr);
+        _queryPool = VK_NULL_HANDLE;
+    }
+    _slots.clear();
+}
+
+bool Profiler::IsGpuEnabled() const
+{
+    return _queryPool != VK_NULL_HANDLE;
+}
+
+uint32_t Profiler::GetImmediateSlot() const
+{
+    return static_cast<uint32_t>(_slots.size()) - 1;
+}
+
+void Profiler::BeginSlot(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    if (!IsGpuEnabled())
+    {
+        return;
+    }
+
+    // results of an earlier recording no longer match the scope list
+    Slot& querySlot = _slots[slot];
+    querySlot.Scopes.clear();
+    querySlot.Pending = false;
+
+    vkCmdResetQueryPool(commandBuffer, _queryPool, querySlot.FirstQuery, _queriesPerSlot);
+}
+
+uint32_t Profiler::BeginGpuScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name)
+{
+    if (!IsGpuEnabled())
+    {
+        return PROFILER_INVALID_SCOPE;
+    }
+
+    Slot& querySlot = _slots[slot];
+    const uint32_t scope = static_cast<uint32_t>(querySlot.Scopes.size());
+    if ((scope + 1) * 2 > _queriesPerSlot)
+    {
+        return PROFILER_INVALID_SCOPE;
+    }
+
+    GpuScope gpuScope;
+    gpuScope.Name = name;
+    gpuScope.Query = querySlot.FirstQuery + scope * 2;
+    querySlot.Scopes.push_back(gpuScope);
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, gpuScope.Query);
+    return scope;
+}
+
+void Profiler::EndGpuScope(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t scope)
+{
+    if (!IsGpuEnabled() || scope == PROFILER_INVALID_SCOPE)
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, _slots[slot].Scopes[scope].Query + 1);
+}
+
+void Profiler::MarkSubmitted(uint32_t slot)
+{
+    if (IsGpuEnabled())
+    {
+        _slots[slot].Pending = true;
+    }
+}
+
+void Profiler::CollectSlot(uint32_t slot)
+{
+    if (!IsGpuEnabled())
+    {
+        return;
+    }
+
+    Slot& querySlot = _slots[slot];
+    if (!querySlot.Pending || querySlot.Scopes.empty())
+    {
+        return;
+    }
+
+    const uint32_t queryCount = static_cast<uint32_t>(querySlot.Scopes.size()) * 2;
+    std::vector<uint64_t> timestamps(queryCount);
+
+    // no VK_QUERY_RESULT_WAIT_BIT, the caller only collects slots whose fence has signaled
+    const VkResult code = vkGetQueryPoolResults(_device, _queryPool, querySlot.FirstQuery, queryCount,
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (code != VK_SUCCESS)
+    {
+        return;
+    }
+    querySlot.Pending = false;
+
+    const double microsecondsPerTick = _timestampPeriod / 1000.0;
+
+    // the GPU clock isn't calibrated against the CPU one, the GPU track is anchored
+    // to the CPU time of the first collection and runs on its own ticks from there
+    if (!_hasGpuBase)
+    {
+        _hasGpuBase = true;
+        _gpuBaseTimestamp = timestamps[0];
+        _gpuBaseTime = GetCpuTime() - ((timestamps[queryCount - 1] - timestamps[0]) & _timestampMask) * microsecondsPerTick;
+    }
+
+    for (uint32_t i = 0; i < querySlot.Scopes.size(); ++i)
+    {
+        const uint64_t begin = timestamps[i * 2];
+        const uint64_t end = timestamps[i * 2 + 1];
+
+        const double start = _gpuBaseTime + ((begin - _gpuBaseTimestamp) & _timestampMask) * microsecondsPerTick;
+        const double duration = ((end - begin) & _timestampMask) * microsecondsPerTick;
+        AddSample(querySlot.Scopes[i].Name, start, duration, PROFILER_TRACK_GPU);
+    }
+}
+
+double Profiler::GetCpuTime() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - _startTime).count();
+}
+
+void Profiler::AddCpuSample(const std::string& name, double start, double duration)
+{
+    AddSample(name, start, duration, PROFILER_TRACK_CPU);
+}
+
+void Profiler::AddSample(const std::string& name, double start, double duration, uint32_t track)
+{
+    // CPU and GPU scopes of the same name are kept apart
+    History& history = _history[(track == PROFILER_TRACK_GPU ? "gpu/" : "cpu/") + name];
+    if (history.Samples.size() < PROFILER_HISTORY_SIZE)
+    {
+        history.Samples.push_back(duration / 1000.0);
+    }
+    else
+    {
+        history.Samples[history.Next] = duration / 1000.0;
+    }
+    history.Next = (history.Next + 1) % PROFILER_HISTORY_SIZE;
+
+    if (_events.size() < PROFILER_MAX_TRACE_EVENTS)
+    {
+        _events.push_back({ name, start, duration, track });
+    }
+}
+
+bool Profiler::GetStats(const std::string& name, ScopeStats& stats) const
+{
+    const auto history = _history.find(name);
+    if (history == _history.end() || history->second.Samples.empty())
+    {
+        return false;
+    }
+
+    std::vector<double> samples = history->second.Samples;
+    std::sort(samples.begin(), samples.end());
+
+    auto Percentile = [&samples](double percentile) -> double {
+        const size_t index = static_cast<size_t>(percentile * (samples.size() - 1) + 0.5);
+        return samples[index];
+    };
+
+    stats.Samples = static_cast<uint32_t>(samples.size());
+    stats.Average = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    stats.Min = samples.front();
+    stats.Max = samples.back();
+    stats.P50 = Percentile(0.50);
+    stats.P95 = Percentile(0.95);
+    stats.P99 = Percentile(0.99);
+    return true;
+}
+
+void Profiler::PrintStats() const
+{
+    std::cout << std::fixed << std::setprecision(3) << "Profiler (ms, last " << PROFILER_HISTORY_SIZE << " samples):\n";
+    for (const auto& history : _history)
+    {
+        ScopeStats stats;
+        if (GetStats(history.first, stats))
+        {
+            std::cout << "  " << std::left << std::setw(32) << history.first << std::right
+                << " avg " << stats.Average << " p50 " << stats.P50 << " p95 " << stats.P95 << " p99 " << stats.P99
+                << " max " << stats.Max << " (" << stats.Samples << ")\n";
+        }
+    }
+}
+
+bool Profiler::WriteChromeTrace(const std::wstring& filePath) const
+{
+    std::ofstream file(Platform::ToNativePath(filePath), std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    auto WriteString = [&file](const std::string& value) {
+        file << '"';
+        for (const char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                file << '\\';
+            }
+            file << c;
+        }
+        file << '"';
+    };
+
+    // load in chrome://tracing or ui.perfetto.dev
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << PROFILER_TRACK_CPU << ",\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << PROFILER_TRACK_GPU << ",\"args\":{\"name\":\"GPU\"}}";
+
+    for (const TraceEvent& event : _events)
+    {
+        file << ",\n{\"name\":";
+        WriteString(event.Name);
+        file << ",\"cat\":\"" << (event.Track == PROFILER_TRACK_GPU ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.Track
+            << ",\"ts\":" << event.Start << ",\"dur\":" << event.Duration << "}";
+    }
+
+    file << "\n]}\n";
+    file.close();
+    return !file.fail();
+}
+
+ProfilerCpuScope::ProfilerCpuScope(Profiler* profiler, const char* name)
+    : _profiler(profiler)
+    , _name(name)
+    , _start(profiler ? profiler->GetCpuTime() : 0.0)
+{
+}
+
+ProfilerCpuScope::~ProfilerCpuScope()
+{
+    if (_profiler)
+    {
+        _profiler->AddCpuSample(_name, _start, _profiler->GetCpuTime() - _start);
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Application.h"
+
+#include <chrono>
+#include <map>
+
+// GPU scopes are timestamp query pairs recorded into command buffers, CPU scopes are
+// taken with the high resolution clock. Every command buffer gets its own slot of queries;
+// a slot is read back without waiting once the fence of its submission has signaled, so
+// results arrive with the usual frames-in-flight latency. The last samples of every scope
+// are kept for averages and percentiles, and all samples can be exported as a Chrome trace.
+class Profiler
+{
+public:
+    // milliseconds
+    struct ScopeStats
+    {
+        uint32_t Samples = 0;
+        double Average = 0.0;
+        double Min = 0.0;
+        double Max = 0.0;
+        double P50 = 0.0;
+        double P95 = 0.0;
+        double P99 = 0.0;
+    };
+
+private:
+    struct GpuScope
+    {
+        std::string Name;
+        uint32_t Query;
+    };
+
+    struct Slot
+    {
+        uint32_t FirstQuery = 0;
+        std::vector<GpuScope> Scopes;
+        bool Pending = false;
+    };
+
+    struct History
+    {
+        std::vector<double> Samples;
+        size_t Next = 0;
+    };
+
+    struct TraceEvent
+    {
+        std::string Name;
+        double Start;       // microseconds
+        double Duration;    // microseconds
+        uint32_t Track;
+    };
+
+    VkDevice _device = VK_NULL_HANDLE;
+    VkQueryPool _queryPool = VK_NULL_HANDLE;
+    double _timestampPeriod = 0.0;
+    uint64_t _timestampMask = 0;
+    uint32_t _queriesPerSlot = 0;
+    std::vector<Slot> _slots;
+    std::map<std::string, History> _history;
+    std::vector<TraceEvent> _events;
+    std::chrono::high_resolution_clock::time_point _startTime = std::chrono::high_resolution_clock::now();
+    bool _hasGpuBase = false;
+    uint64_t _gpuBaseTimestamp = 0;
+    double _gpuBaseTime = 0.0;
+
+public:
+    Profiler() = default;
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    ~Profiler();
+
+public:
+    // One slot per prerecorded command buffer, an extra one is reserved for one-shot submissions
+    VkResult Initialize(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlotCount, uint32_t maxScopesPerSlot);
+    void Cleanup();
+
+    bool IsGpuEnabled() const;
+    uint32_t GetImmediateSlot() const;
+
+    // Resets the slot queries, record it right after vkBeginCommandBuffer
+    void BeginSlot(VkCommandBuffer commandBuffer, uint32_t slot);
+    uint32_t BeginGpuScope(VkCommandBuffer commandBuffer, uint32_t slot, const std::string& name);
+    void EndGpuScope(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t scope);
+
+    // Call after submitting a command buffer recorded into the slot
+    void MarkSubmitted(uint32_t slot);
+    // Call once the submission has completed, never waits
+    void CollectSlot(uint32_t slot);
+
+    // microseconds since the profiler was created
+    double GetCpuTime() const;
+    void AddCpuSample(const std::string& name, double start, double duration);
+
+    // Scope names are prefixed with the track, e.g. "gpu/trace" or "cpu/update"
+    bool GetStats(const std::string& name, ScopeStats& stats) const;
+    void PrintStats() const;
+    bool WriteChromeTrace(const std::wstring& filePath) const;
+
+private:
+    void AddSample(const std::string& name, double start, double duration, uint32_t track);
+};
+
+// Times the enclosing block on the CPU track, does nothing with a null profiler
+class ProfilerCpuScope
+{
+private:
+    Profiler* _profiler;
+    const char* _name;
+    double _start;
+
+public:
+    ProfilerCpuScope(Profiler* profiler, const char* name);
+    ~ProfilerCpuScope();
+};
@@ -1,4 +1,7 @@
 #include "RaytracingApplication.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
 
 RaytracingApplication::RaytracingApplication()
 {
@@ -44,6 +47,19 @@ void RaytracingApplication::CreateDevice()
 
     vkGetPhysicalDeviceFeatures2( _physicalDevice, &features2 );
 
+    // presenting needs a window
+    if (!_platform->IsHeadless() && std::find(_deviceExtensions.begin(), _deviceExtensions.end(), VK_KHR_SWAPCHAIN_EXTENSION_NAME) == _deviceExtensions.end())
+    {
+        _deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    // optional, MemoryTracker falls back to an estimated budget without it
+    _memoryBudgetEnabled = IsDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (_memoryBudgetEnabled && std::find(_deviceExtensions.begin(), _deviceExtensions.end(), VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == _deviceExtensions.end())
+    {
+        _deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     VkDeviceCreateInfo deviceCreateInfo;
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.pNext = &features2;
@@ -74,6 +90,7 @@ void RaytracingApplication::InitRaytracing()
     NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkGetAccelerationStructureMemoryRequirementsNVX);
     NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkGetAccelerationStructureScratchMemoryRequirementsNVX);
     NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkCmdCopyAccelerationStructureNVX);
+    NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkCmdWriteAccelerationStructurePropertiesNVX);
     NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkBindAccelerationStructureMemoryNVX);
     NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkCmdBuildAccelerationStructureNVX);
     NVVK_RESOLVE_DEVICE_FUNCTION_ADDRESS(_device, vkCmdTraceRaysNVX);
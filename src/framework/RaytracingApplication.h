@@ -26,6 +26,7 @@ protected:
     PFN_vkGetAccelerationStructureMemoryRequirementsNVX vkGetAccelerationStructureMemoryRequirementsNVX = VK_NULL_HANDLE;
     PFN_vkGetAccelerationStructureScratchMemoryRequirementsNVX vkGetAccelerationStructureScratchMemoryRequirementsNVX = VK_NULL_HANDLE;
     PFN_vkCmdCopyAccelerationStructureNVX vkCmdCopyAccelerationStructureNVX = VK_NULL_HANDLE;
+    PFN_vkCmdWriteAccelerationStructurePropertiesNVX vkCmdWriteAccelerationStructurePropertiesNVX = VK_NULL_HANDLE;
     PFN_vkBindAccelerationStructureMemoryNVX vkBindAccelerationStructureMemoryNVX = VK_NULL_HANDLE;
     PFN_vkCmdBuildAccelerationStructureNVX vkCmdBuildAccelerationStructureNVX = VK_NULL_HANDLE;
     PFN_vkCmdTraceRaysNVX vkCmdTraceRaysNVX = VK_NULL_HANDLE;
@@ -0,0 +1,152 @@
+#include "ShaderBindingTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+// NVX does not report a base alignment for the table sections, 64 bytes satisfies
+// every implementation of the later NV extension
+static const VkDeviceSize SBT_SECTION_ALIGNMENT = 64;
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void ShaderBindingTable::AddGroup(const std::string& name, uint32_t groupIndex)
+{
+    _groups[name] = groupIndex;
+    _groupCount = std::max(_groupCount, groupIndex + 1);
+}
+
+uint32_t ShaderBindingTable::AddRaygenRecord(const std::string& groupName, const void* data, size_t dataSize)
+{
+    return AddRecord(_raygenRecords, groupName, data, dataSize);
+}
+
+uint32_t ShaderBindingTable::AddMissRecord(const std::string& groupName, const void* data, size_t dataSize)
+{
+    return AddRecord(_missRecords, groupName, data, dataSize);
+}
+
+uint32_t ShaderBindingTable::AddHitRecord(const std::string& groupName, const void* data, size_t dataSize)
+{
+    return AddRecord(_hitRecords, groupName, data, dataSize);
+}
+
+uint32_t ShaderBindingTable::AddRecord(std::vector<Record>& records, const std::string& groupName, const void* data, size_t dataSize)
+{
+    const auto group = _groups.find(groupName);
+    if (group == _groups.end())
+    {
+        ExitError(L"Unknown shader group: " + std::wstring(groupName.begin(), groupName.end()));
+    }
+
+    Record record;
+    record.Group = group->second;
+    if (data != nullptr && dataSize > 0)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        record.Data.assign(bytes, bytes + dataSize);
+    }
+    records.push_back(std::move(record));
+
+    return static_cast<uint32_t>(records.size() - 1);
+}
+
+VkResult ShaderBindingTable::Build(VkPipeline pipeline, const VkPhysicalDeviceRaytracingPropertiesNVX& properties,
+    PFN_vkGetRaytracingShaderHandlesNVX getShaderHandles)
+{
+    const VkDeviceSize headerSize = properties.shaderHeaderSize;
+
+    std::vector<uint8_t> groupHandles(static_cast<size_t>(headerSize * _groupCount));
+    VkResult code = getShaderHandles(_device, pipeline, 0, _groupCount, groupHandles.size(), groupHandles.data());
+    if (code != VK_SUCCESS)
+    {
+        return code;
+    }
+
+    // stride has to stay a multiple of the header size
+    auto LayoutSection = [headerSize](const std::vector<Record>& records, VkDeviceSize offset, Section& section)
+    {
+        size_t maxDataSize = 0;
+        for (const Record& record : records)
+        {
+            maxDataSize = std::max(maxDataSize, record.Data.size());
+        }
+
+        section.Offset = AlignUp(offset, SBT_SECTION_ALIGNMENT);
+        section.Stride = AlignUp(headerSize + maxDataSize, headerSize);
+        section.Count = static_cast<uint32_t>(records.size());
+        return section.Offset + section.Stride * section.Count;
+    };
+
+    VkDeviceSize tableSize = LayoutSection(_raygenRecords, 0, _raygen);
+    tableSize = LayoutSection(_missRecords, tableSize, _miss);
+    tableSize = LayoutSection(_hitRecords, tableSize, _hit);
+
+    std::vector<uint8_t> table(static_cast<size_t>(tableSize), 0);
+
+    auto WriteSection = [&](const std::vector<Record>& records, const Section& section)
+    {
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            uint8_t* record = table.data() + section.Offset + section.Stride * i;
+            memcpy(record, groupHandles.data() + headerSize * records[i].Group, static_cast<size_t>(headerSize));
+            if (!records[i].Data.empty())
+            {
+                memcpy(record + headerSize, records[i].Data.data(), records[i].Data.size());
+            }
+        }
+    };
+
+    WriteSection(_raygenRecords, _raygen);
+    WriteSection(_missRecords, _miss);
+    WriteSection(_hitRecords, _hit);
+
+    _buffer.Cleanup();
+    code = _buffer.Create(tableSize, VK_BUFFER_USAGE_RAYTRACING_BIT_NVX | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (code != VK_SUCCESS)
+    {
+        return code;
+    }
+
+    if (!_buffer.CopyToBufferUsingStaging(table.data(), tableSize))
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    return VK_SUCCESS;
+}
+
+void ShaderBindingTable::Cleanup()
+{
+    _buffer.Cleanup();
+    _groups.clear();
+    _groupCount = 0;
+    _raygenRecords.clear();
+    _missRecords.clear();
+    _hitRecords.clear();
+    _raygen = Section();
+    _miss = Section();
+    _hit = Section();
+}
+
+VkBuffer ShaderBindingTable::GetBuffer() const
+{
+    return _buffer.Buffer;
+}
+
+const ShaderBindingTable::Section& ShaderBindingTable::GetRaygenSection() const
+{
+    return _raygen;
+}
+
+const ShaderBindingTable::Section& ShaderBindingTable::GetMissSection() const
+{
+    return _miss;
+}
+
+const ShaderBindingTable::Section& ShaderBindingTable::GetHitSection() const
+{
+    return _hit;
+}
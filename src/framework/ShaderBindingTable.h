@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Application.h"
+
+#include <unordered_map>
+
+// Builds the shader binding table from named pipeline groups. Records are appended per
+// section with optional inline data (shaderRecordNVX in the shaders), every section gets
+// one stride large enough for its biggest record, and the result is uploaded to device
+// local memory.
+class ShaderBindingTable : public ResourceBase
+{
+public:
+    struct Section
+    {
+        VkDeviceSize Offset = 0;
+        VkDeviceSize Stride = 0;
+        uint32_t Count = 0;
+    };
+
+private:
+    struct Record
+    {
+        uint32_t Group;
+        std::vector<uint8_t> Data;
+    };
+
+    std::unordered_map<std::string, uint32_t> _groups;
+    uint32_t _groupCount = 0;
+    std::vector<Record> _raygenRecords;
+    std::vector<Record> _missRecords;
+    std::vector<Record> _hitRecords;
+
+    Section _raygen;
+    Section _miss;
+    Section _hit;
+    BufferResource _buffer;
+
+public:
+    // groupIndex is the value used in pGroupNumbers when the pipeline was created
+    void AddGroup(const std::string& name, uint32_t groupIndex);
+
+    // Return the index of the record within its section
+    uint32_t AddRaygenRecord(const std::string& groupName, const void* data = nullptr, size_t dataSize = 0);
+    uint32_t AddMissRecord(const std::string& groupName, const void* data = nullptr, size_t dataSize = 0);
+    uint32_t AddHitRecord(const std::string& groupName, const void* data = nullptr, size_t dataSize = 0);
+
+    // Fetches the group handles from the pipeline and uploads the table, can be called
+    // again with a rebuilt pipeline that uses the same groups
+    VkResult Build(VkPipeline pipeline, const VkPhysicalDeviceRaytracingPropertiesNVX& properties,
+        PFN_vkGetRaytracingShaderHandlesNVX getShaderHandles);
+
+    // Drops the groups, records and the buffer
+    void Cleanup();
+
+    VkBuffer GetBuffer() const;
+    const Section& GetRaygenSection() const;
+    const Section& GetMissSection() const;
+    const Section& GetHitSection() const;
+
+private:
+    uint32_t AddRecord(std::vector<Record>& records, const std::string& groupName, const void* data, size_t dataSize);
+};
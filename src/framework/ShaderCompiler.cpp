@@ -0,0 +1,444 @@
+#include "ShaderCompiler.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <codecvt>
+#include <cstring>
+#include <locale>
+
+// .spvc layout: header, dependency table (content hash, path length, UTF-8 path), then the SPIR-V words
+static const uint32_t SHADER_CACHE_MAGIC = 0x43505356; // "VSPC"
+static const uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Key;
+    uint32_t DependencyCount;
+    uint32_t SpirvSize;
+};
+
+struct ShaderCacheDependency
+{
+    uint64_t ContentHash;
+    uint32_t PathLength;
+    uint32_t Reserved;
+};
+
+struct IncludeContext
+{
+    std::string SourceFolderPath;
+    std::vector<std::string> Dependencies;
+};
+
+// Owns the strings an include result points to until shaderc releases it
+struct IncludeResult
+{
+    shaderc_include_result Result;
+    std::string SourceName;
+    std::string Content;
+};
+
+static std::string ToUtf8(const std::wstring& value)
+{
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+    return convert.to_bytes(value);
+}
+
+static std::wstring FromUtf8(const std::string& value)
+{
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> convert;
+    return convert.from_bytes(value);
+}
+
+static bool ReadFileBytes(const std::wstring& filePath, std::vector<char>& bytes)
+{
+    std::ifstream fileStream(Platform::ToNativePath(filePath), std::ios::binary | std::ios::in | std::ios::ate);
+    if (!fileStream.is_open())
+    {
+        return false;
+    }
+    const size_t size = static_cast<size_t>(fileStream.tellg());
+    fileStream.seekg(0, std::ios::beg);
+    bytes.resize(size);
+    fileStream.read(bytes.data(), size);
+    return !fileStream.fail();
+}
+
+static shaderc_include_result* ResolveInclude(void* userData, const char* requestedSource, int type,
+    const char* requestingSource, size_t)
+{
+    IncludeContext* context = static_cast<IncludeContext*>(userData);
+
+    std::string path;
+    if (type == shaderc_include_type_relative)
+    {
+        const std::string requesting(requestingSource);
+        const size_t separator = requesting.find_last_of("/\\");
+        path = (separator == std::string::npos ? std::string() : requesting.substr(0, separator + 1)) + requestedSource;
+    }
+    else
+    {
+        path = context->SourceFolderPath + requestedSource;
+    }
+
+    IncludeResult* include = new IncludeResult();
+
+    std::vector<char> bytes;
+    if (ReadFileBytes(FromUtf8(path), bytes))
+    {
+        include->SourceName = path;
+        include->Content.assign(bytes.begin(), bytes.end());
+
+        if (std::find(context->Dependencies.begin(), context->Dependencies.end(), path) == context->Dependencies.end())
+        {
+            context->Dependencies.push_back(path);
+        }
+    }
+    else
+    {
+        // an empty source name tells shaderc the content is an error message
+        include->Content = "Can't open include file " + path;
+    }
+
+    include->Result.source_name = include->SourceName.c_str();
+    include->Result.source_name_length = include->SourceName.length();
+    include->Result.content = include->Content.c_str();
+    include->Result.content_length = include->Content.length();
+    include->Result.user_data = include;
+    return &include->Result;
+}
+
+static void ReleaseInclude(void*, shaderc_include_result* result)
+{
+    delete static_cast<IncludeResult*>(result->user_data);
+}
+
+// ============================================================
+// Shader compiler
+// ============================================================
+
+ShaderCompiler::~ShaderCompiler()
+{
+    Shutdown();
+}
+
+#define SHADERC_RESOLVE_FUNCTION_ADDRESS(member, funcName) \
+    { \
+        member = reinterpret_cast<decltype(&funcName)>(Platform::GetSharedLibrarySymbol(_library, ""#funcName)); \
+        if (member == nullptr) \
+        { \
+            Shutdown(); \
+            return false; \
+        } \
+    }
+
+bool ShaderCompiler::Initialize(const std::wstring& sourceFolderPath, const std::wstring& cacheFolderPath)
+{
+    Shutdown();
+
+    _sourceFolderPath = sourceFolderPath;
+    _cacheFolderPath = cacheFolderPath;
+
+    _library = Platform::LoadSharedLibrary("shaderc_shared");
+    if (_library == nullptr)
+    {
+        return false;
+    }
+
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_compilerInitialize, shaderc_compiler_initialize);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_compilerRelease, shaderc_compiler_release);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_optionsInitialize, shaderc_compile_options_initialize);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_optionsRelease, shaderc_compile_options_release);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_optionsAddMacroDefinition, shaderc_compile_options_add_macro_definition);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_optionsSetIncludeCallbacks, shaderc_compile_options_set_include_callbacks);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_compileIntoSpv, shaderc_compile_into_spv);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_resultRelease, shaderc_result_release);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_resultGetLength, shaderc_result_get_length);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_resultGetBytes, shaderc_result_get_bytes);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_resultGetCompilationStatus, shaderc_result_get_compilation_status);
+    SHADERC_RESOLVE_FUNCTION_ADDRESS(_resultGetErrorMessage, shaderc_result_get_error_message);
+
+    _compiler = _compilerInitialize();
+    if (_compiler == nullptr)
+    {
+        Shutdown();
+        return false;
+    }
+
+    Platform::CreateDirectories(_cacheFolderPath);
+    return true;
+}
+
+#undef SHADERC_RESOLVE_FUNCTION_ADDRESS
+
+void ShaderCompiler::Shutdown()
+{
+    if (_compiler)
+    {
+        _compilerRelease(_compiler);
+        _compiler = nullptr;
+    }
+    if (_library)
+    {
+        Platform::FreeSharedLibrary(_library);
+        _library = nullptr;
+    }
+}
+
+bool ShaderCompiler::IsAvailable() const
+{
+    return _compiler != nullptr;
+}
+
+const std::wstring& ShaderCompiler::GetSourceFolderPath() const
+{
+    return _sourceFolderPath;
+}
+
+bool ShaderCompiler::Compile(const std::wstring& fileName, shaderc_shader_kind kind, const std::vector<std::string>& defines,
+    std::vector<uint32_t>& spirv, std::vector<std::wstring>& dependencies, std::string& log)
+{
+    const std::wstring sourcePath = _sourceFolderPath + fileName;
+
+    spirv.clear();
+    dependencies.assign(1, sourcePath);
+    log.clear();
+
+    if (!IsAvailable())
+    {
+        log = "shaderc is not available";
+        return false;
+    }
+
+    std::vector<char> source;
+    if (!ReadFileBytes(sourcePath, source))
+    {
+        log = "Can't open " + ToUtf8(sourcePath);
+        return false;
+    }
+
+    const uint64_t key = ComputeKey(source, kind, defines);
+    const std::wstring cacheFilePath = GetCacheFilePath(key);
+    if (ReadCacheFile(cacheFilePath, key, spirv, dependencies))
+    {
+        return true;
+    }
+
+    IncludeContext context;
+    context.SourceFolderPath = ToUtf8(_sourceFolderPath);
+
+    shaderc_compile_options_t options = _optionsInitialize();
+    _optionsSetIncludeCallbacks(options, ResolveInclude, ReleaseInclude, &context);
+    for (const std::string& define : defines)
+    {
+        const size_t separator = define.find('=');
+        if (separator == std::string::npos)
+        {
+            _optionsAddMacroDefinition(options, define.c_str(), define.length(), nullptr, 0);
+        }
+        else
+        {
+            _optionsAddMacroDefinition(options, define.c_str(), separator, define.c_str() + separator + 1, define.length() - separator - 1);
+        }
+    }
+
+    const std::string sourceName = ToUtf8(sourcePath);
+    shaderc_compilation_result_t result = _compileIntoSpv(_compiler, source.data(), source.size(), kind, sourceName.c_str(), "main", options);
+    _optionsRelease(options);
+
+    for (const std::string& dependency : context.Dependencies)
+    {
+        dependencies.push_back(FromUtf8(dependency));
+    }
+
+    const bool succeeded = result != nullptr && _resultGetCompilationStatus(result) == shaderc_compilation_status_success;
+    if (succeeded)
+    {
+        const size_t size = _resultGetLength(result);
+        spirv.resize(size / sizeof(uint32_t));
+        memcpy(spirv.data(), _resultGetBytes(result), spirv.size() * sizeof(uint32_t));
+    }
+    else
+    {
+        log = result != nullptr ? _resultGetErrorMessage(result) : "shaderc_compile_into_spv failed";
+    }
+
+    if (result != nullptr)
+    {
+        _resultRelease(result);
+    }
+
+    if (succeeded)
+    {
+        WriteCacheFile(cacheFilePath, key, spirv, context.Dependencies);
+    }
+    return succeeded;
+}
+
+uint64_t ShaderCompiler::ComputeKey(const std::vector<char>& source, shaderc_shader_kind kind, const std::vector<std::string>& defines) const
+{
+    uint64_t hash = HashValue(SHADER_CACHE_VERSION);
+    hash = HashValue(static_cast<uint32_t>(kind), hash);
+    for (const std::string& define : defines)
+    {
+        // the terminator keeps {"AB", "C"} and {"A", "BC"} apart
+        hash = HashFNV1a64(define.c_str(), define.length() + 1, hash);
+    }
+    return HashFNV1a64(source.data(), source.size(), hash);
+}
+
+std::wstring ShaderCompiler::GetCacheFilePath(uint64_t key) const
+{
+    wchar_t fileName[32];
+    swprintf(fileName, 32, L"%016llx.spvc", static_cast<unsigned long long>(key));
+    return _cacheFolderPath + fileName;
+}
+
+bool ShaderCompiler::ReadCacheFile(const std::wstring& cacheFilePath, uint64_t key, std::vector<uint32_t>& spirv,
+    std::vector<std::wstring>& dependencies) const
+{
+    MappedFile file;
+    if (!file.Open(cacheFilePath) || file.GetSize() < sizeof(ShaderCacheHeader))
+    {
+        return false;
+    }
+
+    const uint8_t* data = file.GetData();
+    const size_t size = file.GetSize();
+
+    ShaderCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.Magic != SHADER_CACHE_MAGIC || header.Version != SHADER_CACHE_VERSION || header.Key != key ||
+        header.SpirvSize == 0 || header.SpirvSize % sizeof(uint32_t) != 0)
+    {
+        return false;
+    }
+
+    // the key only covers the top level source, includes are checked against their recorded hashes
+    std::vector<std::wstring> includes;
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; i < header.DependencyCount; ++i)
+    {
+        ShaderCacheDependency dependency;
+        if (size - offset < sizeof(dependency))
+        {
+            return false;
+        }
+        memcpy(&dependency, data + offset, sizeof(dependency));
+        offset += sizeof(dependency);
+
+        if (size - offset < dependency.PathLength)
+        {
+            return false;
+        }
+        const std::wstring path = FromUtf8(std::string(reinterpret_cast<const char*>(data + offset), dependency.PathLength));
+        offset += dependency.PathLength;
+
+        std::vector<char> content;
+        if (!ReadFileBytes(path, content) || HashFNV1a64(content.data(), content.size()) != dependency.ContentHash)
+        {
+            return false;
+        }
+        includes.push_back(path);
+    }
+
+    if (size - offset != header.SpirvSize)
+    {
+        return false;
+    }
+
+    spirv.resize(header.SpirvSize / sizeof(uint32_t));
+    memcpy(spirv.data(), data + offset, header.SpirvSize);
+    dependencies.insert(dependencies.end(), includes.begin(), includes.end());
+    return true;
+}
+
+void ShaderCompiler::WriteCacheFile(const std::wstring& cacheFilePath, uint64_t key, const std::vector<uint32_t>& spirv,
+    const std::vector<std::string>& dependencies) const
+{
+    std::vector<uint8_t> blob;
+    auto Append = [&blob](const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        blob.insert(blob.end(), bytes, bytes + size);
+    };
+
+    ShaderCacheHeader header;
+    header.Magic = SHADER_CACHE_MAGIC;
+    header.Version = SHADER_CACHE_VERSION;
+    header.Key = key;
+    header.DependencyCount = static_cast<uint32_t>(dependencies.size());
+    header.SpirvSize = static_cast<uint32_t>(spirv.size() * sizeof(uint32_t));
+    Append(&header, sizeof(header));
+
+    for (const std::string& path : dependencies)
+    {
+        std::vector<char> content;
+        if (!ReadFileBytes(FromUtf8(path), content))
+        {
+            return;
+        }
+
+        ShaderCacheDependency dependency;
+        dependency.ContentHash = HashFNV1a64(content.data(), content.size());
+        dependency.PathLength = static_cast<uint32_t>(path.length());
+        dependency.Reserved = 0;
+        Append(&dependency, sizeof(dependency));
+        Append(path.c_str(), path.length());
+    }
+
+    Append(spirv.data(), header.SpirvSize);
+
+    // several processes may compile the same shader at once, the helper keeps their files apart
+    Platform::WriteFileAtomically(cacheFilePath, [&](FILE* file)
+    {
+        return fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    });
+}
+
+// ============================================================
+// Shader watcher
+// ============================================================
+
+void ShaderWatcher::Clear()
+{
+    _files.clear();
+}
+
+void ShaderWatcher::Watch(const std::wstring& filePath)
+{
+    for (const WatchedFile& file : _files)
+    {
+        if (file.Path == filePath)
+        {
+            return;
+        }
+    }
+    _files.push_back({ filePath, Platform::GetFileWriteTime(filePath) });
+}
+
+void ShaderWatcher::Watch(const std::vector<std::wstring>& filePaths)
+{
+    for (const std::wstring& filePath : filePaths)
+    {
+        Watch(filePath);
+    }
+}
+
+bool ShaderWatcher::CheckForChanges()
+{
+    bool changed = false;
+    for (WatchedFile& file : _files)
+    {
+        const uint64_t writeTime = Platform::GetFileWriteTime(file.Path);
+        // a missing file reads as 0, editors that save through a temp file briefly hit that
+        if (writeTime != 0 && writeTime != file.WriteTime)
+        {
+            file.WriteTime = writeTime;
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Application.h"
+
+// the ray tracing shader kinds are only declared for NV enabled builds of shaderc
+#ifndef NV_EXTENSIONS
+#define NV_EXTENSIONS
+#endif
+#include "shaderc/shaderc.h"
+
+// In-process GLSL to SPIR-V compiler on top of the shaderc_shared library. It is loaded
+// at runtime so the application still starts from the precompiled .bin files when the
+// Vulkan SDK is not installed. Results are cached on disk keyed by the source hash and
+// the defines, and every included file is recorded so edits to shared headers are seen.
+class ShaderCompiler
+{
+private:
+    void* _library = nullptr;
+    shaderc_compiler_t _compiler = nullptr;
+    std::wstring _sourceFolderPath;
+    std::wstring _cacheFolderPath;
+
+    decltype(&shaderc_compiler_initialize) _compilerInitialize = nullptr;
+    decltype(&shaderc_compiler_release) _compilerRelease = nullptr;
+    decltype(&shaderc_compile_options_initialize) _optionsInitialize = nullptr;
+    decltype(&shaderc_compile_options_release) _optionsRelease = nullptr;
+    decltype(&shaderc_compile_options_add_macro_definition) _optionsAddMacroDefinition = nullptr;
+    decltype(&shaderc_compile_options_set_include_callbacks) _optionsSetIncludeCallbacks = nullptr;
+    decltype(&shaderc_compile_into_spv) _compileIntoSpv = nullptr;
+    decltype(&shaderc_result_release) _resultRelease = nullptr;
+    decltype(&shaderc_result_get_length) _resultGetLength = nullptr;
+    decltype(&shaderc_result_get_bytes) _resultGetBytes = nullptr;
+    decltype(&shaderc_result_get_compilation_status) _resultGetCompilationStatus = nullptr;
+    decltype(&shaderc_result_get_error_message) _resultGetErrorMessage = nullptr;
+
+public:
+    ShaderCompiler() = default;
+    ShaderCompiler(const ShaderCompiler&) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+    ~ShaderCompiler();
+
+public:
+    // Returns false if shaderc_shared can't be loaded, callers fall back to .bin files
+    bool Initialize(const std::wstring& sourceFolderPath, const std::wstring& cacheFolderPath);
+    void Shutdown();
+    bool IsAvailable() const;
+
+    // dependencies receives the source file and every file it includes, log receives compiler errors
+    bool Compile(const std::wstring& fileName, shaderc_shader_kind kind, const std::vector<std::string>& defines,
+        std::vector<uint32_t>& spirv, std::vector<std::wstring>& dependencies, std::string& log);
+
+    const std::wstring& GetSourceFolderPath() const;
+
+private:
+    uint64_t ComputeKey(const std::vector<char>& source, shaderc_shader_kind kind, const std::vector<std::string>& defines) const;
+    std::wstring GetCacheFilePath(uint64_t key) const;
+    bool ReadCacheFile(const std::wstring& cacheFilePath, uint64_t key, std::vector<uint32_t>& spirv, std::vector<std::wstring>& dependencies) const;
+    void WriteCacheFile(const std::wstring& cacheFilePath, uint64_t key, const std::vector<uint32_t>& spirv, const std::vector<std::string>& dependencies) const;
+};
+
+// Polls the last write time of a set of files, cheap enough to call once in a while from the frame loop
+class ShaderWatcher
+{
+private:
+    struct WatchedFile
+    {
+        std::wstring Path;
+        uint64_t WriteTime;
+    };
+
+    std::vector<WatchedFile> _files;
+
+public:
+    void Clear();
+    void Watch(const std::wstring& filePath);
+    void Watch(const std::vector<std::wstring>& filePaths);
+
+    // Returns true if any watched file changed since the last call
+    bool CheckForChanges();
+};
@@ -0,0 +1,277 @@
+#include "Socket.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+static const uintptr_t SOCKET_INVALID_HANDLE = static_cast<uintptr_t>(INVALID_SOCKET);
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+static const int SOCKET_INVALID_HANDLE = -1;
+#endif
+
+// the largest piece handed to a single send or recv, Winsock takes an int
+static const size_t SOCKET_MAX_TRANSFER = 1 << 30;
+
+static bool InitializeSockets()
+{
+#ifdef _WIN32
+    // never cleaned up, the sockets live until the process ends
+    static bool initialized = false;
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        WSADATA data;
+        initialized = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    });
+    return initialized;
+#else
+    return true;
+#endif
+}
+
+static bool MakeAddress(const std::string& address, uint16_t port, sockaddr_in& result)
+{
+    memset(&result, 0, sizeof(result));
+    result.sin_family = AF_INET;
+    result.sin_port = htons(port);
+    if (address.empty())
+    {
+        result.sin_addr.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+    return inet_pton(AF_INET, address == "localhost" ? "127.0.0.1" : address.c_str(), &result.sin_addr) == 1;
+}
+
+Socket::Socket()
+    : _handle(SOCKET_INVALID_HANDLE)
+{
+}
+
+Socket::Socket(Socket&& other)
+    : _handle(SOCKET_INVALID_HANDLE)
+{
+    std::swap(_handle, other._handle);
+}
+
+Socket& Socket::operator=(Socket&& other)
+{
+    if (this != &other)
+    {
+        Close();
+        std::swap(_handle, other._handle);
+    }
+    return *this;
+}
+
+Socket::~Socket()
+{
+    Close();
+}
+
+bool Socket::Listen(const std::string& address, uint16_t port)
+{
+    Close();
+
+    sockaddr_in socketAddress;
+    if (!InitializeSockets() || !MakeAddress(address, port, socketAddress))
+    {
+        return false;
+    }
+
+    _handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_handle == SOCKET_INVALID_HANDLE)
+    {
+        return false;
+    }
+
+    // a coordinator restarted right away finds its port still in TIME_WAIT otherwise
+    const int reuse = 1;
+    setsockopt(_handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    if (bind(_handle, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0 || listen(_handle, SOMAXCONN) != 0)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool Socket::Accept(Socket& connection, uint32_t timeoutMs)
+{
+    connection.Close();
+    if (!IsOpen() || !WaitReadable(timeoutMs))
+    {
+        return false;
+    }
+
+    connection._handle = accept(_handle, nullptr, nullptr);
+    if (connection._handle == SOCKET_INVALID_HANDLE)
+    {
+        return false;
+    }
+
+    // messages are written header first, waiting for more to coalesce only adds latency
+    const int noDelay = 1;
+    setsockopt(connection._handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    return true;
+}
+
+bool Socket::Connect(const std::string& address, uint16_t port)
+{
+    Close();
+
+    sockaddr_in socketAddress;
+    if (!InitializeSockets() || address.empty() || !MakeAddress(address, port, socketAddress))
+    {
+        return false;
+    }
+
+    _handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (_handle == SOCKET_INVALID_HANDLE)
+    {
+        return false;
+    }
+
+    if (connect(_handle, reinterpret_cast<const sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    const int noDelay = 1;
+    setsockopt(_handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    return true;
+}
+
+void Socket::Close()
+{
+    if (_handle != SOCKET_INVALID_HANDLE)
+    {
+#ifdef _WIN32
+        closesocket(_handle);
+#else
+        close(_handle);
+#endif
+        _handle = SOCKET_INVALID_HANDLE;
+    }
+}
+
+bool Socket::IsOpen() const
+{
+    return _handle != SOCKET_INVALID_HANDLE;
+}
+
+uint16_t Socket::GetLocalPort() const
+{
+    sockaddr_in socketAddress;
+    socklen_t length = sizeof(socketAddress);
+    if (!IsOpen() || getsockname(_handle, reinterpret_cast<sockaddr*>(&socketAddress), &length) != 0)
+    {
+        return 0;
+    }
+    return ntohs(socketAddress.sin_port);
+}
+
+bool Socket::Send(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0 && IsOpen())
+    {
+#ifdef _WIN32
+        const int sent = send(_handle, bytes, static_cast<int>(std::min(size, SOCKET_MAX_TRANSFER)), 0);
+#else
+        // a peer that went away is an error here, not a SIGPIPE
+        const ssize_t sent = send(_handle, bytes, std::min(size, SOCKET_MAX_TRANSFER), MSG_NOSIGNAL);
+#endif
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return size == 0;
+}
+
+bool Socket::Receive(void* data, size_t size, uint32_t timeoutMs)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+
+    char* bytes = static_cast<char*>(data);
+    while (size > 0 && IsOpen())
+    {
+        if (timeoutMs != NoTimeout)
+        {
+            const int64_t remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (!WaitReadable(static_cast<uint32_t>(std::max<int64_t>(remainingMs, 0))))
+            {
+                return false;
+            }
+        }
+
+#ifdef _WIN32
+        const int received = recv(_handle, bytes, static_cast<int>(std::min(size, SOCKET_MAX_TRANSFER)), 0);
+#else
+        const ssize_t received = recv(_handle, bytes, std::min(size, SOCKET_MAX_TRANSFER), 0);
+#endif
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return size == 0;
+}
+
+bool Socket::WaitReadable(uint32_t timeoutMs) const
+{
+    if (timeoutMs == NoTimeout)
+    {
+        return true;
+    }
+
+    // an interrupted wait starts over with what is left of the time
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;)
+    {
+        const int64_t remainingMs = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count(), 0);
+#ifdef _WIN32
+        WSAPOLLFD descriptor = { };
+        descriptor.fd = static_cast<SOCKET>(_handle);
+        descriptor.events = POLLRDNORM;
+        return WSAPoll(&descriptor, 1, static_cast<INT>(remainingMs)) > 0;
+#else
+        pollfd descriptor = { };
+        descriptor.fd = _handle;
+        descriptor.events = POLLIN;
+        const int ready = poll(&descriptor, 1, static_cast<int>(remainingMs));
+        if (ready >= 0)
+        {
+            // a hang up or error is readable too, the recv or accept after it reports the failure
+            return ready > 0;
+        }
+        if (errno != EINTR)
+        {
+            return false;
+        }
+#endif
+    }
+}
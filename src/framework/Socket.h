@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Blocking TCP stream, IPv4 only. Enough to move messages between processes on one machine
+// or a few on the same network, there is no encryption and no authentication.
+class Socket
+{
+private:
+#ifdef _WIN32
+    uintptr_t _handle;
+#else
+    int _handle;
+#endif
+
+public:
+    // for the timeouts below, wait as long as it takes
+    static const uint32_t NoTimeout = 0xFFFFFFFFu;
+
+public:
+    Socket();
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    Socket(Socket&& other);
+    Socket& operator=(Socket&& other);
+    ~Socket();
+
+public:
+    // Port 0 picks a free one, see GetLocalPort. An empty address listens on every interface.
+    bool Listen(const std::string& address, uint16_t port);
+    // Waits for the next connection to a listening socket, false when none came in time
+    bool Accept(Socket& connection, uint32_t timeoutMs = NoTimeout);
+    bool Connect(const std::string& address, uint16_t port);
+    void Close();
+
+    bool IsOpen() const;
+    uint16_t GetLocalPort() const;
+
+    // All of the bytes or false, a closed connection is a failure too. The receive timeout
+    // covers all of the bytes, not each piece of them.
+    bool Send(const void* data, size_t size);
+    bool Receive(void* data, size_t size, uint32_t timeoutMs = NoTimeout);
+
+private:
+    // true once there is something to accept or read, false when the time ran out or on an error
+    bool WaitReadable(uint32_t timeoutMs) const;
+};
@@ -0,0 +1,146 @@
+#include "StartupReport.h"
+
+#ifdef _WIN32
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+#include <iomanip>
+
+static const double STARTUP_REPORT_MEGABYTE = 1024.0 * 1024.0;
+
+void StartupReport::BeginPhase(const std::string& name)
+{
+    Phase phase;
+    phase.Name = name;
+    phase.Depth = static_cast<uint32_t>(_openPhases.size());
+    _phases.push_back(phase);
+
+    OpenPhase openPhase;
+    openPhase.Index = _phases.size() - 1;
+    openPhase.HostMemory = GetHostMemoryUsage();
+    openPhase.DeviceMemory = ResourceBase::GetAllocatedMemorySize();
+    // taken last so the memory queries don't count towards the phase
+    openPhase.Start = std::chrono::high_resolution_clock::now();
+    _openPhases.push_back(openPhase);
+}
+
+void StartupReport::EndPhase()
+{
+    const auto end = std::chrono::high_resolution_clock::now();
+    if (_openPhases.empty())
+    {
+        return;
+    }
+
+    const OpenPhase openPhase = _openPhases.back();
+    _openPhases.pop_back();
+
+    Phase& phase = _phases[openPhase.Index];
+    phase.WallTime = std::chrono::duration<double, std::milli>(end - openPhase.Start).count();
+    phase.HostMemoryDelta = static_cast<int64_t>(GetHostMemoryUsage()) - static_cast<int64_t>(openPhase.HostMemory);
+    phase.HostMemoryPeak = GetHostMemoryPeak();
+    phase.DeviceMemoryDelta = static_cast<int64_t>(ResourceBase::GetAllocatedMemorySize()) - static_cast<int64_t>(openPhase.DeviceMemory);
+    phase.DeviceMemoryPeak = ResourceBase::GetAllocatedMemoryPeak();
+}
+
+const std::vector<StartupReport::Phase>& StartupReport::GetPhases() const
+{
+    return _phases;
+}
+
+void StartupReport::Print() const
+{
+    std::cout << "Startup (ms, MB):\n"
+        << "  " << std::left << std::setw(36) << "phase" << std::right
+        << std::setw(10) << "time" << std::setw(12) << "host +" << std::setw(12) << "host peak"
+        << std::setw(12) << "device +" << std::setw(12) << "device peak" << "\n";
+
+    std::cout << std::fixed;
+    for (const Phase& phase : _phases)
+    {
+        const std::string name = std::string(phase.Depth * 2, ' ') + phase.Name;
+        std::cout << "  " << std::left << std::setw(36) << name << std::right << std::setprecision(2)
+            << std::setw(10) << phase.WallTime
+            << std::setprecision(1)
+            << std::setw(12) << phase.HostMemoryDelta / STARTUP_REPORT_MEGABYTE
+            << std::setw(12) << phase.HostMemoryPeak / STARTUP_REPORT_MEGABYTE
+            << std::setw(12) << phase.DeviceMemoryDelta / STARTUP_REPORT_MEGABYTE
+            << std::setw(12) << phase.DeviceMemoryPeak / STARTUP_REPORT_MEGABYTE << "\n";
+    }
+}
+
+bool StartupReport::WriteJson(const std::wstring& filePath) const
+{
+    std::ofstream file(Platform::ToNativePath(filePath), std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    // flat list in begin order, depth gives the nesting; memory in bytes
+    file << std::fixed << std::setprecision(3) << "{\"phases\":[";
+    for (size_t i = 0; i < _phases.size(); ++i)
+    {
+        const Phase& phase = _phases[i];
+        file << (i ? ",\n" : "\n")
+            << "{\"name\":\"" << phase.Name << "\",\"depth\":" << phase.Depth << ",\"wall_ms\":" << phase.WallTime
+            << ",\"host_delta\":" << phase.HostMemoryDelta << ",\"host_peak\":" << phase.HostMemoryPeak
+            << ",\"device_delta\":" << phase.DeviceMemoryDelta << ",\"device_peak\":" << phase.DeviceMemoryPeak << "}";
+    }
+    file << "\n]}\n";
+
+    file.close();
+    return !file.fail();
+}
+
+#ifdef _WIN32
+
+uint64_t StartupReport::GetHostMemoryUsage()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(counters.WorkingSetSize);
+}
+
+uint64_t StartupReport::GetHostMemoryPeak()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+}
+
+#else
+
+// resident set and its high-water mark, in kB in /proc/self/status
+static uint64_t ReadProcStatus(const std::string& field)
+{
+    std::ifstream file("/proc/self/status");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, field.length(), field) == 0)
+        {
+            return std::stoull(line.substr(field.length())) * 1024;
+        }
+    }
+    return 0;
+}
+
+uint64_t StartupReport::GetHostMemoryUsage()
+{
+    return ReadProcStatus("VmRSS:");
+}
+
+uint64_t StartupReport::GetHostMemoryPeak()
+{
+    return ReadProcStatus("VmHWM:");
+}
+
+#endif
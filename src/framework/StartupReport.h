@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Application.h"
+
+#include <chrono>
+
+// Records the wall time, host working set and device memory of every startup phase.
+// Phases nest, a phase begun while another one is open becomes its child. Device memory
+// is what went through ResourceBase::AllocateMemory, driver owned allocations such as the
+// swapchain images don't show up.
+class StartupReport
+{
+public:
+    struct Phase
+    {
+        std::string Name;
+        uint32_t Depth = 0;
+        double WallTime = 0.0;              // milliseconds
+        int64_t HostMemoryDelta = 0;        // working set, bytes
+        uint64_t HostMemoryPeak = 0;        // peak working set when the phase ended
+        int64_t DeviceMemoryDelta = 0;      // bytes
+        uint64_t DeviceMemoryPeak = 0;      // device high-water mark when the phase ended
+    };
+
+private:
+    struct OpenPhase
+    {
+        size_t Index;
+        std::chrono::high_resolution_clock::time_point Start;
+        uint64_t HostMemory;
+        uint64_t DeviceMemory;
+    };
+
+    std::vector<Phase> _phases;
+    std::vector<OpenPhase> _openPhases;
+
+public:
+    void BeginPhase(const std::string& name);
+    void EndPhase();
+
+    const std::vector<Phase>& GetPhases() const;
+    void Print() const;
+    bool WriteJson(const std::wstring& filePath) const;
+
+    // working set of the process in bytes
+    static uint64_t GetHostMemoryUsage();
+    static uint64_t GetHostMemoryPeak();
+};
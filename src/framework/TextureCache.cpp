@@ -0,0 +1,630 @@
+#include "TextureCache.h"
+#include "Hash.h"
+#include "stb/stb_image.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <cwchar>
+#include <iomanip>
+
+// .vktex layout: header, level table, then the levels, each starting on a 16 byte boundary
+static const uint32_t TEXTURE_CACHE_MAGIC = 0x58544B56; // "VKTX"
+static const uint32_t TEXTURE_CACHE_VERSION = 1;
+static const uint32_t TEXTURE_CACHE_MAX_LEVELS = 16;
+static const size_t TEXTURE_CACHE_DATA_ALIGNMENT = 16;
+
+static const uint32_t TEXTURE_CACHE_FLAG_MIPS = 1;
+static const uint32_t TEXTURE_CACHE_FLAG_BC = 2;
+
+struct TextureCacheHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Key;
+    uint32_t Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t BlockHeight;
+    uint32_t LevelCount;
+    uint32_t Reserved;
+};
+
+struct TextureCacheLevelEntry
+{
+    uint64_t Offset;
+    uint64_t Size;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t RowPitch;
+    uint32_t RowCount;
+};
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static size_t GetLevelTableEnd(uint32_t levelCount)
+{
+    return AlignUp(sizeof(TextureCacheHeader) + levelCount * sizeof(TextureCacheLevelEntry), TEXTURE_CACHE_DATA_ALIGNMENT);
+}
+
+// rows are texel rows for plain formats and 4x4 block rows for BC1, false for formats the cache doesn't store
+static bool GetLevelLayout(VkFormat format, uint32_t width, uint32_t height, VkDeviceSize& rowPitch, uint32_t& rowCount)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        rowPitch = static_cast<VkDeviceSize>((width + 3) / 4) * 8;
+        rowCount = (height + 3) / 4;
+        return true;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        rowPitch = static_cast<VkDeviceSize>(width) * sizeof(uint8_t[4]);
+        rowCount = height;
+        return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        rowPitch = static_cast<VkDeviceSize>(width) * sizeof(float[4]);
+        rowCount = height;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// ============================================================
+// Transcoding
+// ============================================================
+
+static float SrgbToLinear(uint8_t value)
+{
+    // textures are decoded on several threads, a local static is initialized exactly once
+    static const std::array<float, 256> table = []()
+    {
+        std::array<float, 256> values;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            const float c = i / 255.0f;
+            values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return values;
+    }();
+    return table[value];
+}
+
+static uint8_t LinearToSrgb(float value)
+{
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    const float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(c * 255.0f + 0.5f);
+}
+
+// 2x2 box filter, odd edges reuse the last row/column
+static void DownsampleBox(const std::vector<float>& src, uint32_t srcWidth, uint32_t srcHeight,
+    std::vector<float>& dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+    dst.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+
+    for (uint32_t y = 0; y < dstHeight; ++y)
+    {
+        const size_t y0 = std::min(y * 2, srcHeight - 1);
+        const size_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+        for (uint32_t x = 0; x < dstWidth; ++x)
+        {
+            const size_t x0 = std::min(x * 2, srcWidth - 1);
+            const size_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+            const float* t00 = &src[(y0 * srcWidth + x0) * 4];
+            const float* t01 = &src[(y0 * srcWidth + x1) * 4];
+            const float* t10 = &src[(y1 * srcWidth + x0) * 4];
+            const float* t11 = &src[(y1 * srcWidth + x1) * 4];
+            float* out = &dst[(static_cast<size_t>(y) * dstWidth + x) * 4];
+
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                out[c] = (t00[c] + t01[c] + t10[c] + t11[c]) * 0.25f;
+            }
+        }
+    }
+}
+
+static uint16_t PackRGB565(const uint8_t* color)
+{
+    return static_cast<uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static void UnpackRGB565(uint16_t value, int32_t* color)
+{
+    const int32_t r = (value >> 11) & 31;
+    const int32_t g = (value >> 5) & 63;
+    const int32_t b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Bounding box fit: endpoints are the (slightly inset) min/max corners of the block colors
+static void EncodeBC1Block(const uint8_t texels[16][4], uint8_t* output)
+{
+    uint8_t minColor[3] = { 255, 255, 255 };
+    uint8_t maxColor[3] = { 0, 0, 0 };
+
+    for (uint32_t i = 0; i < 16; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            minColor[c] = std::min(minColor[c], texels[i][c]);
+            maxColor[c] = std::max(maxColor[c], texels[i][c]);
+        }
+    }
+
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        const uint8_t inset = static_cast<uint8_t>((maxColor[c] - minColor[c]) >> 4);
+        minColor[c] = static_cast<uint8_t>(minColor[c] + inset);
+        maxColor[c] = static_cast<uint8_t>(maxColor[c] - inset);
+    }
+
+    uint16_t color0 = PackRGB565(maxColor);
+    uint16_t color1 = PackRGB565(minColor);
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        // color0 > color1 selects the four color mode
+        int32_t palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t best = 0;
+            int32_t bestDistance = INT32_MAX;
+            for (uint32_t p = 0; p < 4; ++p)
+            {
+                const int32_t dr = texels[i][0] - palette[p][0];
+                const int32_t dg = texels[i][1] - palette[p][1];
+                const int32_t db = texels[i][2] - palette[p][2];
+                const int32_t distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    output[0] = static_cast<uint8_t>(color0 & 0xFF);
+    output[1] = static_cast<uint8_t>(color0 >> 8);
+    output[2] = static_cast<uint8_t>(color1 & 0xFF);
+    output[3] = static_cast<uint8_t>(color1 >> 8);
+    output[4] = static_cast<uint8_t>(indices & 0xFF);
+    output[5] = static_cast<uint8_t>((indices >> 8) & 0xFF);
+    output[6] = static_cast<uint8_t>((indices >> 16) & 0xFF);
+    output[7] = static_cast<uint8_t>(indices >> 24);
+}
+
+static void EncodeBC1(const uint8_t* texels, uint32_t width, uint32_t height, const TextureLevel& level)
+{
+    uint8_t* output = const_cast<uint8_t*>(level.Data);
+
+    for (uint32_t blockY = 0; blockY < level.RowCount; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < level.RowPitch / 8; ++blockX)
+        {
+            uint8_t block[16][4];
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                const size_t x = std::min(blockX * 4 + (i & 3), width - 1);
+                const size_t y = std::min(blockY * 4 + (i >> 2), height - 1);
+                memcpy(block[i], texels + (y * width + x) * 4, 4);
+            }
+            EncodeBC1Block(block, output + blockY * level.RowPitch + blockX * 8);
+        }
+    }
+}
+
+static bool DecodeFromMemory(const uint8_t* source, size_t sourceSize, bool generateMips, bool blockCompression, TextureData& data)
+{
+    data.Reset();
+
+    const int sourceLength = static_cast<int>(sourceSize);
+    const bool textureHDR = stbi_is_hdr_from_memory(source, sourceLength) != 0;
+
+    int32_t textureWidth;
+    int32_t textureHeight;
+    int32_t textureChannels;
+    void* pixelData = nullptr;
+
+    if (textureHDR)
+    {
+        pixelData = stbi_loadf_from_memory(source, sourceLength, &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha);
+    }
+    else
+    {
+        pixelData = stbi_load_from_memory(source, sourceLength, &textureWidth, &textureHeight, &textureChannels, STBI_rgb_alpha);
+    }
+
+    if (!pixelData)
+    {
+        return false;
+    }
+
+    const size_t texelCount = static_cast<size_t>(textureWidth) * textureHeight;
+
+    // BC1 has no alpha worth keeping, so only opaque LDR textures are compressed
+    bool compress = false;
+    if (blockCompression && !textureHDR)
+    {
+        const uint8_t* texels = static_cast<const uint8_t*>(pixelData);
+        compress = true;
+        for (size_t i = 0; i < texelCount && compress; ++i)
+        {
+            compress = texels[i * 4 + 3] == 255;
+        }
+    }
+
+    data.Width = static_cast<uint32_t>(textureWidth);
+    data.Height = static_cast<uint32_t>(textureHeight);
+    data.BlockHeight = compress ? 4 : 1;
+    data.Format = textureHDR ? VK_FORMAT_R32G32B32A32_SFLOAT : (compress ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_R8G8B8A8_SRGB);
+
+    uint32_t levelCount = 1;
+    if (generateMips)
+    {
+        while ((std::max(data.Width, data.Height) >> levelCount) > 0 && levelCount < TEXTURE_CACHE_MAX_LEVELS)
+        {
+            ++levelCount;
+        }
+    }
+
+    std::vector<size_t> offsets(levelCount);
+    size_t storageSize = 0;
+
+    data.Levels.resize(levelCount);
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        TextureLevel& level = data.Levels[i];
+        level.Width = std::max(data.Width >> i, 1u);
+        level.Height = std::max(data.Height >> i, 1u);
+        GetLevelLayout(data.Format, level.Width, level.Height, level.RowPitch, level.RowCount);
+
+        offsets[i] = AlignUp(storageSize, TEXTURE_CACHE_DATA_ALIGNMENT);
+        storageSize = offsets[i] + static_cast<size_t>(level.RowPitch * level.RowCount);
+    }
+
+    data.Storage.resize(storageSize);
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        data.Levels[i].Data = data.Storage.data() + offsets[i];
+    }
+
+    // mips are filtered in linear space, the current level is kept as linear RGBA floats
+    std::vector<float> linear;
+    std::vector<float> nextLinear;
+    std::vector<uint8_t> texels;
+
+    if (textureHDR)
+    {
+        const float* pixels = static_cast<const float*>(pixelData);
+        linear.assign(pixels, pixels + texelCount * 4);
+    }
+    else
+    {
+        const uint8_t* pixels = static_cast<const uint8_t*>(pixelData);
+        texels.assign(pixels, pixels + texelCount * 4);
+        if (levelCount > 1)
+        {
+            linear.resize(texelCount * 4);
+            for (size_t i = 0; i < texelCount; ++i)
+            {
+                linear[i * 4 + 0] = SrgbToLinear(pixels[i * 4 + 0]);
+                linear[i * 4 + 1] = SrgbToLinear(pixels[i * 4 + 1]);
+                linear[i * 4 + 2] = SrgbToLinear(pixels[i * 4 + 2]);
+                linear[i * 4 + 3] = pixels[i * 4 + 3] / 255.0f;
+            }
+        }
+    }
+
+    stbi_image_free(pixelData);
+
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        const TextureLevel& level = data.Levels[i];
+
+        if (i > 0)
+        {
+            const TextureLevel& previous = data.Levels[i - 1];
+            DownsampleBox(linear, previous.Width, previous.Height, nextLinear, level.Width, level.Height);
+            linear.swap(nextLinear);
+
+            if (!textureHDR)
+            {
+                const size_t levelTexels = static_cast<size_t>(level.Width) * level.Height;
+                texels.resize(levelTexels * 4);
+                for (size_t t = 0; t < levelTexels; ++t)
+                {
+                    texels[t * 4 + 0] = LinearToSrgb(linear[t * 4 + 0]);
+                    texels[t * 4 + 1] = LinearToSrgb(linear[t * 4 + 1]);
+                    texels[t * 4 + 2] = LinearToSrgb(linear[t * 4 + 2]);
+                    texels[t * 4 + 3] = static_cast<uint8_t>(std::min(std::max(linear[t * 4 + 3], 0.0f), 1.0f) * 255.0f + 0.5f);
+                }
+            }
+        }
+
+        uint8_t* output = const_cast<uint8_t*>(level.Data);
+        if (textureHDR)
+        {
+            memcpy(output, linear.data(), static_cast<size_t>(level.RowPitch * level.RowCount));
+        }
+        else if (compress)
+        {
+            EncodeBC1(texels.data(), level.Width, level.Height, level);
+        }
+        else
+        {
+            memcpy(output, texels.data(), static_cast<size_t>(level.RowPitch * level.RowCount));
+        }
+    }
+
+    return true;
+}
+
+// ============================================================
+// TextureData
+// ============================================================
+
+void TextureData::Reset()
+{
+    Format = VK_FORMAT_UNDEFINED;
+    Width = 0;
+    Height = 0;
+    BlockHeight = 1;
+    Levels.clear();
+    Storage.clear();
+    Storage.shrink_to_fit();
+    Mapping.Close();
+}
+
+// ============================================================
+// TextureCache
+// ============================================================
+
+void TextureCache::SetFolderPath(const std::wstring& folderPath)
+{
+    _folderPath = folderPath;
+    if (!_folderPath.empty())
+    {
+        Platform::CreateDirectories(_folderPath);
+    }
+}
+
+void TextureCache::SetGenerateMips(bool generateMips)
+{
+    _generateMips = generateMips;
+}
+
+void TextureCache::SetBlockCompression(bool blockCompression)
+{
+    _blockCompression = blockCompression;
+}
+
+bool TextureCache::Load(const std::wstring& filePath, TextureData& data)
+{
+    data.Reset();
+
+    MappedFile source;
+    if (!source.Open(filePath))
+    {
+        ++_stats.Failures;
+        return false;
+    }
+    _stats.SourceBytesRead += source.GetSize();
+
+    const uint64_t key = ComputeKey(source.GetData(), source.GetSize());
+    const std::wstring cacheFilePath = GetCacheFilePath(key);
+
+    if (!_folderPath.empty() && ReadCacheFile(cacheFilePath, key, data))
+    {
+        ++_stats.Hits;
+        return true;
+    }
+
+    ++_stats.Misses;
+
+    if (!DecodeFromMemory(source.GetData(), source.GetSize(), _generateMips, _blockCompression, data))
+    {
+        ++_stats.Failures;
+        return false;
+    }
+
+    if (!_folderPath.empty() && !WriteCacheFile(cacheFilePath, key, data))
+    {
+        LogError(L"TextureCache: can't write " + cacheFilePath, true);
+    }
+
+    return true;
+}
+
+const TextureCache::Stats& TextureCache::GetStats() const
+{
+    return _stats;
+}
+
+void TextureCache::PrintStats() const
+{
+    const double megabyte = 1024.0 * 1024.0;
+
+    std::cout << std::fixed << std::setprecision(1) << "Texture cache (MB):\n"
+        << "  " << std::left << std::setw(24) << "hits" << std::right << std::setw(9) << _stats.Hits << "\n"
+        << "  " << std::left << std::setw(24) << "misses" << std::right << std::setw(9) << _stats.Misses << "\n"
+        << "  " << std::left << std::setw(24) << "failures" << std::right << std::setw(9) << _stats.Failures << "\n"
+        << "  " << std::left << std::setw(24) << "source read" << std::right << std::setw(9) << _stats.SourceBytesRead / megabyte << "\n"
+        << "  " << std::left << std::setw(24) << "cache read" << std::right << std::setw(9) << _stats.CacheBytesRead / megabyte << "\n"
+        << "  " << std::left << std::setw(24) << "cache written" << std::right << std::setw(9) << _stats.CacheBytesWritten / megabyte << "\n";
+}
+
+bool TextureCache::Decode(const std::wstring& filePath, TextureData& data, bool generateMips, bool blockCompression)
+{
+    MappedFile source;
+    if (!source.Open(filePath))
+    {
+        data.Reset();
+        return false;
+    }
+
+    return DecodeFromMemory(source.GetData(), source.GetSize(), generateMips, blockCompression, data);
+}
+
+uint64_t TextureCache::ComputeKey(const uint8_t* source, size_t sourceSize) const
+{
+    const uint32_t flags = (_generateMips ? TEXTURE_CACHE_FLAG_MIPS : 0) | (_blockCompression ? TEXTURE_CACHE_FLAG_BC : 0);
+
+    uint64_t hash = HashValue(TEXTURE_CACHE_VERSION);
+    hash = HashValue(flags, hash);
+    return HashFNV1a64(source, sourceSize, hash);
+}
+
+std::wstring TextureCache::GetCacheFilePath(uint64_t key) const
+{
+    wchar_t fileName[32];
+    swprintf(fileName, 32, L"%016llx.vktex", static_cast<unsigned long long>(key));
+    return _folderPath + fileName;
+}
+
+bool TextureCache::ReadCacheFile(const std::wstring& cacheFilePath, uint64_t key, TextureData& data)
+{
+    if (!data.Mapping.Open(cacheFilePath))
+    {
+        return false;
+    }
+
+    const uint8_t* bytes = data.Mapping.GetData();
+    const size_t size = data.Mapping.GetSize();
+
+    // anything that doesn't validate is treated as a miss and overwritten
+    TextureCacheHeader header;
+    if (size < sizeof(header))
+    {
+        data.Reset();
+        return false;
+    }
+    memcpy(&header, bytes, sizeof(header));
+
+    const VkFormat format = static_cast<VkFormat>(header.Format);
+    const uint32_t blockHeight = (format == VK_FORMAT_BC1_RGB_SRGB_BLOCK) ? 4 : 1;
+    VkDeviceSize rowPitch = 0;
+    uint32_t rowCount = 0;
+    const bool knownFormat = GetLevelLayout(format, header.Width, header.Height, rowPitch, rowCount);
+
+    if (header.Magic != TEXTURE_CACHE_MAGIC || header.Version != TEXTURE_CACHE_VERSION || header.Key != key || !knownFormat ||
+        header.Width == 0 || header.Height == 0 || header.BlockHeight != blockHeight ||
+        header.LevelCount == 0 || header.LevelCount > TEXTURE_CACHE_MAX_LEVELS || size < GetLevelTableEnd(header.LevelCount))
+    {
+        data.Reset();
+        return false;
+    }
+
+    data.Format = format;
+    data.Width = header.Width;
+    data.Height = header.Height;
+    data.BlockHeight = header.BlockHeight;
+    data.Levels.resize(header.LevelCount);
+
+    for (uint32_t i = 0; i < header.LevelCount; ++i)
+    {
+        TextureCacheLevelEntry entry;
+        memcpy(&entry, bytes + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+        // the level has to be the size the format and the mip chain give it, the upload trusts these
+        const uint32_t width = std::max(header.Width >> i, 1u);
+        const uint32_t height = std::max(header.Height >> i, 1u);
+        GetLevelLayout(format, width, height, rowPitch, rowCount);
+
+        if (entry.Width != width || entry.Height != height || entry.RowPitch != rowPitch || entry.RowCount != rowCount ||
+            entry.Offset % TEXTURE_CACHE_DATA_ALIGNMENT != 0 || entry.Offset > size || entry.Size > size - entry.Offset ||
+            entry.Size != rowPitch * rowCount)
+        {
+            data.Reset();
+            return false;
+        }
+
+        TextureLevel& level = data.Levels[i];
+        level.Data = bytes + entry.Offset;
+        level.RowPitch = entry.RowPitch;
+        level.RowCount = entry.RowCount;
+        level.Width = entry.Width;
+        level.Height = entry.Height;
+    }
+
+    _stats.CacheBytesRead += size;
+    return true;
+}
+
+bool TextureCache::WriteCacheFile(const std::wstring& cacheFilePath, uint64_t key, const TextureData& data)
+{
+    const uint32_t levelCount = static_cast<uint32_t>(data.Levels.size());
+
+    TextureCacheHeader header = { };
+    header.Magic = TEXTURE_CACHE_MAGIC;
+    header.Version = TEXTURE_CACHE_VERSION;
+    header.Key = key;
+    header.Format = static_cast<uint32_t>(data.Format);
+    header.Width = data.Width;
+    header.Height = data.Height;
+    header.BlockHeight = data.BlockHeight;
+    header.LevelCount = levelCount;
+
+    std::vector<TextureCacheLevelEntry> entries(levelCount);
+    size_t offset = GetLevelTableEnd(levelCount);
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        const TextureLevel& level = data.Levels[i];
+        entries[i].Offset = AlignUp(offset, TEXTURE_CACHE_DATA_ALIGNMENT);
+        entries[i].Size = level.RowPitch * level.RowCount;
+        entries[i].Width = level.Width;
+        entries[i].Height = level.Height;
+        entries[i].RowPitch = static_cast<uint32_t>(level.RowPitch);
+        entries[i].RowCount = level.RowCount;
+        offset = static_cast<size_t>(entries[i].Offset + entries[i].Size);
+    }
+
+    // two files with the same contents may be transcoded at once, the helper keeps them apart
+    size_t position = 0;
+    const bool stored = Platform::WriteFileAtomically(cacheFilePath, [&](FILE* file)
+    {
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+        written = written && (levelCount == 0 || fwrite(entries.data(), sizeof(TextureCacheLevelEntry), levelCount, file) == levelCount);
+
+        const uint8_t padding[TEXTURE_CACHE_DATA_ALIGNMENT] = { };
+        position = sizeof(header) + levelCount * sizeof(TextureCacheLevelEntry);
+
+        for (uint32_t i = 0; i < levelCount && written; ++i)
+        {
+            const size_t paddingSize = static_cast<size_t>(entries[i].Offset) - position;
+            written = paddingSize == 0 || fwrite(padding, 1, paddingSize, file) == paddingSize;
+            written = written && fwrite(data.Levels[i].Data, 1, static_cast<size_t>(entries[i].Size), file) == entries[i].Size;
+            position = static_cast<size_t>(entries[i].Offset + entries[i].Size);
+        }
+        return written;
+    });
+    if (!stored)
+    {
+        return false;
+    }
+
+    _stats.CacheBytesWritten += position;
+    return true;
+}
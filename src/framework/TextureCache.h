@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Application.h"
+#include "MappedFile.h"
+
+#include <atomic>
+
+// One mip level of a GPU-ready texture. Rows are texel rows for plain formats
+// and block rows for block compressed ones.
+struct TextureLevel
+{
+    const uint8_t* Data = nullptr;
+    VkDeviceSize RowPitch = 0;
+    uint32_t RowCount = 0;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+};
+
+// Texture payload that can be copied to an image as is. Levels either point into
+// Storage (freshly decoded) or into Mapping (loaded from the cache).
+struct TextureData
+{
+    VkFormat Format = VK_FORMAT_UNDEFINED;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t BlockHeight = 1;
+    std::vector<TextureLevel> Levels;
+    std::vector<uint8_t> Storage;
+    MappedFile Mapping;
+
+    void Reset();
+};
+
+// Content addressed store of transcoded textures. The key is a hash of the source
+// file bytes and the transcode options, the value is a .vktex container holding the
+// final format and the full mip chain, laid out so it can be mapped and uploaded
+// without touching the decoder.
+class TextureCache
+{
+public:
+    // Load may run on several threads at once
+    struct Stats
+    {
+        std::atomic<uint32_t> Hits { 0 };
+        std::atomic<uint32_t> Misses { 0 };
+        std::atomic<uint32_t> Failures { 0 };
+        std::atomic<uint64_t> SourceBytesRead { 0 };
+        std::atomic<uint64_t> CacheBytesRead { 0 };
+        std::atomic<uint64_t> CacheBytesWritten { 0 };
+    };
+
+private:
+    std::wstring _folderPath;
+    bool _generateMips = true;
+    bool _blockCompression = false;
+    Stats _stats;
+
+public:
+    void SetFolderPath(const std::wstring& folderPath);
+    void SetGenerateMips(bool generateMips);
+    // BC1 for opaque LDR textures, only enable when the device supports textureCompressionBC
+    void SetBlockCompression(bool blockCompression);
+
+    // Returns the cached payload for the file, transcoding and storing it on a miss. Safe to call
+    // from several threads, the settings must not change meanwhile.
+    bool Load(const std::wstring& filePath, TextureData& data);
+
+    const Stats& GetStats() const;
+    void PrintStats() const;
+
+    // Decodes the file without consulting the cache
+    static bool Decode(const std::wstring& filePath, TextureData& data, bool generateMips = false, bool blockCompression = false);
+
+private:
+    uint64_t ComputeKey(const uint8_t* source, size_t sourceSize) const;
+    std::wstring GetCacheFilePath(uint64_t key) const;
+    bool ReadCacheFile(const std::wstring& cacheFilePath, uint64_t key, TextureData& data);
+    bool WriteCacheFile(const std::wstring& cacheFilePath, uint64_t key, const TextureData& data);
+};
@@ -0,0 +1,531 @@
+#include "TextureStreamer.h"
+
+#include <cstring>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    Cleanup();
+}
+
+VkResult TextureStreamer::Create(const QueuesInfo& queues, VkDeviceSize ringSize)
+{
+    _transfer = queues.Transfer;
+    _graphics = queues.Graphics;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+    _copyAlignment = std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+
+    VkCommandPoolCreateInfo commandPoolCreateInfo;
+    commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolCreateInfo.pNext = nullptr;
+    commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    commandPoolCreateInfo.queueFamilyIndex = _transfer.QueueFamilyIndex;
+
+    VkResult code = vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &_transferCommandPool);
+    if (code != VK_SUCCESS)
+    {
+        _transferCommandPool = VK_NULL_HANDLE;
+        return code;
+    }
+
+    // images are released by the transfer queue and acquired by the graphics queue
+    if (_transfer.QueueFamilyIndex != _graphics.QueueFamilyIndex)
+    {
+        commandPoolCreateInfo.queueFamilyIndex = _graphics.QueueFamilyIndex;
+        code = vkCreateCommandPool(_device, &commandPoolCreateInfo, nullptr, &_graphicsCommandPool);
+        if (code != VK_SUCCESS)
+        {
+            _graphicsCommandPool = VK_NULL_HANDLE;
+            return code;
+        }
+    }
+
+    code = _ring.Create(ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging);
+    if (code != VK_SUCCESS)
+    {
+        return code;
+    }
+
+    _ringMemory = static_cast<uint8_t*>(_ring.Map(ringSize));
+    if (_ringMemory == nullptr)
+    {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+
+    return VK_SUCCESS;
+}
+
+void TextureStreamer::SetCache(TextureCache* cache)
+{
+    _cache = cache;
+}
+
+void TextureStreamer::Cleanup()
+{
+    if (_device == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    WaitIdle();
+
+    if (_ringMemory)
+    {
+        _ring.Unmap();
+        _ringMemory = nullptr;
+    }
+    _ring.Cleanup();
+
+    if (_transferCommandPool)
+    {
+        vkDestroyCommandPool(_device, _transferCommandPool, nullptr);
+        _transferCommandPool = VK_NULL_HANDLE;
+    }
+    if (_graphicsCommandPool)
+    {
+        vkDestroyCommandPool(_device, _graphicsCommandPool, nullptr);
+        _graphicsCommandPool = VK_NULL_HANDLE;
+    }
+}
+
+bool TextureStreamer::Load(const std::wstring& filePath, TextureData& texture) const
+{
+    if (!(_cache ? _cache->Load(filePath, texture) : TextureCache::Decode(filePath, texture)))
+    {
+        texture.Reset();
+        return false;
+    }
+    return true;
+}
+
+std::shared_future<bool> TextureStreamer::Enqueue(const std::wstring& filePath, ImageResource& target, CompletionCallback callback)
+{
+    // an empty texture fails the upload
+    TextureData texture;
+    if (_ringMemory != nullptr)
+    {
+        Load(filePath, texture);
+    }
+    return Enqueue(texture, target, callback);
+}
+
+std::shared_future<bool> TextureStreamer::Enqueue(const TextureData& texture, ImageResource& target, CompletionCallback callback)
+{
+    PendingTexture pending;
+    pending.Target = &target;
+    pending.Callback = callback;
+    pending.Promise = std::make_shared<std::promise<bool>>();
+
+    std::shared_future<bool> result = pending.Promise->get_future().share();
+
+    auto Fail = [&pending]()
+    {
+        pending.Promise->set_value(false);
+        if (pending.Callback)
+        {
+            pending.Callback(*pending.Target, false);
+        }
+    };
+
+    if (_ringMemory == nullptr || texture.Levels.empty())
+    {
+        Fail();
+        return result;
+    }
+
+    const uint32_t levelCount = static_cast<uint32_t>(texture.Levels.size());
+    const VkExtent3D imageExtent { texture.Width, texture.Height, 1 };
+    const VkImageSubresourceRange subresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+    VkResult code = VK_ERROR_OUT_OF_HOST_MEMORY;
+    if (texture.Levels[0].RowPitch <= _ring.Size)
+    {
+        code = target.CreateImage(VK_IMAGE_TYPE_2D, texture.Format, imageExtent, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, levelCount, MemoryCategory::Texture);
+    }
+    if (code == VK_SUCCESS)
+    {
+        code = target.CreateImageView(VK_IMAGE_VIEW_TYPE_2D, texture.Format, subresourceRange);
+    }
+    if (code == VK_SUCCESS && !_recording)
+    {
+        code = BeginBatch();
+    }
+    if (code != VK_SUCCESS)
+    {
+        Fail();
+        return result;
+    }
+
+    VkImageMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = target.Image;
+    barrier.subresourceRange = subresourceRange;
+
+    vkCmdPipelineBarrier(_recording->TransferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    for (uint32_t levelIndex = 0; levelIndex < levelCount; ++levelIndex)
+    {
+        const TextureLevel& level = texture.Levels[levelIndex];
+
+        // Rows go to the ring in strips, so a texture never has to fit into the ring as a whole.
+        // For block compressed formats a row is a row of blocks.
+        const uint32_t stripRows = static_cast<uint32_t>(std::max<VkDeviceSize>(1, (_ring.Size / 4) / level.RowPitch));
+
+        for (uint32_t row = 0; row < level.RowCount; row += stripRows)
+        {
+            const uint32_t rowCount = std::min(stripRows, level.RowCount - row);
+            const VkDeviceSize stripSize = rowCount * level.RowPitch;
+
+            VkDeviceSize offset;
+            if (!MakeRingSpace(stripSize, offset))
+            {
+                Fail();
+                return result;
+            }
+            if (!_recording)
+            {
+                code = BeginBatch();
+                NVVK_CHECK_ERROR(code, L"TextureStreamer BeginBatch");
+            }
+
+            memcpy(_ringMemory + offset, level.Data + row * level.RowPitch, static_cast<size_t>(stripSize));
+
+            const uint32_t texelRow = row * texture.BlockHeight;
+
+            VkBufferImageCopy region;
+            region.bufferOffset = offset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, levelIndex, 0, 1 };
+            region.imageOffset = { 0, static_cast<int32_t>(texelRow), 0 };
+            region.imageExtent = { level.Width, std::min(rowCount * texture.BlockHeight, level.Height - texelRow), 1 };
+
+            vkCmdCopyBufferToImage(_recording->TransferCommandBuffer, _ring.Buffer, target.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    if (_graphicsCommandPool)
+    {
+        // queue family ownership transfer: release here, acquire on the graphics queue
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = _transfer.QueueFamilyIndex;
+        barrier.dstQueueFamilyIndex = _graphics.QueueFamilyIndex;
+
+        vkCmdPipelineBarrier(_recording->TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        _recording->AcquireBarriers.push_back(barrier);
+    }
+    else
+    {
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(_recording->TransferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    _recording->Textures.push_back(pending);
+
+    if (_recording->Textures.size() >= _maxTexturesPerBatch)
+    {
+        Flush();
+    }
+
+    return result;
+}
+
+void TextureStreamer::Flush()
+{
+    if (!_recording)
+    {
+        return;
+    }
+
+    Batch& batch = *_recording;
+    batch.RingEnd = _ringTail;
+
+    VkResult code = vkEndCommandBuffer(batch.TransferCommandBuffer);
+    NVVK_CHECK_ERROR(code, L"TextureStreamer vkEndCommandBuffer");
+
+    const bool acquireOnGraphics = !batch.AcquireBarriers.empty();
+
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = nullptr;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = nullptr;
+    submitInfo.pWaitDstStageMask = nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.TransferCommandBuffer;
+    submitInfo.signalSemaphoreCount = acquireOnGraphics ? 1 : 0;
+    submitInfo.pSignalSemaphores = acquireOnGraphics ? &batch.OwnershipSemaphore : nullptr;
+
+    code = vkQueueSubmit(_transfer.Queue, 1, &submitInfo, acquireOnGraphics ? VK_NULL_HANDLE : batch.Fence);
+    NVVK_CHECK_ERROR(code, L"TextureStreamer vkQueueSubmit");
+
+    if (acquireOnGraphics)
+    {
+        VkCommandBufferBeginInfo beginInfo;
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.pNext = nullptr;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = nullptr;
+
+        vkBeginCommandBuffer(batch.AcquireCommandBuffer, &beginInfo);
+        vkCmdPipelineBarrier(batch.AcquireCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(batch.AcquireBarriers.size()), batch.AcquireBarriers.data());
+        vkEndCommandBuffer(batch.AcquireCommandBuffer);
+
+        const VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &batch.OwnershipSemaphore;
+        submitInfo.pWaitDstStageMask = &waitStageMask;
+        submitInfo.pCommandBuffers = &batch.AcquireCommandBuffer;
+        submitInfo.signalSemaphoreCount = 0;
+        submitInfo.pSignalSemaphores = nullptr;
+
+        code = vkQueueSubmit(_graphics.Queue, 1, &submitInfo, batch.Fence);
+        NVVK_CHECK_ERROR(code, L"TextureStreamer vkQueueSubmit (acquire)");
+    }
+
+    _inFlight.push_back(std::move(_recording));
+}
+
+void TextureStreamer::Update()
+{
+    while (RetireOldestBatch(false))
+    {
+    }
+}
+
+void TextureStreamer::WaitIdle()
+{
+    Flush();
+    while (RetireOldestBatch(true))
+    {
+    }
+}
+
+bool TextureStreamer::AllocateFromRing(VkDeviceSize size, VkDeviceSize& offset)
+{
+    if (_ringEmpty)
+    {
+        if (size > _ring.Size)
+        {
+            return false;
+        }
+        offset = 0;
+        _ringHead = 0;
+        _ringTail = size;
+        _ringEmpty = false;
+        return true;
+    }
+
+    const VkDeviceSize start = AlignUp(_ringTail, _copyAlignment);
+
+    if (_ringTail > _ringHead)
+    {
+        // live range is [head, tail), try the end of the ring first, then wrap around
+        if (start + size <= _ring.Size)
+        {
+            offset = start;
+            _ringTail = start + size;
+            return true;
+        }
+        if (size <= _ringHead)
+        {
+            offset = 0;
+            _ringTail = size;
+            return true;
+        }
+        return false;
+    }
+
+    // live range wraps: [head, end) + [0, tail)
+    if (_ringTail < _ringHead && start + size <= _ringHead)
+    {
+        offset = start;
+        _ringTail = start + size;
+        return true;
+    }
+
+    return false;
+}
+
+bool TextureStreamer::MakeRingSpace(VkDeviceSize size, VkDeviceSize& offset)
+{
+    while (!AllocateFromRing(size, offset))
+    {
+        if (_inFlight.empty())
+        {
+            if (!_recording)
+            {
+                return false;
+            }
+            Flush();
+        }
+        RetireOldestBatch(true);
+    }
+    return true;
+}
+
+VkResult TextureStreamer::BeginBatch()
+{
+    std::unique_ptr<Batch> batch = std::make_unique<Batch>();
+
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo;
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.pNext = nullptr;
+    commandBufferAllocateInfo.commandPool = _transferCommandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = 1;
+
+    VkResult code = vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &batch->TransferCommandBuffer);
+    if (code != VK_SUCCESS)
+    {
+        batch->TransferCommandBuffer = VK_NULL_HANDLE;
+        DestroyBatch(*batch);
+        return code;
+    }
+
+    VkFenceCreateInfo fenceCreateInfo;
+    fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceCreateInfo.pNext = nullptr;
+    fenceCreateInfo.flags = 0;
+
+    code = vkCreateFence(_device, &fenceCreateInfo, nullptr, &batch->Fence);
+    if (code != VK_SUCCESS)
+    {
+        batch->Fence = VK_NULL_HANDLE;
+        DestroyBatch(*batch);
+        return code;
+    }
+
+    if (_graphicsCommandPool)
+    {
+        commandBufferAllocateInfo.commandPool = _graphicsCommandPool;
+        code = vkAllocateCommandBuffers(_device, &commandBufferAllocateInfo, &batch->AcquireCommandBuffer);
+        if (code != VK_SUCCESS)
+        {
+            batch->AcquireCommandBuffer = VK_NULL_HANDLE;
+            DestroyBatch(*batch);
+            return code;
+        }
+
+        VkSemaphoreCreateInfo semaphoreCreateInfo;
+        semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreCreateInfo.pNext = nullptr;
+        semaphoreCreateInfo.flags = 0;
+
+        code = vkCreateSemaphore(_device, &semaphoreCreateInfo, nullptr, &batch->OwnershipSemaphore);
+        if (code != VK_SUCCESS)
+        {
+            batch->OwnershipSemaphore = VK_NULL_HANDLE;
+            DestroyBatch(*batch);
+            return code;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    code = vkBeginCommandBuffer(batch->TransferCommandBuffer, &beginInfo);
+    if (code != VK_SUCCESS)
+    {
+        DestroyBatch(*batch);
+        return code;
+    }
+
+    _recording = std::move(batch);
+    return VK_SUCCESS;
+}
+
+bool TextureStreamer::RetireOldestBatch(bool wait)
+{
+    if (_inFlight.empty())
+    {
+        return false;
+    }
+
+    Batch& batch = *_inFlight.front();
+    if (wait)
+    {
+        const VkResult code = vkWaitForFences(_device, 1, &batch.Fence, VK_TRUE, UINT64_MAX);
+        NVVK_CHECK_ERROR(code, L"TextureStreamer vkWaitForFences");
+    }
+    else if (vkGetFenceStatus(_device, batch.Fence) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    // batches retire in submission order, so everything up to this batch's end is free again
+    _ringHead = batch.RingEnd;
+    if (_ringHead == _ringTail)
+    {
+        _ringEmpty = true;
+        _ringHead = 0;
+        _ringTail = 0;
+    }
+
+    for (auto& texture : batch.Textures)
+    {
+        texture.Promise->set_value(true);
+        if (texture.Callback)
+        {
+            texture.Callback(*texture.Target, true);
+        }
+    }
+
+    DestroyBatch(batch);
+    _inFlight.pop_front();
+    return true;
+}
+
+void TextureStreamer::DestroyBatch(Batch& batch)
+{
+    if (batch.TransferCommandBuffer)
+    {
+        vkFreeCommandBuffers(_device, _transferCommandPool, 1, &batch.TransferCommandBuffer);
+        batch.TransferCommandBuffer = VK_NULL_HANDLE;
+    }
+    if (batch.AcquireCommandBuffer)
+    {
+        vkFreeCommandBuffers(_device, _graphicsCommandPool, 1, &batch.AcquireCommandBuffer);
+        batch.AcquireCommandBuffer = VK_NULL_HANDLE;
+    }
+    if (batch.OwnershipSemaphore)
+    {
+        vkDestroySemaphore(_device, batch.OwnershipSemaphore, nullptr);
+        batch.OwnershipSemaphore = VK_NULL_HANDLE;
+    }
+    if (batch.Fence)
+    {
+        vkDestroyFence(_device, batch.Fence, nullptr);
+        batch.Fence = VK_NULL_HANDLE;
+    }
+}
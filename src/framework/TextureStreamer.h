@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Application.h"
+#include "TextureCache.h"
+
+#include <deque>
+#include <functional>
+#include <future>
+
+// Streams 2D textures to the GPU through a persistently mapped staging ring.
+// Rows of every mip level are written straight into the ring in strips, copies are
+// recorded on the transfer queue and many textures share a single submit.
+class TextureStreamer : public ResourceBase
+{
+public:
+    using CompletionCallback = std::function<void(ImageResource& image, bool succeeded)>;
+
+private:
+    struct PendingTexture
+    {
+        ImageResource* Target;
+        CompletionCallback Callback;
+        std::shared_ptr<std::promise<bool>> Promise;
+    };
+
+    struct Batch
+    {
+        VkCommandBuffer TransferCommandBuffer = VK_NULL_HANDLE;
+        VkCommandBuffer AcquireCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore OwnershipSemaphore = VK_NULL_HANDLE;
+        VkFence Fence = VK_NULL_HANDLE;
+        VkDeviceSize RingEnd = 0;
+        std::vector<PendingTexture> Textures;
+        std::vector<VkImageMemoryBarrier> AcquireBarriers;
+    };
+
+    QueueInfo _transfer = { };
+    QueueInfo _graphics = { };
+    VkCommandPool _transferCommandPool = VK_NULL_HANDLE;
+    VkCommandPool _graphicsCommandPool = VK_NULL_HANDLE;
+
+    BufferResource _ring;
+    uint8_t* _ringMemory = nullptr;
+    VkDeviceSize _ringHead = 0;
+    VkDeviceSize _ringTail = 0;
+    bool _ringEmpty = true;
+    VkDeviceSize _copyAlignment = 16;
+
+    std::unique_ptr<Batch> _recording;
+    std::deque<std::unique_ptr<Batch>> _inFlight;
+
+    uint32_t _maxTexturesPerBatch = 64;
+
+    TextureCache* _cache = nullptr;
+
+public:
+    ~TextureStreamer();
+
+public:
+    VkResult Create(const QueuesInfo& queues, VkDeviceSize ringSize);
+    void Cleanup();
+
+    // With a cache set, textures come from its transcoded store instead of being decoded
+    void SetCache(TextureCache* cache);
+
+    // Loads the file and queues its upload. The image and its view are created
+    // immediately, the data becomes valid once the future/callback reports success.
+    std::shared_future<bool> Enqueue(const std::wstring& filePath, ImageResource& target, CompletionCallback callback = nullptr);
+    // The same for a texture loaded beforehand, it may go away once this returns
+    std::shared_future<bool> Enqueue(const TextureData& texture, ImageResource& target, CompletionCallback callback = nullptr);
+
+    // The loading half of Enqueue, through the cache when there is one. Touches nothing of the
+    // streamer, so any number of textures can be loaded on other threads at the same time.
+    bool Load(const std::wstring& filePath, TextureData& texture) const;
+
+    void Flush();
+    void Update();
+    void WaitIdle();
+
+private:
+    bool AllocateFromRing(VkDeviceSize size, VkDeviceSize& offset);
+    bool MakeRingSpace(VkDeviceSize size, VkDeviceSize& offset);
+    VkResult BeginBatch();
+    bool RetireOldestBatch(bool wait);
+    void DestroyBatch(Batch& batch);
+};
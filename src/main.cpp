@@ -1,10 +1,114 @@
 #include "vkTracer.h"
+#include "DistributedRender.h"
 
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
 
-int main(int, char**) {
+static void PrintUsage() {
+    std::cout << "Usage:\n"
+              << "  vkTracer --benchmark <config file> [--headless]\n"
+              << "  vkTracer --sampler-report\n"
+              << "  vkTracer --distributed <config file>\n"
+              << "  vkTracer --render-worker <address> <port> [threads]\n"
+              << "  vkTracer [--lens <aperture radius> <focus distance>] [--shutter <open> <close>] [--geometry-budget <MB>] [--lod <off|projected>]\n";
+}
+
+// the whole argument has to be a number, std::stof would throw or stop at the first bad character
+static bool ParseFloat(const char* text, float& value) {
+    char* end = nullptr;
+    value = std::strtof(text, &end);
+    return end != text && *end == '\0';
+}
+
+// the same for whole numbers up to maxValue, std::stoull would throw and take a sign
+static bool ParseUint(const char* text, const uint64_t maxValue, uint64_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    return text[0] >= '0' && text[0] <= '9' && *end == '\0' && errno != ERANGE && value <= maxValue;
+}
+
+int main(int argc, char** argv) {
+    // vkTracer --benchmark <config file> [--headless], see Benchmark.h for the format
+    // vkTracer --sampler-report, the sampler's convergence against white noise, no GPU needed
+    // vkTracer --distributed <config file>, one still over several CPU worker processes, see DistributedRender.h
+    // vkTracer --render-worker <address> <port> [threads], a worker for a --distributed coordinator elsewhere
+    // vkTracer [--lens <aperture radius> <focus distance>] [--shutter <open> <close>] [--geometry-budget <MB>] [--lod <off|projected>]
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        headless = headless || std::string(argv[i]) == "--headless";
+        if (std::string(argv[i]) == "--sampler-report") {
+            return Sampler::PrintConvergenceReport() ? 0 : 1;
+        }
+    }
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--benchmark") {
+            const std::string configFileName(argv[i + 1]);
+            return Benchmark::Run(std::wstring(configFileName.begin(), configFileName.end()), headless);
+        }
+        if (std::string(argv[i]) == "--distributed") {
+            const std::string configFileName(argv[i + 1]);
+            return DistributedRender::RunCoordinator(std::wstring(configFileName.begin(), configFileName.end()));
+        }
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--render-worker") {
+            uint64_t port = 0, numThreads = 0;
+            if (i + 2 >= argc || !ParseUint(argv[i + 2], UINT16_MAX, port) || (i + 3 < argc && !ParseUint(argv[i + 3], UINT32_MAX, numThreads))) {
+                std::cout << "--render-worker takes a port and a thread count\n";
+                PrintUsage();
+                return 1;
+            }
+            return DistributedRender::RunWorker(argv[i + 1], static_cast<uint16_t>(port), static_cast<uint32_t>(numThreads));
+        }
+    }
+
+    // checked before the application exists, it can't be torn down before Run
+    float lens[2] = { 0.0f, 0.0f };
+    float shutter[2] = { 0.0f, 0.0f };
+    uint64_t geometryBudgetMB = 0;
+    bool hasLens = false, hasShutter = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string option(argv[i]);
+        if (option == "--geometry-budget") {
+            if (i + 1 >= argc || !ParseUint(argv[i + 1], UINT64_MAX / (1024 * 1024), geometryBudgetMB)) {
+                std::cout << option << " takes a size in MB\n";
+                PrintUsage();
+                return 1;
+            }
+            ++i;
+            continue;
+        }
+        if (option != "--lens" && option != "--shutter") {
+            continue;
+        }
+
+        float* values = (option == "--lens") ? lens : shutter;
+        if (i + 2 >= argc || !ParseFloat(argv[i + 1], values[0]) || !ParseFloat(argv[i + 2], values[1])) {
+            std::cout << option << " takes two numbers\n";
+            PrintUsage();
+            return 1;
+        }
+        hasLens = hasLens || values == lens;
+        hasShutter = hasShutter || values == shutter;
+        i += 2;
+    }
+
     std::cout << "Hello World!\n";
 
     vkTracer tracerApp;
+    tracerApp.SetGeometryBudget(geometryBudgetMB * 1024 * 1024);
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--lod") {
+            tracerApp.SetLodPolicy(std::string(argv[i + 1]) == "projected" ? LodPolicy::Projected : LodPolicy::Off);
+        }
+    }
+    if (hasLens) {
+        tracerApp.SetLens(lens[0], lens[1]);
+    }
+    if (hasShutter) {
+        tracerApp.SetShutter(shutter[0], shutter[1]);
+    }
     tracerApp.Run();
 }
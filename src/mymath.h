@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
+#ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 4201) // C4201: nonstandard extension used: nameless struct/union
+#endif
 #define GLM_ENABLE_EXPERIMENTAL
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_FORCE_RADIANS
@@ -10,11 +14,16 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
+#ifdef _MSC_VER
 #pragma warning(pop)
+#endif
 
+using uint = uint32_t;
 using vec2 = glm::highp_vec2;
 using vec3 = glm::highp_vec3;
 using vec4 = glm::highp_vec4;
+using uvec2 = glm::highp_uvec2;
+using uvec4 = glm::highp_uvec4;
 using mat4 = glm::highp_mat4;
 using quat = glm::highp_quat;
 
@@ -45,6 +54,12 @@ inline T lerp(const T& a, const T& b, const float t) {
     return a + (b - a) * t;
 }
 
+// GLSL's name for lerp
+template <typename T>
+inline T mix(const T& a, const T& b, const float t) {
+    return a + (b - a) * t;
+}
+
 template <typename T>
 inline T clamp(const T& v, const T& minV, const T& maxV) {
     return (v < minV) ? minV : ((v > maxV) ? maxV : v);
@@ -62,6 +77,10 @@ inline vec3 normalize(const vec3& v) { return glm::normalize(v); }
 inline quat normalize(const quat& q) { return glm::normalize(q); }
 inline quat QAngleAxis(const float angleRad, const vec3& axis) { return glm::angleAxis(angleRad, axis); }
 inline vec3 QRotate(const quat& q, const vec3& v) { return glm::rotate(q, v); }
+// takes the shorter way around
+inline quat QSlerp(const quat& a, const quat& b, const float t) { return glm::slerp(a, b, t); }
+// rotates -Z onto direction, right-handed like MatLookAt
+inline quat QLookAt(const vec3& direction, const vec3& up) { return glm::quatLookAt(direction, up); }
 
 inline mat4 MatRotate(const float angle, const float x, const float y, const float z) { return glm::rotate(angle, vec3(x, y, z)); }
 
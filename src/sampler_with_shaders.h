@@ -0,0 +1,99 @@
+// Low-discrepancy sampling, the same code for the shaders and the CPU.
+//
+// Sample n of a pixel in dimension d is point n of an Owen scrambled Sobol sequence shared by all
+// pixels of a blue noise tile, toroidally shifted by the tile. Every tile scrambles the points
+// with its own seed, so the pattern doesn't repeat across the image. Within a pixel the samples keep the
+// stratification of the Sobol points, across pixels the remaining error is spread as blue noise.
+// Dimensions past SWS_SAMPLER_SOBOL_DIMS reuse the Sobol dimensions with the points shuffled
+// differently (Burley, "Practical Hash-based Owen Scrambling", 2020).
+//
+// The includer declares the tables as SamplerTables first: shaders/sampler.glsl for the
+// shaders, Sampler.h on the CPU.
+
+SWS_FUNC uint ReverseBits(uint x) {
+    x = ((x >> 1u) & 0x55555555u) | ((x & 0x55555555u) << 1u);
+    x = ((x >> 2u) & 0x33333333u) | ((x & 0x33333333u) << 2u);
+    x = ((x >> 4u) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4u);
+    x = ((x >> 8u) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8u);
+    return (x >> 16u) | (x << 16u);
+}
+
+// for seeds, lowbias32 by Chris Wellons
+SWS_FUNC uint HashUint(uint x) {
+    x ^= x >> 16u;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15u;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+// every bit is flipped depending on the bits below it only
+SWS_FUNC uint LaineKarrasPermutation(uint x, uint seed) {
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return x;
+}
+
+// Owen scramble, power of two sized runs of points stay a net
+SWS_FUNC uint NestedUniformScramble(uint x, uint seed) {
+    return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+}
+
+SWS_FUNC uint SobolSample(uint index, uint sobolDimension) {
+    uint result = 0u;
+    for (uint bit = 0u; bit < SWS_SAMPLER_SOBOL_BITS && index != 0u; ++bit) {
+        if ((index & 1u) != 0u) {
+            result ^= SamplerTables.sobolMatrices[sobolDimension * SWS_SAMPLER_SOBOL_BITS + bit];
+        }
+        index >>= 1u;
+    }
+    return result;
+}
+
+// [0, 1) from the top 24 bits, all of them exact in a float
+SWS_FUNC float UintToUnitFloat(uint x) {
+    return float(x >> 8u) * (1.0f / 16777216.0f);
+}
+
+// every dimension reads the tile at another offset
+SWS_FUNC uint BlueNoiseShift(uvec2 pixel, uint dimension) {
+    const uint x = (pixel.x + dimension * 23u) % SWS_SAMPLER_BLUE_NOISE_SIZE;
+    const uint y = (pixel.y + dimension * 41u) % SWS_SAMPLER_BLUE_NOISE_SIZE;
+    return SamplerTables.blueNoise[y * SWS_SAMPLER_BLUE_NOISE_SIZE + x];
+}
+
+// the pixels of a tile share it, their shifts only spread the error as blue noise among them
+SWS_FUNC uint BlueNoiseTileSeed(uvec2 pixel) {
+    return HashUint(pixel.x / SWS_SAMPLER_BLUE_NOISE_SIZE + HashUint(pixel.y / SWS_SAMPLER_BLUE_NOISE_SIZE));
+}
+
+// the shift wraps around in the integer domain, so it is exact
+SWS_FUNC uint SamplerGetUint(uvec2 pixel, uint sampleIndex, uint dimension) {
+    const uint sobolDimension = dimension % SWS_SAMPLER_SOBOL_DIMS;
+    const uint group = dimension / SWS_SAMPLER_SOBOL_DIMS;
+    const uint tileSeed = BlueNoiseTileSeed(pixel);
+
+    const uint index = NestedUniformScramble(sampleIndex, HashUint(group ^ tileSeed));
+    const uint value = NestedUniformScramble(SobolSample(index, sobolDimension), HashUint((dimension + 0x9E3779B9u) ^ tileSeed));
+    return value + BlueNoiseShift(pixel, dimension);
+}
+
+SWS_FUNC float SamplerGet1D(uvec2 pixel, uint sampleIndex, uint dimension) {
+    return UintToUnitFloat(SamplerGetUint(pixel, sampleIndex, dimension));
+}
+
+// dimension and the one after it, start at an even one so both come from the same Sobol pair
+SWS_FUNC vec2 SamplerGet2D(uvec2 pixel, uint sampleIndex, uint dimension) {
+    return vec2(SamplerGet1D(pixel, sampleIndex, dimension), SamplerGet1D(pixel, sampleIndex, dimension + 1u));
+}
+
+// one of the SWS_LOD_MASK_BITS instance mask bits, a level of detail blend gives each level the
+// share of the bits it is blended by, so that share of the samples sees it
+SWS_FUNC uint SamplerGetLodCullMask(uvec2 pixel, uint sampleIndex) {
+    const uint bit = uint(SamplerGet1D(pixel, sampleIndex, SWS_SAMPLE_DIM_LOD) * float(SWS_LOD_MASK_BITS));
+    return 1u << ((bit < SWS_LOD_MASK_BITS) ? bit : (SWS_LOD_MASK_BITS - 1u));
+}
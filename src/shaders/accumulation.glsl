@@ -0,0 +1,29 @@
+// Progressive accumulation, see vkTracer::CreateAccumulationImages.
+// Every pixel keeps the running mean of its frames next to the camera generation they were
+// rendered for. A pixel that sees a newer generation starts over, so a camera change resets it
+// without a clear on the CPU side and without rerecording the command buffers.
+
+layout(set = SWS_ACCUM_SET,     binding = SWS_ACCUM_BINDING,     rgba32f) uniform image2D  AccumImage;
+layout(set = SWS_ACCUM_GEN_SET, binding = SWS_ACCUM_GEN_BINDING, r32ui)   uniform uimage2D AccumGenImage;
+
+// frames already in the pixel's mean, 0 when the view changed since
+uint AccumulatedFrames(ivec2 pixel, uint generation) {
+    if (imageLoad(AccumGenImage, pixel).x != generation) {
+        return 0u;
+    }
+    return uint(imageLoad(AccumImage, pixel).a);
+}
+
+// folds the color of this frame into the pixel's mean and returns the new mean
+vec3 Accumulate(ivec2 pixel, vec3 color, uint generation) {
+    const uint frames = AccumulatedFrames(pixel, generation);
+
+    vec3 mean = color;
+    if (frames > 0u) {
+        mean = mix(imageLoad(AccumImage, pixel).rgb, color, 1.0f / float(frames + 1u));
+    }
+
+    imageStore(AccumImage, pixel, vec4(mean, float(frames + 1u)));
+    imageStore(AccumGenImage, pixel, uvec4(generation));
+    return mean;
+}
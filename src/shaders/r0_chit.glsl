@@ -5,6 +5,11 @@
 
 #include "../shared_with_shaders.h"
 
+// set per variant by the pipeline builder, a plain compile covers every feature
+#ifndef MATERIAL_FEATURES
+#define MATERIAL_FEATURES SWS_MATFEATURE_ALL
+#endif
+
 layout(location = SWS_LOC_PRIMARY_RAY)   rayPayloadInNVX RayPayload_s RayPayload;
 layout(location = SWS_LOC_HIT_ATTRIBS)   hitAttributeNVX vec3 HitAttribs;
 
@@ -12,24 +17,69 @@ layout(set = SWS_MATERIALS_SET, binding = SWS_MATERIALS_BINDING) readonly buffer
     Material_s Materials[];
 };
 
-layout(set = SWS_FACEMATIDS_SET, binding = 0) uniform usamplerBuffer FaceMatIDs[];
-layout(set = SWS_FACES_SET,      binding = 0) uniform usamplerBuffer Faces[];
-layout(set = SWS_NORMALS_SET,    binding = 0) uniform samplerBuffer Normals[];
+layout(set = SWS_GEOMETRY_SET, binding = SWS_FACES_BINDING)      readonly buffer FacesBuffer      { uint Faces[]; };
+layout(set = SWS_GEOMETRY_SET, binding = SWS_NORMALS_BINDING)    readonly buffer NormalsBuffer    { float Normals[]; };
+#if (MATERIAL_FEATURES & SWS_MATFEATURE_ALBEDO_TEXTURE)
+layout(set = SWS_GEOMETRY_SET, binding = SWS_UVS_BINDING)        readonly buffer UVsBuffer        { vec2 UVs[]; };
+#endif
+layout(set = SWS_GEOMETRY_SET, binding = SWS_FACEMATIDS_BINDING) readonly buffer FaceMatIDsBuffer { uint FaceMatIDs[]; };
+layout(set = SWS_GEOMETRY_SET, binding = SWS_INSTANCES_BINDING)  readonly buffer InstancesBuffer  { InstanceData_s Instances[]; };
+layout(set = SWS_GEOMETRY_SET, binding = SWS_POSITIONS_BINDING)  readonly buffer PositionsBuffer  { float Positions[]; };
+
+#if (MATERIAL_FEATURES & SWS_MATFEATURE_ALBEDO_TEXTURE)
+layout(set = SWS_TEXTURES_SET, binding = 0) uniform sampler2D Textures[];
+#endif
+
+// normals and positions are tightly packed, std430 would pad a vec3 array to 16 bytes
+vec3 FetchNormal(uint vertexIdx) {
+    return vec3(Normals[vertexIdx * 3 + 0], Normals[vertexIdx * 3 + 1], Normals[vertexIdx * 3 + 2]);
+}
+
+vec3 FetchPosition(uint vertexIdx) {
+    const vec3 p = vec3(Positions[vertexIdx * 3 + 0], Positions[vertexIdx * 3 + 1], Positions[vertexIdx * 3 + 2]);
+    return gl_ObjectToWorldNVX * vec4(p, 1.0f);
+}
 
 void main() {
-    const uint matID = texelFetch(FaceMatIDs[nonuniformEXT(gl_InstanceCustomIndexNVX)], gl_PrimitiveID).x;
-    const Material_s material = Materials[nonuniformEXT(matID)];
+    const InstanceData_s instance = Instances[gl_InstanceCustomIndexNVX];
+    const uint faceIdx = instance.faceOffset + gl_PrimitiveID;
+
+    const uint matID = FaceMatIDs[faceIdx];
+    const Material_s material = Materials[matID];
 
     const vec3 barycentrics = vec3(1.0f - HitAttribs.x - HitAttribs.y, HitAttribs.x, HitAttribs.y);
 
-    const uvec3 face = texelFetch(Faces[nonuniformEXT(gl_InstanceCustomIndexNVX)], gl_PrimitiveID).xyz;
+    const uvec3 face = uvec3(Faces[faceIdx * 3 + 0], Faces[faceIdx * 3 + 1], Faces[faceIdx * 3 + 2]) + instance.vertexOffset;
 
-    const vec3 n0 = texelFetch(Normals[nonuniformEXT(gl_InstanceCustomIndexNVX)], int(face.x)).xyz;
-    const vec3 n1 = texelFetch(Normals[nonuniformEXT(gl_InstanceCustomIndexNVX)], int(face.y)).xyz;
-    const vec3 n2 = texelFetch(Normals[nonuniformEXT(gl_InstanceCustomIndexNVX)], int(face.z)).xyz;
+    const vec3 n0 = FetchNormal(face.x);
+    const vec3 n1 = FetchNormal(face.y);
+    const vec3 n2 = FetchNormal(face.z);
 
     const vec3 normal = normalize(mat3(gl_ObjectToWorldNVX) * BaryLerp(n0, n1, n2, barycentrics));
 
-    RayPayload.colorAndDist = vec4(material.diffuse.rgb, gl_HitTNVX);
+    const vec3 p0 = FetchPosition(face.x);
+    const vec3 p1 = FetchPosition(face.y);
+    const vec3 p2 = FetchPosition(face.z);
+
+    // the cone's footprint on the surface, no ray leaves it so it isn't passed on
+    const vec2 cone = RayConePropagate(RayPayload.cone.xy, gl_HitTNVX);
+
+    vec3 albedo = material.diffuse.rgb;
+#if (MATERIAL_FEATURES & SWS_MATFEATURE_ALBEDO_TEXTURE)
+    if (material.textures.x != SWS_INVALID_TEXTURE) {
+        const vec2 uv0 = UVs[face.x];
+        const vec2 uv1 = UVs[face.y];
+        const vec2 uv2 = UVs[face.z];
+        const vec2 uv = BaryLerp(uv0, uv1, uv2, barycentrics);
+
+        // no derivatives in ray tracing stages, the mip comes from the cone footprint instead
+        const vec2 texSize = vec2(textureSize(Textures[nonuniformEXT(material.textures.x)], 0));
+        const float lod = RayConeTextureLod(TriangleTextureLod(p0, p1, p2, uv0, uv1, uv2), cone.x, normal, gl_WorldRayDirectionNVX, texSize);
+
+        albedo *= textureLod(Textures[nonuniformEXT(material.textures.x)], uv, lod).rgb;
+    }
+#endif
+
+    RayPayload.colorAndDist = vec4(albedo, gl_HitTNVX);
     RayPayload.normal = vec4(normal, 0.0f);
 }
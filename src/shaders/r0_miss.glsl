@@ -8,11 +8,20 @@ layout(location = SWS_LOC_PRIMARY_RAY) rayPayloadInNVX RayPayload_s RayPayload;
 
 layout(set = SWS_IBL_SET, binding = SWS_IBL_BINDING) uniform sampler2D IBLTexture;
 
+layout(constant_id = SWS_SC_IBL_ENABLED) const bool IBLEnabled = true;
+
+const vec3 gSkyColor = vec3(0.6f, 0.7f, 0.8f);
+
 void main() {
-    const vec3 dir = normalize(gl_WorldRayDirectionNVX);
-    vec2 uv = CartesianToLatLong(dir);
+    vec3 iblColor = gSkyColor;
+    if (IBLEnabled) {
+        const vec3 dir = normalize(gl_WorldRayDirectionNVX);
+        vec2 uv = CartesianToLatLong(dir);
 
-    const vec3 iblColor = texture(IBLTexture, uv).rgb;
+        // implicit derivatives are undefined here, the cone spread picks the mip
+        const float lod = RayConeEnvironmentLod(RayPayload.cone.y, vec2(textureSize(IBLTexture, 0)));
+        iblColor = textureLod(IBLTexture, uv, lod).rgb;
+    }
 
     RayPayload.colorAndDist = vec4(iblColor, -1.0f);
 }
@@ -11,42 +11,32 @@ layout(set = SWS_CAMDATA_SET, binding = SWS_CAMDATA_BINDING, std140) uniform Cam
     CamData_s Camera;
 };
 
+#include "accumulation.glsl"
+#include "sampler.glsl"
+
 layout(location = SWS_LOC_PRIMARY_RAY)   rayPayloadNVX RayPayload_s RayPayload;
 layout(location = SWS_LOC_SECONDARY_RAY) rayPayloadNVX RayPayload_s RayPayloadSecondary;
 
+layout(constant_id = SWS_SC_SHADOWS_ENABLED) const bool ShadowsEnabled = true;
 
-vec3 CalcRayDir(vec2 screenUV, float aspect) {
-    vec3 u = Camera.side.xyz;
-    vec3 v = Camera.up.xyz;
-
-    const float planeWidth = tan(Camera.nearFarFov.z * 0.5f);
-
-    u *= (planeWidth * aspect);
-    v *= planeWidth;
-
-    //const vec3 rayDir = normalize(Camera.dir.xyz + (u * screenUV.x) - (v * (screenUV.y - 1.0f)));
-    const vec3 rayDir = normalize(Camera.dir.xyz + (u * screenUV.x) - (v * screenUV.y));
-    return rayDir;
-}
 
-const vec3 gSunPos = vec3(436.181488f, 583.134888f, 57.8915443f);
-
-void main() {
-    const vec2 curPixel = vec2(gl_LaunchIDNVX.xy);
+vec3 TraceSample(vec2 pixel, vec2 lensSample, float timeSample, uint cullMask) {
     const vec2 bottomRight = vec2(gl_LaunchSizeNVX.xy - 1);
 
-    const vec2 uv = (curPixel / bottomRight) * 2.0f - 1.0f;
+    const vec2 uv = (pixel / bottomRight) * 2.0f - 1.0f;
 
     const float aspect = float(gl_LaunchSizeNVX.x) / float(gl_LaunchSizeNVX.y);
 
-    const vec3 origin = Camera.pos.xyz;
-    const vec3 direction = CalcRayDir(uv, aspect);
+    vec3 origin, direction;
+    CameraRay(Camera, uv, aspect, lensSample, timeSample, origin, direction);
 
     const uint rayFlags = gl_RayFlagsOpaqueNVX;
-    const uint cullMask = 0xff;
     const float tmin = Camera.nearFarFov.x;
     const float tmax = Camera.nearFarFov.y;
 
+    // the cone starts as a point, also with an aperture where the lens blur is the larger effect
+    RayPayload.cone = vec4(0.0f, Camera.nearFarFov.w, 0.0f, 0.0f);
+
     traceNVX(Scene,
              rayFlags,
              cullMask,
@@ -66,32 +56,57 @@ void main() {
     float lambert = 1.0f;
     if (hitT > SWS_EPSILON) {
         const vec3 hitPos = origin + direction * hitT;
-        vec3 toLight = gSunPos - hitPos;
+        vec3 toLight = SWS_SUN_POS - hitPos;
         const float toLightDist = length(toLight);
         toLight /= toLightDist;
 
-        // check for shadow
-        traceNVX(Scene,
-                 rayFlags,
-                 cullMask,
-                 1 /*sbtRecordOffset*/,
-                 0 /*sbtRecordStride*/,
-                 1 /*missIndex*/,
-                 hitPos + (hitNormal * 0.1f),
-                 SWS_EPSILON,
-                 toLight,
-                 toLightDist,
-                 SWS_LOC_SECONDARY_RAY);
-
-        if (RayPayloadSecondary.colorAndDist.w < toLightDist) {
-            // in shadow
-            lambert = 0.05f;
+        bool inShadow = false;
+        if (ShadowsEnabled) {
+            // check for shadow
+            traceNVX(Scene,
+                     rayFlags,
+                     cullMask,
+                     1 /*sbtRecordOffset*/,
+                     0 /*sbtRecordStride*/,
+                     1 /*missIndex*/,
+                     hitPos + (hitNormal * SWS_SHADOW_RAY_OFFSET),
+                     SWS_EPSILON,
+                     toLight,
+                     toLightDist,
+                     SWS_LOC_SECONDARY_RAY);
+
+            inShadow = RayPayloadSecondary.colorAndDist.w < toLightDist;
+        }
+
+        if (inShadow) {
+            lambert = SWS_AMBIENT;
         } else {
-            lambert = max(0.05f, dot(hitNormal, toLight));
+            lambert = max(SWS_AMBIENT, dot(hitNormal, toLight));
         }
     }
 
-    const vec3 outColor = hitColor * lambert;
+    return hitColor * lambert;
+}
+
+void main() {
+    const ivec2 pixelCoord = ivec2(gl_LaunchIDNVX.xy);
+    const vec2 curPixel = vec2(gl_LaunchIDNVX.xy);
+    const uvec2 samplerPixel = uvec2(gl_LaunchIDNVX.xy);
+    const uint samplesPerPixel = max(Camera.sampling.x, 1u);
+    const uint generation = Camera.sampling.y;
+    const uint frameIndex = AccumulatedFrames(pixelCoord, generation);
+
+    vec3 outColor = vec3(0.0f);
+    for (uint i = 0; i < samplesPerPixel; ++i) {
+        const uint n = frameIndex * samplesPerPixel + i;
+        const vec2 jitter = SamplerGet2D(samplerPixel, n, SWS_SAMPLE_DIM_PIXEL) - 0.5f;
+        // the shadow ray sees the same level of detail as the camera ray
+        outColor += TraceSample(curPixel + jitter, SamplerGet2D(samplerPixel, n, SWS_SAMPLE_DIM_LENS), SamplerGet1D(samplerPixel, n, SWS_SAMPLE_DIM_TIME),
+                                SamplerGetLodCullMask(samplerPixel, n));
+    }
+    outColor /= float(samplesPerPixel);
+
+    outColor = Accumulate(pixelCoord, outColor, generation);
 
-    imageStore(OutputImage, ivec2(gl_LaunchIDNVX.xy), vec4(LinearToSrgb(outColor), 1.0f));
+    imageStore(OutputImage, pixelCoord, vec4(LinearToSrgb(outColor), 1.0f));
 }
@@ -0,0 +1,7 @@
+// Sampler tables, see Sampler.h, and the sampling functions reading them
+
+layout(set = SWS_SAMPLER_SET, binding = SWS_SAMPLER_BINDING, std430) readonly buffer SamplerTablesBuffer {
+    SamplerTables_s SamplerTables;
+};
+
+#include "../sampler_with_shaders.h"
@@ -0,0 +1,31 @@
+// Queues and constants shared by the wavefront stages, see vkTracer::RecordWavefront.
+// Queue entries are indexed by the sample's position in the current chunk.
+
+layout(set = SWS_WAVEFRONT_SET, binding = SWS_WF_RAYS_BINDING, std430) buffer RayQueue {
+    WavefrontRay_s Rays[];
+};
+
+layout(set = SWS_WAVEFRONT_SET, binding = SWS_WF_HITS_BINDING, std430) buffer HitQueue {
+    WavefrontHit_s Hits[];
+};
+
+layout(set = SWS_WAVEFRONT_SET, binding = SWS_WF_SHADOW_RAYS_BINDING, std430) buffer ShadowRayQueue {
+    WavefrontShadowRay_s ShadowRays[];
+};
+
+layout(set = SWS_WAVEFRONT_SET, binding = SWS_WF_SORTED_SHADOW_RAYS_BINDING, std430) buffer SortedShadowRayQueue {
+    WavefrontShadowRay_s SortedShadowRays[];
+};
+
+layout(set = SWS_WAVEFRONT_SET, binding = SWS_WF_COUNTERS_BINDING, std430) buffer CountersBuffer {
+    WavefrontCounters_s Counters;
+};
+
+// one entry per sample of the whole frame, summed per pixel by the resolve stage
+layout(set = SWS_WAVEFRONT_SET, binding = SWS_WF_RADIANCE_BINDING, std430) buffer RadianceBuffer {
+    vec4 Radiance[];
+};
+
+layout(push_constant) uniform WavefrontConstants {
+    WavefrontConstants_s Wavefront;
+};
@@ -0,0 +1,36 @@
+#version 460
+#extension GL_NVX_raytracing : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "../shared_with_shaders.h"
+#include "wavefront.glsl"
+
+layout(set = SWS_SCENE_AS_SET, binding = SWS_SCENE_AS_BINDING) uniform accelerationStructureNVX Scene;
+
+layout(location = SWS_LOC_SECONDARY_RAY) rayPayloadNVX RayPayload_s RayPayloadSecondary;
+
+// traces the sorted shadow rays, a sample that reaches the light gets the lit radiance
+void main() {
+    const uint index = gl_LaunchIDNVX.y * SWS_WF_LAUNCH_WIDTH + gl_LaunchIDNVX.x;
+    if (index >= Counters.shadowRayCount) {
+        return;
+    }
+
+    const WavefrontShadowRay_s ray = SortedShadowRays[index];
+
+    traceNVX(Scene,
+             gl_RayFlagsOpaqueNVX,
+             ray.sampleAndKey.z,
+             1 /*sbtRecordOffset*/,
+             0 /*sbtRecordStride*/,
+             1 /*missIndex*/,
+             ray.origin.xyz,
+             ray.origin.w,
+             ray.direction.xyz,
+             ray.direction.w,
+             SWS_LOC_SECONDARY_RAY);
+
+    if (RayPayloadSecondary.colorAndDist.w >= ray.direction.w) {
+        Radiance[ray.sampleAndKey.x] = ray.radiance;
+    }
+}
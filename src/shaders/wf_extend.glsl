@@ -0,0 +1,42 @@
+#version 460
+#extension GL_NVX_raytracing : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "../shared_with_shaders.h"
+#include "wavefront.glsl"
+
+layout(set = SWS_SCENE_AS_SET, binding = SWS_SCENE_AS_BINDING) uniform accelerationStructureNVX Scene;
+
+layout(set = SWS_CAMDATA_SET, binding = SWS_CAMDATA_BINDING, std140) uniform CamData {
+    CamData_s Camera;
+};
+
+layout(location = SWS_LOC_PRIMARY_RAY) rayPayloadNVX RayPayload_s RayPayload;
+
+// finds the closest hit of every queued ray, the hit shaders are the recursive integrator's
+void main() {
+    const uint index = gl_LaunchIDNVX.y * SWS_WF_LAUNCH_WIDTH + gl_LaunchIDNVX.x;
+    if (index >= Wavefront.samples.y) {
+        return;
+    }
+
+    const WavefrontRay_s ray = Rays[index];
+
+    // the cone starts as a point, also with an aperture where the lens blur is the larger effect
+    RayPayload.cone = vec4(0.0f, Camera.nearFarFov.w, 0.0f, 0.0f);
+
+    traceNVX(Scene,
+             gl_RayFlagsOpaqueNVX,
+             ray.cullMask.x,
+             0 /*sbtRecordOffset*/,
+             0 /*sbtRecordStride*/,
+             0 /*missIndex*/,
+             ray.origin.xyz,
+             ray.origin.w,
+             ray.direction.xyz,
+             ray.direction.w,
+             SWS_LOC_PRIMARY_RAY);
+
+    Hits[index].colorAndDist = RayPayload.colorAndDist;
+    Hits[index].normal = RayPayload.normal;
+}
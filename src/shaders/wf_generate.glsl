@@ -0,0 +1,47 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "../shared_with_shaders.h"
+#include "wavefront.glsl"
+
+layout(local_size_x = SWS_WF_GROUP_SIZE) in;
+
+layout(set = SWS_OUT_IMAGE_SET, binding = SWS_OUT_IMAGE_BINDING, rgba8) uniform image2D OutputImage;
+
+layout(set = SWS_CAMDATA_SET, binding = SWS_CAMDATA_BINDING, std140) uniform CamData {
+    CamData_s Camera;
+};
+
+#include "accumulation.glsl"
+#include "sampler.glsl"
+
+// writes the primary rays of the chunk, same jitter and camera as the recursive raygen
+void main() {
+    const uint index = gl_GlobalInvocationID.x;
+    if (index >= Wavefront.samples.y) {
+        return;
+    }
+
+    const uint samplesPerPixel = max(Camera.sampling.x, 1u);
+    const uint sampleIdx = Wavefront.samples.x + index;
+    const uint pixelIdx = sampleIdx / samplesPerPixel;
+
+    const uvec2 size = uvec2(imageSize(OutputImage));
+    const vec2 curPixel = vec2(pixelIdx % size.x, pixelIdx / size.x);
+    // resolve has not touched the accumulation yet, the count is the one of the previous frames
+    const uint frameIndex = AccumulatedFrames(ivec2(curPixel), Camera.sampling.y);
+    const uint i = sampleIdx % samplesPerPixel;
+    const uint n = frameIndex * samplesPerPixel + i;
+    const uvec2 samplerPixel = uvec2(curPixel);
+    const vec2 pixel = curPixel + SamplerGet2D(samplerPixel, n, SWS_SAMPLE_DIM_PIXEL) - 0.5f;
+
+    const vec2 uv = (pixel / vec2(size - 1u)) * 2.0f - 1.0f;
+    const float aspect = float(size.x) / float(size.y);
+
+    vec3 origin, direction;
+    CameraRay(Camera, uv, aspect, SamplerGet2D(samplerPixel, n, SWS_SAMPLE_DIM_LENS), SamplerGet1D(samplerPixel, n, SWS_SAMPLE_DIM_TIME), origin, direction);
+
+    Rays[index].origin = vec4(origin, Camera.nearFarFov.x);
+    Rays[index].direction = vec4(direction, Camera.nearFarFov.y);
+    Rays[index].cullMask = uvec4(SamplerGetLodCullMask(samplerPixel, n), 0u, 0u, 0u);
+}
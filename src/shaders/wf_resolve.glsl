@@ -0,0 +1,37 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "../shared_with_shaders.h"
+#include "wavefront.glsl"
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = SWS_OUT_IMAGE_SET, binding = SWS_OUT_IMAGE_BINDING, rgba8) uniform image2D OutputImage;
+
+layout(set = SWS_CAMDATA_SET, binding = SWS_CAMDATA_BINDING, std140) uniform CamData {
+    CamData_s Camera;
+};
+
+#include "accumulation.glsl"
+
+// averages the samples of every pixel once all the chunks are done and folds them into the accumulation
+void main() {
+    const uvec2 size = uvec2(imageSize(OutputImage));
+    if (any(greaterThanEqual(gl_GlobalInvocationID.xy, size))) {
+        return;
+    }
+
+    const uint samplesPerPixel = max(Camera.sampling.x, 1u);
+    const uint firstSample = (gl_GlobalInvocationID.y * size.x + gl_GlobalInvocationID.x) * samplesPerPixel;
+
+    vec3 outColor = vec3(0.0f);
+    for (uint i = 0; i < samplesPerPixel; ++i) {
+        outColor += Radiance[firstSample + i].rgb;
+    }
+    outColor /= float(samplesPerPixel);
+
+    const ivec2 pixelCoord = ivec2(gl_GlobalInvocationID.xy);
+    outColor = Accumulate(pixelCoord, outColor, Camera.sampling.y);
+
+    imageStore(OutputImage, pixelCoord, vec4(LinearToSrgb(outColor), 1.0f));
+}
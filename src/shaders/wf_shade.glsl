@@ -0,0 +1,56 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "../shared_with_shaders.h"
+#include "wavefront.glsl"
+
+layout(local_size_x = SWS_WF_GROUP_SIZE) in;
+
+layout(constant_id = SWS_SC_SHADOWS_ENABLED) const bool ShadowsEnabled = true;
+
+// Lights every hit. Misses and unshadowed hits are final, the rest queue a shadow ray carrying
+// the lit radiance and count it in its sort bucket.
+void main() {
+    const uint index = gl_GlobalInvocationID.x;
+    if (index >= Wavefront.samples.y) {
+        return;
+    }
+
+    const uint sampleIdx = Wavefront.samples.x + index;
+    const WavefrontRay_s ray = Rays[index];
+    const WavefrontHit_s hit = Hits[index];
+
+    const vec3 hitColor = hit.colorAndDist.rgb;
+    const float hitT = hit.colorAndDist.w;
+    const vec3 hitNormal = hit.normal.xyz;
+
+    if (hitT <= SWS_EPSILON) {
+        Radiance[sampleIdx] = vec4(hitColor, 1.0f);
+        return;
+    }
+
+    const vec3 hitPos = ray.origin.xyz + ray.direction.xyz * hitT;
+    vec3 toLight = SWS_SUN_POS - hitPos;
+    const float toLightDist = length(toLight);
+    toLight /= toLightDist;
+
+    const float lambert = max(SWS_AMBIENT, dot(hitNormal, toLight));
+    if (!ShadowsEnabled) {
+        Radiance[sampleIdx] = vec4(hitColor * lambert, 1.0f);
+        return;
+    }
+
+    // in shadow unless the connect stage finds the light
+    Radiance[sampleIdx] = vec4(hitColor * SWS_AMBIENT, 1.0f);
+
+    const vec3 origin = hitPos + (hitNormal * SWS_SHADOW_RAY_OFFSET);
+    const uint key = WavefrontSortKey(origin, toLight, Wavefront.sceneMin.xyz, Wavefront.sceneInvExtent.xyz);
+
+    const uint slot = atomicAdd(Counters.shadowRayCount, 1u);
+    ShadowRays[slot].origin = vec4(origin, SWS_EPSILON);
+    ShadowRays[slot].direction = vec4(toLight, toLightDist);
+    ShadowRays[slot].radiance = vec4(hitColor * lambert, 1.0f);
+    ShadowRays[slot].sampleAndKey = uvec4(sampleIdx, key, ray.cullMask.x, 0u);
+
+    atomicAdd(Counters.bucketCounts[key], 1u);
+}
@@ -0,0 +1,33 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "../shared_with_shaders.h"
+#include "wavefront.glsl"
+
+// Counting sort of the shadow rays by WavefrontSortKey, the shade stage already built the
+// histogram. SORT_SCAN turns it into bucket offsets, otherwise the rays are scattered.
+#ifdef SORT_SCAN
+layout(local_size_x = 1) in;
+
+// a few hundred buckets, a serial scan is cheaper than the barriers of a parallel one
+void main() {
+    uint offset = 0;
+    for (uint bucket = 0; bucket < SWS_WF_SORT_BUCKETS; ++bucket) {
+        Counters.bucketOffsets[bucket] = offset;
+        offset += Counters.bucketCounts[bucket];
+    }
+}
+#else
+layout(local_size_x = SWS_WF_GROUP_SIZE) in;
+
+void main() {
+    const uint index = gl_GlobalInvocationID.x;
+    if (index >= Counters.shadowRayCount) {
+        return;
+    }
+
+    const WavefrontShadowRay_s ray = ShadowRays[index];
+    const uint slot = atomicAdd(Counters.bucketOffsets[ray.sampleAndKey.y], 1u);
+    SortedShadowRays[slot] = ray;
+}
+#endif
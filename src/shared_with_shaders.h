@@ -4,6 +4,22 @@
 #ifdef __cplusplus
 // include math header for vec & mat types (same namings as in GLSL)
 #include "mymath.h"
+
+// the GLSL built-ins used by the helpers shared with the shaders
+#include <cmath>
+using std::abs;
+using std::atan;
+using std::cos;
+using std::log2;
+using std::sin;
+using std::tan;
+
+// helpers shared with the shaders live in a header
+#define SWS_FUNC inline
+#define SWS_OUT(type) type&
+#else
+#define SWS_FUNC
+#define SWS_OUT(type) out type
 #endif // __cplusplus
 
 
@@ -18,10 +34,31 @@
 #define SWS_IBL_BINDING         3
 #define SWS_MATERIALS_SET       0
 #define SWS_MATERIALS_BINDING   4
+#define SWS_ACCUM_SET           0
+#define SWS_ACCUM_BINDING       5
+#define SWS_ACCUM_GEN_SET       0
+#define SWS_ACCUM_GEN_BINDING   6
+#define SWS_SAMPLER_SET         0
+#define SWS_SAMPLER_BINDING     7
+
+#define SWS_GEOMETRY_SET        1
+#define SWS_FACES_BINDING       0
+#define SWS_NORMALS_BINDING     1
+#define SWS_UVS_BINDING         2
+#define SWS_FACEMATIDS_BINDING  3
+#define SWS_INSTANCES_BINDING   4
+#define SWS_POSITIONS_BINDING   5
 
-#define SWS_FACEMATIDS_SET      1
-#define SWS_FACES_SET           2
-#define SWS_NORMALS_SET         3
+#define SWS_TEXTURES_SET        2
+
+// wavefront integrator queues, see vkTracer::RecordWavefront
+#define SWS_WAVEFRONT_SET                   3
+#define SWS_WF_RAYS_BINDING                 0
+#define SWS_WF_HITS_BINDING                 1
+#define SWS_WF_SHADOW_RAYS_BINDING          2
+#define SWS_WF_SORTED_SHADOW_RAYS_BINDING   3
+#define SWS_WF_COUNTERS_BINDING             4
+#define SWS_WF_RADIANCE_BINDING             5
 
 // cross-shader locations
 #define SWS_LOC_PRIMARY_RAY     0
@@ -31,34 +68,234 @@
 
 #define SWS_MAX_RECURSION       2
 
+// specialization constant IDs, values come from vkTracer's RTPipelineConfig
+#define SWS_SC_SHADOWS_ENABLED  0
+#define SWS_SC_IBL_ENABLED      1
+
+// closest hit material features, one variant is compiled per combination
+// and every instance is pointed at the cheapest one covering its materials
+#define SWS_MATFEATURE_ALBEDO_TEXTURE   1
+#define SWS_MATFEATURE_ALL              (SWS_MATFEATURE_ALBEDO_TEXTURE)
+#define SWS_NUM_MATERIAL_VARIANTS       (SWS_MATFEATURE_ALL + 1)
+
+// hit records per material variant: primary ray, shadow ray
+#define SWS_NUM_RAY_TYPES       2
+
+// material texture index meaning "no texture"
+#define SWS_INVALID_TEXTURE     0xFFFFFFFFu
+
+// samples in flight per wavefront chunk, bigger frames are traced in several chunks
+#define SWS_WF_QUEUE_CAPACITY   (1u << 19)
+// raygen stages of the wavefront are launched as rows this wide
+#define SWS_WF_LAUNCH_WIDTH     1024u
+#define SWS_WF_GROUP_SIZE       64u
+// direction octant (3 bits) x origin Morton code (2 bits per axis)
+#define SWS_WF_SORT_BUCKETS     512u
+
+// sampler tables, see Sampler.h
+#define SWS_SAMPLER_SOBOL_DIMS      4u
+#define SWS_SAMPLER_SOBOL_BITS      32u
+#define SWS_SAMPLER_BLUE_NOISE_SIZE 64u
+
+// sampler dimensions of a camera sample, 2D ones take two
+#define SWS_SAMPLE_DIM_PIXEL    0u
+#define SWS_SAMPLE_DIM_LENS     2u
+#define SWS_SAMPLE_DIM_TIME     4u
+// picks the one of the 8 instance mask bits a sample traces with, see SamplerGetLodCullMask
+#define SWS_SAMPLE_DIM_LOD      5u
+#define SWS_LOD_MASK_BITS       8u
+
 
 #define SWS_PI      3.1415926536f
 #define SWS_EPSILON 1e-5f
 
+// direct lighting, the same for both integrators
+#define SWS_SUN_POS             vec3(436.181488f, 583.134888f, 57.8915443f)
+#define SWS_AMBIENT             0.05f
+#define SWS_SHADOW_RAY_OFFSET   0.1f
+
 struct CamData_s {
     vec4 pos;
     vec4 dir;
     vec4 up;
     vec4 side;
-    vec4 nearFarFov;
+    vec4 nearFarFov;    // x - near, y - far, z - vertical fov, w - ray cone spread of one pixel
+    uvec4 sampling;     // x - samples per pixel, y - camera generation, bumped on every change of the view, zw - reserved
+    vec4 lens;          // x - aperture radius, y - focus distance, zw - shutter open and close,
+                        // 0 is the previously uploaded view and 1 this one
+    vec4 prevPos;       // the previously uploaded view, the same as this one once the camera stops
+    vec4 prevDir;
+    vec4 prevUp;
+    vec4 prevSide;
+};
+
+struct SamplerTables_s {
+    uint sobolMatrices[SWS_SAMPLER_SOBOL_DIMS * SWS_SAMPLER_SOBOL_BITS];    // direction numbers, one row of bits per dimension
+    uint blueNoise[SWS_SAMPLER_BLUE_NOISE_SIZE * SWS_SAMPLER_BLUE_NOISE_SIZE];  // void and cluster ranks scaled to the whole uint range
 };
 
 struct RayPayload_s {
     vec4 colorAndDist;
     vec4 normal;
+    vec4 cone;          // x - width, y - spread angle, zw - reserved
+                        // the caller passes the cone at the ray origin, hits read it and leave it
+};
+
+// wavefront queue entries, one per sample of the current chunk
+struct WavefrontRay_s {
+    vec4 origin;        // w - tmin
+    vec4 direction;     // w - tmax
+    uvec4 cullMask;     // x - the sample's instance mask, yzw - reserved
+};
+
+struct WavefrontHit_s {
+    vec4 colorAndDist;
+    vec4 normal;
+};
+
+struct WavefrontShadowRay_s {
+    vec4 origin;        // w - tmin
+    vec4 direction;     // w - tmax
+    vec4 radiance;      // what the sample gets if the light is visible
+    uvec4 sampleAndKey; // x - sample index in the frame, y - sort key, z - instance mask, w - reserved
+};
+
+struct WavefrontCounters_s {
+    uint shadowRayCount;
+    uint reserved0;
+    uint reserved1;
+    uint reserved2;
+    uint bucketCounts[SWS_WF_SORT_BUCKETS];
+    uint bucketOffsets[SWS_WF_SORT_BUCKETS];
+};
+
+// push constants of every wavefront stage
+struct WavefrontConstants_s {
+    uvec4 samples;          // x - first sample of the chunk, y - samples in the chunk, z - samples in the frame, w - reserved
+    vec4 sceneMin;
+    vec4 sceneInvExtent;    // 1 / (scene max - scene min)
+};
+
+// where a mesh starts in the packed geometry buffers, indexed by gl_InstanceCustomIndexNVX
+struct InstanceData_s {
+    uint faceOffset;
+    uint vertexOffset;
+    uint reserved0;
+    uint reserved1;
 };
 
 struct Material_s {
-    vec4 diffuse;
-    vec4 emission;
+    vec4  diffuse;
+    vec4  emission;
+    uvec4 textures;     // x - albedo, yzw - reserved
 };
 
-#ifndef __cplusplus
-// shaders helper functions
-float Random(vec2 co) {
-    return fract(sin(dot(co.xy, vec2(12.9898f, 78.233f))) * 43758.5453f);
+// Ray cones, after "Texture Level of Detail Strategies for Real-Time Ray Tracing" (Ray Tracing Gems, ch. 20).
+// A cone is vec2(width, spread angle): the footprint width at the ray origin and how much it grows per
+// unit of distance. Only primary hits and misses pick mips from it, nothing bounces yet. Written in the
+// common subset of GLSL and C++ so the CPU side computes the same pixel spread.
+
+#define SWS_RAY_CONE_MIN_WIDTH  1e-8f
+#define SWS_RAY_CONE_MIN_COS    1e-3f
+
+// spread angle of a ray through one pixel for a vertical field of view
+SWS_FUNC float RayConePixelSpread(float fovY, float imageHeight) {
+    return atan(2.0f * tan(fovY * 0.5f) / imageHeight);
+}
+
+// the cone at distance t along the ray
+SWS_FUNC vec2 RayConePropagate(vec2 cone, float t) {
+    return vec2(cone.x + cone.y * t, cone.y);
+}
+
+// texel to world area ratio of a triangle in log2, independent of the texture size
+SWS_FUNC float TriangleTextureLod(vec3 p0, vec3 p1, vec3 p2, vec2 uv0, vec2 uv1, vec2 uv2) {
+    const float worldArea = length(cross(p1 - p0, p2 - p0));
+    const float uvArea = abs((uv1.x - uv0.x) * (uv2.y - uv0.y) - (uv2.x - uv0.x) * (uv1.y - uv0.y));
+    return 0.5f * log2(max(uvArea, SWS_RAY_CONE_MIN_WIDTH) / max(worldArea, SWS_RAY_CONE_MIN_WIDTH));
+}
+
+// mip level for a cone of the given width hitting a triangle, grazing angles get blurrier
+SWS_FUNC float RayConeTextureLod(float triangleLod, float coneWidth, vec3 normal, vec3 rayDir, vec2 textureSize) {
+    const float lod = triangleLod + 0.5f * log2(textureSize.x * textureSize.y)
+                    + log2(max(abs(coneWidth), SWS_RAY_CONE_MIN_WIDTH))
+                    - log2(max(abs(dot(normal, rayDir)), SWS_RAY_CONE_MIN_COS));
+    return max(lod, 0.0f);
+}
+
+// mip level of a lat-long environment map, its rows span PI radians
+SWS_FUNC float RayConeEnvironmentLod(float spread, vec2 textureSize) {
+    return max(log2(max(abs(spread), SWS_RAY_CONE_MIN_WIDTH) * textureSize.y / SWS_PI), 0.0f);
+}
+
+// primary ray direction through screenUV in [-1, 1]
+SWS_FUNC vec3 CameraRayDir(CamData_s camera, vec2 screenUV, float aspect) {
+    const float planeWidth = tan(camera.nearFarFov.z * 0.5f);
+
+    const vec3 u = vec3(camera.side) * (planeWidth * aspect);
+    const vec3 v = vec3(camera.up) * planeWidth;
+
+    return normalize(vec3(camera.dir) + (u * screenUV.x) - (v * screenUV.y));
 }
 
+// camera basis at shutter time t, 0 is the previous view and 1 this one
+SWS_FUNC CamData_s CameraAtTime(CamData_s camera, float t) {
+    CamData_s result = camera;
+    result.pos = camera.prevPos + (camera.pos - camera.prevPos) * t;
+    result.dir = vec4(normalize(vec3(camera.prevDir + (camera.dir - camera.prevDir) * t)), 0.0f);
+    result.up = vec4(normalize(vec3(camera.prevUp + (camera.up - camera.prevUp) * t)), 0.0f);
+    result.side = vec4(normalize(vec3(camera.prevSide + (camera.side - camera.prevSide) * t)), 0.0f);
+    return result;
+}
+
+// square to unit disk, keeps the strata of the square intact
+SWS_FUNC vec2 ConcentricDisk(vec2 u) {
+    const vec2 offset = u * 2.0f - 1.0f;
+    if (offset.x == 0.0f && offset.y == 0.0f) {
+        return vec2(0.0f);
+    }
+    if (abs(offset.x) > abs(offset.y)) {
+        const float phi = (SWS_PI * 0.25f) * (offset.y / offset.x);
+        return offset.x * vec2(cos(phi), sin(phi));
+    }
+    const float phi = (SWS_PI * 0.5f) - (SWS_PI * 0.25f) * (offset.x / offset.y);
+    return offset.y * vec2(cos(phi), sin(phi));
+}
+
+// Thin lens ray through screenUV in [-1, 1] at shutter sample timeSample. Without an aperture
+// it is the pinhole ray, the lens only moves the origin and keeps the focus plane in place.
+SWS_FUNC void CameraRay(CamData_s camera, vec2 screenUV, float aspect, vec2 lensSample, float timeSample,
+               SWS_OUT(vec3) origin, SWS_OUT(vec3) direction) {
+    const CamData_s view = CameraAtTime(camera, mix(camera.lens.z, camera.lens.w, timeSample));
+
+    origin = vec3(view.pos);
+    direction = CameraRayDir(view, screenUV, aspect);
+
+    if (camera.lens.x > 0.0f) {
+        const vec3 focusPoint = origin + direction * (camera.lens.y / dot(direction, vec3(view.dir)));
+        const vec2 lens = ConcentricDisk(lensSample) * camera.lens.x;
+        origin += vec3(view.side) * lens.x + vec3(view.up) * lens.y;
+        direction = normalize(focusPoint - origin);
+    }
+}
+
+// 2 bit cell of a normalized coordinate, spread out for interleaving
+SWS_FUNC uint MortonCell(float v) {
+    const uint cell = uint(min(max(v, 0.0f), 0.999f) * 4.0f);
+    return (cell & 1u) | ((cell & 2u) << 2u);
+}
+
+// Rays are sorted by direction octant first and then by where they start, so rays traced
+// next to each other take similar paths through the acceleration structure
+SWS_FUNC uint WavefrontSortKey(vec3 origin, vec3 direction, vec3 sceneMin, vec3 sceneInvExtent) {
+    const uint octant = (direction.x < 0.0f ? 1u : 0u) | (direction.y < 0.0f ? 2u : 0u) | (direction.z < 0.0f ? 4u : 0u);
+    const vec3 cell = (origin - sceneMin) * sceneInvExtent;
+    const uint morton = MortonCell(cell.x) | (MortonCell(cell.y) << 1u) | (MortonCell(cell.z) << 2u);
+    return (octant << 6u) | morton;
+}
+
+#ifndef __cplusplus
+// shaders helper functions
 vec3 LinearToSrgb(vec3 c) {
 #if 0
     // Based on http://chilliant.blogspot.com/2012/08/srgb-approximations-for-hlsl.html
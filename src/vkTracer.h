@@ -1,12 +1,23 @@
 #pragma once
 
 #include "framework/RaytracingApplication.h"
+#include "framework/TextureStreamer.h"
+#include "framework/ShaderCompiler.h"
+#include "framework/ShaderBindingTable.h"
+#include "framework/JobSystem.h"
 #include "GeometryLoader.h"
+#include "GeometryPager.h"
 #include "Camera.h"
+#include "CameraController.h"
+#include "CameraPath.h"
+#include "Sampler.h"
+#include "Benchmark.h"
 
 #include <array>
+#include <functional>
 #include <vector>
 
+// vertex and face data lives in the packed scene buffers, see vkTracer::CreateSceneBuffers
 struct RTGeometry {
     RTGeometry()
         : as(VK_NULL_HANDLE)
@@ -16,12 +27,62 @@ struct RTGeometry {
     VkGeometryNVX               vkgeo;
     VkAccelerationStructureNVX  as;
     VkDeviceMemory              asMemory;
-    BufferResource              positions;
-    BufferResource              normals;
-    BufferResource              uvs;
-    BufferResource              ib;
-    BufferResource              faces;
-    BufferResource              matIDs;
+};
+
+// a mesh and its levels of detail, consecutive entries in mRTGeometries from firstGeometry on
+struct RTLodMesh {
+    uint32_t    firstGeometry;
+    uint32_t    numLods;
+    // a sphere around the full detail mesh, what its size on screen is taken from
+    vec3        center;
+    float       radius;
+};
+
+// baked into the ray tracing pipeline through specialization constants
+struct RTPipelineConfig {
+    RTPipelineConfig()
+        : maxRecursionDepth(SWS_MAX_RECURSION)
+        , shadowsEnabled(VK_TRUE)
+        , iblEnabled(VK_TRUE)
+    { }
+
+    uint32_t    maxRecursionDepth;
+    VkBool32    shadowsEnabled;
+    VkBool32    iblEnabled;
+};
+
+// Recursive traces a whole sample per raygen invocation. Wavefront splits the samples into
+// generate, extend, shade, sort and connect stages over ray queues, see RecordWavefront
+enum class RTIntegrator : uint32_t {
+    Recursive,
+    Wavefront
+};
+
+// compute stages of the wavefront integrator, extend and connect are raygen shaders
+enum class WavefrontStage : uint32_t {
+    Generate,
+    Shade,
+    SortScan,
+    SortScatter,
+    Resolve,
+    Count
+};
+
+// how each mesh's level of detail is picked whenever the camera or the view size changes, see vkTracer::SelectLods
+enum class LodPolicy : uint32_t {
+    // every mesh at full detail
+    Off,
+    // about sLodPixelsPerTriangle pixels per triangle of the mesh's projected bounding sphere
+    Projected
+};
+
+// where a shader is compiled from at runtime and which binary replaces it without the compiler
+struct ShaderStageSource {
+    const wchar_t*          sourceName;
+    shaderc_shader_kind     kind;
+    const char*             define;
+    const wchar_t*          binaryName;
+    VkShaderStageFlagBits   stage;
 };
 
 class vkTracer : public RaytracingApplication {
@@ -34,14 +95,84 @@ public:
     virtual void UpdateDataForFrame(uint32_t frameIndex);
     virtual void Cleanup() override;
 
+    // Call before Run, replaces the interactive camera with the run's path and quits once
+    // the measured frames are done
+    void SetBenchmarkRun(const BenchmarkRun& run);
+    const BenchmarkResult& GetBenchmarkResult() const;
+
+    // Rerecords the command buffers when the integrator changes
+    void SetIntegrator(const RTIntegrator integrator);
+
+    // Depth of field and motion blur, see Camera::SetLens and Camera::SetShutter. Both converge
+    // in the accumulation, a still view with an aperture keeps refining its bokeh.
+    void SetLens(const float apertureRadius, const float focusDistance);
+    void SetShutter(const float open, const float close);
+
+    // Call before Run. Over 0 the scene stays in the geometry cache and only the pages around the
+    // camera are resident, within this many bytes of geometry and acceleration structures, see
+    // GeometryPager. 0 loads the whole scene up front.
+    void SetGeometryBudget(const uint64_t budgetBytes);
+
+    // Call before Run. Anything but Off has GeometryLoader build the levels of detail and every
+    // mesh traced at the one its size on screen calls for. A mesh between two levels gets an
+    // instance for each, their masks split the samples between them, so the accumulation blends
+    // the levels instead of popping from one to the other. Off with a geometry budget, the pages
+    // have no levels of detail.
+    void SetLodPolicy(const LodPolicy policy);
+
 private:
+    void CreateTextureStreamer();
     void CreateCamera();
-    void UpdateCamera(const float dt);
+    // bumps the camera generation, which restarts the accumulation
+    void UploadCamera();
+    // marks the camera dirty only when the view really changes
+    void SetCameraTransform(const vec3& position, const quat& rotation);
+    // R records the camera to a file next to the executable, P plays it back;
+    // true while the playback drives the camera
+    bool UpdateCameraPath(const InputState& input, const float dt);
+    void UpdateBenchmark();
+    void FinishBenchmark();
     void LoadIBLTexture();
+    void CreateSceneBuffers();
     void CreateAccelerationStructures();
+    // the top level structure over every page, built from the first update's resident set
+    void CreatePagedAccelerationStructures();
+    // faults in and evicts pages for the current camera, builds the new pages' bottom level
+    // structures and rebuilds the top level one; waits for the device when anything changed
+    void UpdateGeometryPages(const bool force);
+    // the top level instances for the current camera and the triangles they trace, a sample sees
+    // the triangles of the instances its mask bit is set in
+    void SelectLods(std::vector<VkGeometryInstance>& instances, double& tracedTriangles) const;
+    // rebuilds the top level structure when the camera or the view changed the selection, waits for the device then
+    void UpdateLods();
+    // over the first instanceCount instances in mRTTopInstancesBuffer
+    void RecordTopLevelBuild(VkCommandBuffer commandBuffer, const uint32_t instanceCount, VkBuffer scratchBuffer);
+    void FillRTGeometry(RTGeometry& rtgeom, const InstanceData_s& instanceData, const uint32_t numVertices, const uint32_t numFaces) const;
+    // the cheapest closest hit variant that still covers every material of the faces
+    uint32_t GetMaterialFeatures(const uint32_t* matIDs, const size_t numFaces) const;
+    VkAccelerationStructureNVX CreateAccelerationStructure(VkAccelerationStructureTypeNVX type, uint32_t geometryCount, const VkGeometryNVX* geometries,
+                                                           uint32_t instanceCount, VkBuildAccelerationStructureFlagsNVX flags, VkDeviceSize compactedSize);
+    VkMemoryRequirements GetAccelerationStructureMemoryRequirements(VkAccelerationStructureNVX accelerationStructure, const bool scratch);
+    // device local when the budget allows, host visible otherwise
+    VkDeviceMemory BindAccelerationStructureMemory(VkAccelerationStructureNVX accelerationStructure);
+    void AccelerationStructureBarrier(VkCommandBuffer commandBuffer);
+    void RecordBottomLevelBuild(VkCommandBuffer commandBuffer, const RTGeometry& rtgeom, VkBuildAccelerationStructureFlagsNVX flags, VkBuffer scratchBuffer);
+    void BuildCompactedBottomLevel(const BufferResource& scratchBuffer, VkBuildAccelerationStructureFlagsNVX flags, VkDeviceSize batchBudget);
+    // records, submits and waits, timed under the given GPU scope
+    void SubmitImmediateCommands(const char* scopeName, const std::function<void(VkCommandBuffer)>& record);
+    void LoadMaterialTextures();
     void CreateSceneShaderData();
     void CreateDescriptorSetLayouts();
     void CreatePipeline();
+    bool LoadShader(const ShaderStageSource& source, ShaderResource& shader, const bool allowPrecompiled);
+    bool CreateRTPipeline(VkPipeline& pipeline, const bool allowPrecompiled);
+    bool CreateWavefrontPipelines(std::array<VkPipeline, static_cast<size_t>(WavefrontStage::Count)>& pipelines, const bool allowPrecompiled);
+    void DestroyWavefrontPipelines();
+    void CreateWavefrontBuffers();
+    void CreateAccumulationImages();
+    void CreateSamplerBuffer();
+    void RecordWavefront(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void ReloadShaders();
     void CreateShaderBindingTable();
     void CreateDescriptorSets();
     void UpdateDescriptorSets();
@@ -51,23 +182,94 @@ private:
     VkAccelerationStructureNVX              mTopAS;
     VkPipelineLayout                        mRTPipelineLayout;
     VkPipeline                              mRTPipeline;
+    RTPipelineConfig                        mRTConfig;
     VkDescriptorPool                        mRTDescriptorPool;
     std::array<VkDescriptorSetLayout, 4>    mRTDescriptorSetLayouts;
     std::array<VkDescriptorSet, 4>          mRTDescriptorSets;
 
-    BufferResource                          mShaderBindingTable;
+    // wavefront integrator
+    RTIntegrator                            mIntegrator;
+    std::array<VkPipeline, static_cast<size_t>(WavefrontStage::Count)> mWavefrontPipelines;
+    BufferResource                          mWFRaysBuffer;
+    BufferResource                          mWFHitsBuffer;
+    BufferResource                          mWFShadowRaysBuffer;
+    BufferResource                          mWFSortedShadowRaysBuffer;
+    BufferResource                          mWFCountersBuffer;
+    BufferResource                          mWFRadianceBuffer;
+    uint32_t                                mWFExtendRecord;
+    uint32_t                                mWFConnectRecord;
+
+    ShaderBindingTable                      mShaderBindingTable;
+    ShaderCompiler                          mShaderCompiler;
+    ShaderWatcher                           mShaderWatcher;
+    uint64_t                                mLastShaderCheckTime;
 
+    std::wstring                            mSceneFileName;
     GeometryLoader                          mGeometryLoader;
     std::vector<RTGeometry>                 mRTGeometries;
     BufferResource                          mRTMaterialsBuffer;
-    std::vector<VkBufferView>               mRTFaceMaterialIDBufferViews;
-    std::vector<VkBufferView>               mRTFacesBufferViews;
-    std::vector<VkBufferView>               mRTNormalsBufferViews;
+    std::vector<InstanceData_s>             mRTInstancesData;
+    vec3                                    mSceneMin;
+    vec3                                    mSceneMax;
+    BufferResource                          mRTPositionsBuffer;
+    BufferResource                          mRTFacesBuffer;
+    BufferResource                          mRTNormalsBuffer;
+    BufferResource                          mRTUVsBuffer;
+    BufferResource                          mRTFaceMatIDsBuffer;
+    BufferResource                          mRTInstancesBuffer;
+
+    // every entry of mRTGeometries as a top level instance, for the rebuilds that pick among them
+    std::vector<VkGeometryInstance>         mRTGeometryInstances;
+    BufferResource                          mRTTopInstancesBuffer;
+    BufferResource                          mRTUpdateScratchBuffer;
+
+    // paged geometry, mRTGeometries and mRTInstancesData are per page then and the packed
+    // buffers are pools the pager hands out ranges of
+    uint64_t                                mGeometryBudget;
+    GeometryPager                           mGeometryPager;
+    uint64_t                                mGeometryPagerLastPrintTime;
+
+    // levels of detail, mRTGeometries and mRTInstancesData are per level of every mesh then
+    LodPolicy                               mLodPolicy;
+    std::vector<RTLodMesh>                  mRTLodMeshes;
+    // what the top level structure was last built from
+    std::vector<VkGeometryInstance>         mRTSelectedInstances;
+    double                                  mRTTracedTriangles;
+    // the view height and field of view in degrees the selection's pixel sizes are for
+    uint32_t                                mRTSelectedViewHeight;
+    float                                   mRTSelectedFovY;
 
     BufferResource                          mCamDataBuffer;
+    // as last uploaded, the previous view for the motion blur
+    CamData_s                               mCamData;
+    ImageResource                           mAccumImage;
+    ImageResource                           mAccumGenImage;
+    BufferResource                          mSamplerBuffer;
     ImageResource                           mIBLTexture;
+    std::vector<ImageResource>              mMaterialTextures;
+    TextureCache                            mTextureCache;
+    TextureStreamer                         mTextureStreamer;
+    // every hardware thread, for the startup work that splits up well
+    JobSystem                               mJobSystem;
 
     // camera a& user interaction
     Camera                                  mCamera;
-    vec2                                    mCursorPos;
+    CameraController                        mCameraController;
+    // set by anything that invalidates the accumulated frames, the upload waits for the next update
+    bool                                    mCameraDirty;
+    uint32_t                                mCameraGeneration;
+    CameraPath                              mCameraPath;
+    bool                                    mCameraPathRecording;
+    bool                                    mCameraPathPlaying;
+    float                                   mCameraPathTime;
+    uint32_t                                mSamplesPerPixel;
+    uint32_t                                mFrameIndex;
+
+    // benchmark mode
+    bool                                    mBenchmarkMode;
+    BenchmarkRun                            mBenchmarkRun;
+    BenchmarkResult                         mBenchmarkResult;
+    std::vector<double>                     mBenchmarkFrameTimes;
+    double                                  mBenchmarkTracedTriangles;
+    double                                  mBenchmarkLastFrameTime;
 };